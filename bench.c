@@ -0,0 +1,1524 @@
+/* bench.c */
+
+/*
+    Benchmarks for safe_string.
+
+    Every exported function is timed on reproducible corpora of several
+    sizes and compared with the closest libc routine. Results are written
+    to stdout as JSON.
+
+    Usage: ./bench [--quick] [--filter name]
+        --quick         only run corpora up to 64 KiB
+        --filter name   only run benchmarks whose name contains 'name'
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <search.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "safe_string.h"
+
+#define WARMUP_NS 10000000ull
+#define BATCH_NS 2000000ull
+#define REPETITIONS 7
+#define SEED 0x5eed5eedull
+#define STREAM_CHUNK 4096
+
+typedef struct corpus {
+    const char* kind;
+    size_t len;
+    char* data;         /* null-terminated copy of the bytes */
+    string s;           /* the same bytes as a safe string */
+    string work;        /* scratch string for mutating benchmarks */
+    string hashed;      /* the same bytes with a cached hash */
+    string shared;      /* the same bytes as a reference-counted string */
+    const char* needle;
+    size_t nlen;
+    const char* sep;
+    size_t seplen;
+    string* parts;      /* s split by sep */
+    const char** cparts;
+    size_t nparts;
+    sarray* array;      /* the same pieces in one sarray */
+    char path[32];      /* the same bytes in a temporary file */
+    spattern* pneedle;
+    spattern* psep;
+    smulti* keywords;
+    srope* rope;        /* the same bytes as a rope */
+} corpus;
+
+typedef struct bench {
+    const char* name;
+    const char* impl;       /* "safe_string" or "libc" */
+    const char* compare;    /* the function a libc baseline stands in for */
+    bool search_only;       /* also run on the adversarial corpus */
+    size_t (*run)(corpus* c);
+    size_t max_len;         /* skip larger corpora, 0 for no limit */
+} bench;
+
+static volatile size_t sink;
+
+/* Deterministic generator so every run sees the same corpora */
+static uint64_t rng_state = SEED;
+
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static const char* log_words[] = {
+    "INFO", "WARN", "ERROR", "DEBUG", "request", "completed", "user", "session",
+    "GET", "POST", "/api/v1/items", "/healthz", "latency_ms=12", "bytes=5120",
+    "host=web-03", "trace=9f2c", "cache=miss", "retry=0"
+};
+#define LOG_WORDS (sizeof(log_words) / sizeof(log_words[0]))
+
+static void fill_log(char* buf, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        char line[160];
+        int n = snprintf(line, sizeof(line), "2024-05-%02u 12:%02u:%02u ",
+                         (unsigned)(rng() % 28 + 1), (unsigned)(rng() % 60), (unsigned)(rng() % 60));
+        size_t words = rng() % 6 + 3;
+        for (size_t i = 0; i < words && n < 140; i++)
+            n += snprintf(line + n, sizeof(line) - n, "%s ", log_words[rng() % LOG_WORDS]);
+        line[n - 1] = '\n';
+        size_t take = (size_t)n < len - pos ? (size_t)n : len - pos;
+        memcpy(buf + pos, line, take);
+        pos += take;
+    }
+}
+
+static void fill_random(char* buf, size_t len) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789 ,;:=-_./ABCDEFGHIJ";
+    for (size_t i = 0; i < len; i++)
+        buf[i] = alphabet[rng() % (sizeof(alphabet) - 1)];
+}
+
+static void fill_adversarial(char* buf, size_t len) {
+    memset(buf, 'a', len);
+}
+
+static bool corpus_init(corpus* c, const char* kind, size_t len) {
+    memset(c, 0, sizeof(*c));
+    c->kind = kind;
+    c->len = len;
+    c->data = malloc(len + 1);
+    if (!c->data)
+        return false;
+
+    if (strcmp(kind, "log") == 0) {
+        fill_log(c->data, len);
+        c->needle = "status=503";
+        c->sep = "\n";
+    } else if (strcmp(kind, "random") == 0) {
+        fill_random(c->data, len);
+        c->needle = "needle-x7";
+        c->sep = ";";
+    } else {
+        fill_adversarial(c->data, len);
+        c->needle = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
+        c->sep = "b";
+    }
+    c->nlen = strlen(c->needle);
+    c->seplen = strlen(c->sep);
+    /* Plant the needle near the end so searches scan most of the corpus */
+    if (c->nlen <= len)
+        memcpy(c->data + (len - c->nlen) * 9 / 10, c->needle, c->nlen);
+    c->data[len] = 0;
+
+    c->s = snewlen(c->data, len);
+    c->work = snewlen(NULL, len);
+    c->hashed = shashed(snewlen(c->data, len));
+    c->shared = sshare(snewlen(c->data, len));
+    c->pneedle = spcompile(c->nlen, c->needle);
+    c->psep = spcompile(c->seplen, c->sep);
+    const char* keys[] = {"ERROR", "timeout", "status=503", "user", "cache=miss", "needle-x7"};
+    size_t lens[] = {5, 7, 10, 4, 10, 9};
+    c->keywords = smcompile(6, lens, keys);
+    c->rope = sronew(len, c->data);
+    if (!c->s || !c->work || !c->hashed || !c->shared || !c->pneedle || !c->psep || !c->keywords || !c->rope)
+        return false;
+
+    c->parts = ssplit(c->s, c->seplen, c->sep, &c->nparts);
+    if (!c->parts) {
+        c->parts = malloc(sizeof(string));
+        if (!c->parts)
+            return false;
+        c->parts[0] = sdup(c->s);
+        c->nparts = 1;
+    }
+    c->cparts = malloc(c->nparts * sizeof(char*));
+    if (!c->cparts)
+        return false;
+    for (size_t i = 0; i < c->nparts; i++)
+        c->cparts[i] = c->parts[i];
+    c->array = ssplit_array(c->s, c->seplen, c->sep);
+    if (!c->array)
+        return false;
+
+    strcpy(c->path, "/tmp/sbenchXXXXXX");
+    int fd = mkstemp(c->path);
+    if (fd < 0) {
+        c->path[0] = 0;
+        return false;
+    }
+    bool written = write(fd, c->data, len) == (ssize_t)len;
+    close(fd);
+    return written;
+}
+
+static void corpus_free(corpus* c) {
+    free(c->data);
+    sfree(c->s);
+    sfree(c->work);
+    sfree(c->hashed);
+    sfree(c->shared);
+    spfree(c->pneedle);
+    spfree(c->psep);
+    smfree(c->keywords);
+    srofree(c->rope);
+    if (c->parts)
+        sfreearr(c->parts, c->nparts);
+    free(c->cparts);
+    sarrfree(c->array);
+    if (c->path[0])
+        unlink(c->path);
+}
+
+/* Reset the scratch string to the corpus bytes before a mutating call */
+static string restore(corpus* c) {
+    memcpy(c->work, c->data, c->len + 1);
+    supdatelen(c->work, c->len);
+    return c->work;
+}
+
+/* safe_string */
+
+static size_t run_snew(corpus* c) {
+    string s = snew(c->data);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_snewlen(corpus* c) {
+    string s = snewlen(c->data, c->len);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sdup(corpus* c) {
+    string s = sdup(c->s);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sshare(corpus* c) {
+    string s = sshare(snewlen(c->data, c->len));
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+/* sdup of a shared string takes a reference instead of copying */
+static size_t run_sdup_shared(corpus* c) {
+    string s = sdup(c->shared);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sunshare(corpus* c) {
+    string s = sunshare(sretain(c->shared));
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+/* Map the corpus file and read every byte once */
+static size_t run_smapfile(corpus* c) {
+    string s = smapfile(c->path, SMAP_SEQUENTIAL);
+    sink += scount(s, c->seplen, c->sep);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sgetlen(corpus* c) {
+    supdatelen(c->work, c->len);
+    sink += sgetlen(c->work);
+    return c->len;
+}
+
+static size_t run_sjoin(corpus* c) {
+    string s = sjoin(c->nparts, c->cparts, c->seplen, c->sep);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sjoins(corpus* c) {
+    string s = sjoins(c->nparts, c->parts, c->seplen, c->sep);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sjoinv(corpus* c) {
+    sview* views = malloc(c->nparts * sizeof(sview));
+    if (!views)
+        return c->len;
+    for (size_t i = 0; i < c->nparts; i++)
+        views[i] = sview_of(c->parts[i]);
+    string s = sjoinv(NULL, c->nparts, views, c->seplen, c->sep);
+    sink += sgetlen(s);
+    sfree(s);
+    free(views);
+    return c->len;
+}
+
+static size_t run_scatc(corpus* c) {
+    string s = scatc(c->data, c->data);
+    sink += sgetlen(s);
+    sfree(s);
+    return 2 * c->len;
+}
+
+static size_t run_scats(corpus* c) {
+    string s = scats(c->s, c->s);
+    sink += sgetlen(s);
+    sfree(s);
+    return 2 * c->len;
+}
+
+static size_t run_scat(corpus* c) {
+    string s = snew("");
+    for (size_t i = 0; i < c->nparts && s; i++) {
+        size_t len = sgetlen(c->parts[i]);
+        if (len)
+            s = scat(s, len, c->parts[i]);
+    }
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+/* Reserve the final size up front, so the appends never reallocate */
+static size_t run_sreserve(corpus* c) {
+    string s = sreserve(snew(""), c->len);
+    for (size_t i = 0; i < c->nparts && s; i++) {
+        size_t len = sgetlen(c->parts[i]);
+        if (len)
+            s = scat(s, len, c->parts[i]);
+    }
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sshrink_to_fit(corpus* c) {
+    string s = sreserve(snewlen(c->data, c->len), 2 * c->len);
+    s = sshrink_to_fit(s);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+/* Refill the scratch string, which keeps its capacity across calls */
+static size_t run_sclear(corpus* c) {
+    string s = c->work;
+    sclear(s);
+    for (size_t i = 0; i < c->nparts && s; i++) {
+        size_t len = sgetlen(c->parts[i]);
+        if (len)
+            s = scat(s, len, c->parts[i]);
+    }
+    if (s)
+        c->work = s;
+    sink += sgetlen(s);
+    return c->len;
+}
+
+static size_t run_supper(corpus* c) {
+    sink += supper(restore(c));
+    return c->len;
+}
+
+static size_t run_slower(corpus* c) {
+    sink += slower(restore(c));
+    return c->len;
+}
+
+static size_t run_supper_ascii(corpus* c) {
+    sink += supper_ascii(restore(c));
+    return c->len;
+}
+
+static size_t run_slower_ascii(corpus* c) {
+    sink += slower_ascii(restore(c));
+    return c->len;
+}
+
+static size_t run_sstartswith(corpus* c) {
+    sink += sstartswith(c->s, c->nlen, c->needle);
+    return c->nlen;
+}
+
+static size_t run_sendswith(corpus* c) {
+    sink += sendswith(c->s, c->nlen, c->needle);
+    return c->nlen;
+}
+
+static size_t run_sfind(corpus* c) {
+    sink += sfind(c->s, c->nlen, c->needle);
+    return c->len;
+}
+
+static size_t run_sfind_advanced(corpus* c) {
+    sink += sfind_advanced(c->s, c->nlen, c->needle);
+    return c->len;
+}
+
+static size_t run_srfind(corpus* c) {
+    ssize_t hit = srfind(c->s, c->nlen, c->needle);
+    sink += hit;
+    return hit < 0 ? c->len : c->len - hit;
+}
+
+static size_t run_scount(corpus* c) {
+    sink += scount(c->s, c->seplen, c->sep);
+    return c->len;
+}
+
+static size_t run_sfind_parallel(corpus* c) {
+    sink += sfind_parallel(c->s, c->nlen, c->needle);
+    return c->len;
+}
+
+static size_t run_scount_parallel(corpus* c) {
+    sink += scount_parallel(c->s, c->seplen, c->sep);
+    return c->len;
+}
+
+static size_t run_sfind_view(corpus* c) {
+    sink += sfind_view((sview){c->data, c->len}, c->nlen, c->needle);
+    return c->len;
+}
+
+static size_t run_sslice_view(corpus* c) {
+    sview v = sslice_view((sview){c->data, c->len}, c->len / 4, c->len - c->len / 4);
+    sink += v.len + (v.ptr ? v.ptr[0] : 0);
+    return c->len / 2;
+}
+
+static size_t run_ssplit_views(corpus* c) {
+    sview* views = malloc(c->nparts * sizeof(sview));
+    if (!views)
+        return c->len;
+    sink += ssplit_views((sview){c->data, c->len}, c->seplen, c->sep, views, c->nparts);
+    free(views);
+    return c->len;
+}
+
+static size_t run_strim(corpus* c) {
+    sink += strim(restore(c), 1, c->data);
+    return c->len;
+}
+
+static size_t run_sremove(corpus* c) {
+    sink += sremove(restore(c), c->seplen, c->sep);
+    return c->len;
+}
+
+static size_t run_sslice(corpus* c) {
+    string s = sslice(c->s, c->len / 4, c->len - c->len / 4);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len / 2;
+}
+
+static size_t run_sbite(corpus* c) {
+    string s = restore(c);
+    string piece;
+    while ((piece = sbite(s, c->seplen, c->sep)) != NULL) {
+        sink += sgetlen(piece);
+        sfree(piece);
+    }
+    return c->len;
+}
+
+static size_t run_stok(corpus* c) {
+    stok t;
+    sview v;
+    stok_init(&t, c->s, c->seplen, c->sep);
+    while (stok_next(&t, &v))
+        sink += v.len;
+    return c->len;
+}
+
+static size_t run_ssplit(corpus* c) {
+    size_t n;
+    string* arr = ssplit(c->s, c->seplen, c->sep, &n);
+    if (arr) {
+        sink += n;
+        sfreearr(arr, n);
+    }
+    return c->len;
+}
+
+static size_t run_sasplit(corpus* c) {
+    sarena* a = sacreate(0);
+    size_t n;
+    string* arr = sasplit(a, c->s, c->seplen, c->sep, &n);
+    if (arr)
+        sink += n;
+    safree(a);
+    return c->len;
+}
+
+static size_t run_sanew(corpus* c) {
+    sarena* a = sacreate(0);
+    for (size_t i = 0; i < c->nparts; i++)
+        sink += sgetlen(sanew(a, c->cparts[i]));
+    safree(a);
+    return c->len;
+}
+
+static size_t run_ssplit_array(corpus* c) {
+    sarray* a = ssplit_array(c->s, c->seplen, c->sep);
+    sink += sarrlen(a);
+    sarrfree(a);
+    return c->len;
+}
+
+static size_t run_sarrpush(corpus* c) {
+    sarray* a = sarrnew(0, 0);
+    for (size_t i = 0; i < c->nparts; i++)
+        sarrpush(a, c->parts[i], sgetlen(c->parts[i]));
+    sink += sarrlen(a);
+    sarrfree(a);
+    return c->len;
+}
+
+static size_t run_sjoin_array(corpus* c) {
+    string s = sjoin_array(c->array, c->seplen, c->sep);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_sltrimchar(corpus* c) {
+    char set[] = "0123456789-: ";
+    sink += sltrimchar(restore(c), sizeof(set) - 1, set);
+    return c->len;
+}
+
+static size_t run_scspn(corpus* c) {
+    static const char set[] = "\t\"<>\\";
+    scharset cs = scharset_of(sizeof(set) - 1, set);
+    sink += scspn(c->s, &cs);
+    return c->len;
+}
+
+static size_t run_strimchars(corpus* c) {
+    static const char set[] = "0123456789-: \n";
+    scharset cs = scharset_of(sizeof(set) - 1, set);
+    sink += strimchars(restore(c), &cs);
+    return c->len;
+}
+
+static size_t run_srtrimchars(corpus* c) {
+    static const char set[] = "0123456789-: \n";
+    scharset cs = scharset_of(sizeof(set) - 1, set);
+    sink += srtrimchars(restore(c), &cs);
+    return c->len;
+}
+
+/* Printable ASCII and newlines, which covers every corpus byte */
+static size_t printable(char* set) {
+    size_t n = 0;
+    set[n++] = '\n';
+    for (int ch = ' '; ch <= '~'; ch++)
+        set[n++] = (char)ch;
+    set[n] = 0;
+    return n;
+}
+
+static size_t run_sspn(corpus* c) {
+    char set[97];
+    scharset cs = scharset_of(printable(set), set);
+    sink += sspn(c->s, &cs);
+    return c->len;
+}
+
+static size_t run_sfind_any_of(corpus* c) {
+    static const char set[] = "\t\"<>\\";
+    scharset cs = scharset_of(sizeof(set) - 1, set);
+    sink += sfind_any_of(c->s, &cs);
+    return c->len;
+}
+
+/* Views are used so the result is not cached in the corpus string */
+static size_t run_sutf8_valid(corpus* c) {
+    sink += sutf8_valid_view((sview){c->s, c->len});
+    return c->len;
+}
+
+static size_t run_sutf8_count(corpus* c) {
+    sink += sutf8_count_view((sview){c->s, c->len});
+    return c->len;
+}
+
+static size_t run_sutf8_offset(corpus* c) {
+    sink += sutf8_offset_view((sview){c->s, c->len}, c->len / 2);
+    return c->len / 2;
+}
+
+static size_t run_sreplace(corpus* c) {
+    string s = sreplace(c->s, c->seplen, c->sep, 2, "\r\n");
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+/* The scratch string keeps the capacity of the first call, later ones rewrite in place */
+static size_t run_sreplace_inplace(corpus* c) {
+    string s = sreplace_inplace(restore(c), c->seplen, c->sep, 2, "\r\n");
+    if (s)
+        c->work = s;
+    sink += sgetlen(s);
+    return c->len;
+}
+
+static size_t run_spcompile(corpus* c) {
+    spattern* p = spcompile(c->nlen, c->needle);
+    sink += spgetlen(p);
+    spfree(p);
+    return c->nlen;
+}
+
+static size_t run_sfindp(corpus* c) {
+    sink += sfindp(c->s, c->pneedle);
+    return c->len;
+}
+
+static size_t run_srfindp(corpus* c) {
+    ssize_t hit = srfindp(c->s, c->pneedle);
+    sink += hit;
+    return hit < 0 ? c->len : c->len - hit;
+}
+
+static size_t run_scountp(corpus* c) {
+    sink += scountp(c->s, c->psep);
+    return c->len;
+}
+
+static size_t run_sremovep(corpus* c) {
+    sink += sremovep(restore(c), c->psep);
+    return c->len;
+}
+
+static size_t run_sbitep(corpus* c) {
+    string s = restore(c);
+    string piece;
+    while ((piece = sbitep(s, c->psep)) != NULL) {
+        sink += sgetlen(piece);
+        sfree(piece);
+    }
+    return c->len;
+}
+
+static size_t run_ssplitp(corpus* c) {
+    size_t n;
+    string* arr = ssplitp(c->s, c->psep, &n);
+    if (arr) {
+        sink += n;
+        sfreearr(arr, n);
+    }
+    return c->len;
+}
+
+static size_t run_sreplacep(corpus* c) {
+    string s = sreplacep(c->s, c->psep, 2, "\r\n");
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_smfind(corpus* c) {
+    size_t which;
+    sink += smfind(c->s, c->keywords, &which);
+    return c->len;
+}
+
+static size_t run_smfindall(corpus* c) {
+    sink += smfindall(c->s, c->keywords, NULL, 0);
+    return c->len;
+}
+
+static size_t run_smcount(corpus* c) {
+    size_t counts[6];
+    sink += smcount(c->s, c->keywords, counts);
+    return c->len;
+}
+
+static size_t run_shash_view(corpus* c) {
+    sink += shash_view(sview_of(c->s));
+    return c->len;
+}
+
+/* After the first call the hash comes from the slot */
+static size_t run_shash(corpus* c) {
+    sink += shash(c->hashed);
+    return c->len;
+}
+
+static size_t run_shashed(corpus* c) {
+    string s = shashed(snewlen(c->data, c->len));
+    sink += shash(s);
+    sfree(s);
+    return c->len;
+}
+
+/* Only one side has a cached hash, so the bytes are compared */
+static size_t run_sequal(corpus* c) {
+    sink += sequal(c->s, c->hashed);
+    return c->len;
+}
+
+/* Intern every piece twice: the first pass inserts, the second finds */
+static size_t run_sintern(corpus* c) {
+    sintab* it = sicreate(c->nparts);
+    for (size_t pass = 0; pass < 2; pass++)
+        for (size_t i = 0; i < c->nparts; i++)
+            sink += sgetlen(sintern(it, c->parts[i]));
+    sink += sicount(it);
+    sifree(it);
+    return 2 * c->len;
+}
+
+static size_t run_scatfmt(corpus* c) {
+    string s = snew("");
+    for (size_t i = 0; i < c->nparts && s; i++)
+        s = scatfmt(s, "%zu:%s;", i, c->parts[i]);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_scatu64(corpus* c) {
+    string s = snew("");
+    for (size_t i = 0; i < c->len / 8 && s; i++) {
+        s = scatu64(s, i * 2654435761u);
+        s = scatn(s, 1, &(sview){",", 1});
+    }
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+static size_t run_stou64(corpus* c) {
+    uint64_t total = 0, v;
+    const char* p = c->data;
+    const char* end = c->data + c->len;
+    while (p < end) {
+        size_t n = (unsigned char)(*p - '0') < 10 ? stou64_view((sview){p, end - p}, &v, NULL) : 0;
+        if (n) {
+            total += v;
+            p += n;
+        } else {
+            p++;
+        }
+    }
+    sink += total;
+    return c->len;
+}
+
+static size_t run_stoi64(corpus* c) {
+    int64_t total = 0, v;
+    const char* p = c->data;
+    const char* end = c->data + c->len;
+    while (p < end) {
+        size_t n = (unsigned char)(*p - '0') < 10 ? stoi64_view((sview){p, end - p}, &v, NULL) : 0;
+        if (n) {
+            total += v;
+            p += n;
+        } else {
+            p++;
+        }
+    }
+    sink += total;
+    return c->len;
+}
+
+static size_t run_stod(corpus* c) {
+    double total = 0, v;
+    const char* p = c->data;
+    const char* end = c->data + c->len;
+    while (p < end) {
+        size_t n = (unsigned char)(*p - '0') < 10 ? stod_view((sview){p, end - p}, &v, NULL) : 0;
+        if (n) {
+            total += v;
+            p += n;
+        } else {
+            p++;
+        }
+    }
+    sink += total;
+    return c->len;
+}
+
+/* Feed the corpus in STREAM_CHUNK pieces, as if it came from a socket */
+static size_t run_ssfeed(corpus* c) {
+    sstream* ss = sscreate(c->nlen, c->needle);
+    size_t hits[16];
+    for (size_t off = 0; off < c->len; off += STREAM_CHUNK) {
+        size_t n = c->len - off < STREAM_CHUNK ? c->len - off : STREAM_CHUNK;
+        sink += ssfeed(ss, c->data + off, n, hits, 16);
+    }
+    ssfree(ss);
+    return c->len;
+}
+
+static size_t run_sroinsert(corpus* c) {
+    srope* r = sronew(c->len, c->data);
+    for (size_t i = 0; i < 64 && r; i++)
+        r = sroinsert(r, i * c->len / 64, c->nlen, c->needle);
+    sink += srolen(r);
+    srofree(r);
+    return c->len;
+}
+
+/* Build a rope from the pieces, one leaf each */
+static size_t run_srocat(corpus* c) {
+    srope* r = sronew(0, NULL);
+    for (size_t i = 0; i < c->nparts && r; i++)
+        r = srocat(r, sronew(sgetlen(c->parts[i]), c->parts[i]));
+    sink += srolen(r);
+    srofree(r);
+    return c->len;
+}
+
+static size_t run_sroerase(corpus* c) {
+    srope* r = sroerase(srodup(c->rope), c->len / 4, c->len - c->len / 4);
+    sink += srolen(r);
+    srofree(r);
+    return c->len;
+}
+
+static size_t run_sroslice(corpus* c) {
+    srope* r = sroslice(c->rope, c->len / 4, c->len - c->len / 4);
+    sink += srolen(r);
+    srofree(r);
+    return c->len / 2;
+}
+
+static size_t run_srofind(corpus* c) {
+    sink += srofind(c->rope, c->nlen, c->needle);
+    return c->len;
+}
+
+static size_t run_srocount(corpus* c) {
+    sink += srocount(c->rope, c->seplen, c->sep);
+    return c->len;
+}
+
+static size_t run_sroflatten(corpus* c) {
+    string s = sroflatten(c->rope);
+    sink += sgetlen(s);
+    sfree(s);
+    return c->len;
+}
+
+/* libc baselines */
+
+static size_t run_strdup(corpus* c) {
+    char* s = strdup(c->data);
+    sink += s[0];
+    free(s);
+    return c->len;
+}
+
+static size_t run_malloc_memcpy(corpus* c) {
+    char* s = malloc(c->len + 1);
+    memcpy(s, c->data, c->len + 1);
+    sink += s[0];
+    free(s);
+    return c->len;
+}
+
+static size_t run_read_file(corpus* c) {
+    int fd = open(c->path, O_RDONLY);
+    if (fd < 0)
+        return c->len;
+    char* buf = malloc(c->len + 1);
+    size_t got = 0;
+    ssize_t n;
+    while (buf && got < c->len && (n = read(fd, buf + got, c->len - got)) > 0)
+        got += n;
+    close(fd);
+    if (buf)
+        sink += scount_view((sview){buf, got}, c->seplen, c->sep);
+    free(buf);
+    return c->len;
+}
+
+static size_t run_strlen(corpus* c) {
+    sink += strlen(c->data);
+    return c->len;
+}
+
+static size_t run_join_strlen(corpus* c) {
+    size_t total = 0;
+    for (size_t i = 0; i < c->nparts; i++)
+        total += strlen(c->cparts[i]) + c->seplen;
+    char* s = malloc(total + 1);
+    char* p = s;
+    for (size_t i = 0; i < c->nparts; i++) {
+        size_t len = strlen(c->cparts[i]);
+        memcpy(p, c->cparts[i], len);
+        p += len;
+        memcpy(p, c->sep, c->seplen);
+        p += c->seplen;
+    }
+    *p = 0;
+    sink += s[0];
+    free(s);
+    return c->len;
+}
+
+static size_t run_strcat(corpus* c) {
+    char* s = malloc(2 * c->len + 1);
+    strcpy(s, c->data);
+    strcat(s, c->data);
+    sink += s[0];
+    free(s);
+    return 2 * c->len;
+}
+
+static size_t run_realloc_append(corpus* c) {
+    char* s = NULL;
+    size_t len = 0;
+    for (size_t i = 0; i < c->nparts; i++) {
+        size_t plen = strlen(c->cparts[i]);
+        if (!plen)
+            continue;
+        s = realloc(s, len + plen + 1);
+        memcpy(s + len, c->cparts[i], plen + 1);
+        len += plen;
+    }
+    sink += len;
+    free(s);
+    return c->len;
+}
+
+static size_t run_realloc_shrink(corpus* c) {
+    char* s = malloc(2 * c->len + 1);
+    memcpy(s, c->data, c->len + 1);
+    char* shrunk = realloc(s, c->len + 1);
+    if (shrunk)
+        s = shrunk;
+    sink += s[0];
+    free(s);
+    return c->len;
+}
+
+static size_t run_toupper(corpus* c) {
+    string s = restore(c);
+    for (size_t i = 0; i < c->len; i++)
+        s[i] = toupper((unsigned char)s[i]);
+    sink += s[0];
+    return c->len;
+}
+
+static size_t run_tolower(corpus* c) {
+    string s = restore(c);
+    for (size_t i = 0; i < c->len; i++)
+        s[i] = tolower((unsigned char)s[i]);
+    sink += s[0];
+    return c->len;
+}
+
+static size_t run_strncmp(corpus* c) {
+    sink += strncmp(c->data, c->needle, c->nlen) == 0;
+    return c->nlen;
+}
+
+static size_t run_memcmp_end(corpus* c) {
+    sink += c->nlen <= c->len && memcmp(c->data + c->len - c->nlen, c->needle, c->nlen) == 0;
+    return c->nlen;
+}
+
+static size_t run_memmem(corpus* c) {
+    char* hit = memmem(c->data, c->len, c->needle, c->nlen);
+    sink += hit ? (size_t)(hit - c->data) : 0;
+    return c->len;
+}
+
+static size_t run_strstr(corpus* c) {
+    char* hit = strstr(c->data, c->needle);
+    sink += hit ? (size_t)(hit - c->data) : 0;
+    return c->len;
+}
+
+static size_t run_memrchr(corpus* c) {
+    const char* end = c->data + c->len;
+    const char* hit;
+    /* Reverse memmem: step back over candidate first bytes */
+    while ((hit = memrchr(c->data, c->needle[0], end - c->data)) != NULL) {
+        if ((size_t)(c->data + c->len - hit) >= c->nlen && memcmp(hit, c->needle, c->nlen) == 0)
+            break;
+        end = hit;
+    }
+    sink += hit ? (size_t)(hit - c->data) : 0;
+    return hit ? (size_t)(c->data + c->len - hit) : c->len;
+}
+
+static size_t run_memmem_count(corpus* c) {
+    size_t count = 0;
+    const char* cur = c->data;
+    const char* end = c->data + c->len;
+    while ((cur = memmem(cur, end - cur, c->sep, c->seplen)) != NULL) {
+        count++;
+        cur++;
+    }
+    sink += count;
+    return c->len;
+}
+
+static size_t run_memmem_remove(corpus* c) {
+    string s = restore(c);
+    char* out = s;
+    const char* cur = s;
+    const char* end = s + c->len;
+    const char* hit;
+    while ((hit = memmem(cur, end - cur, c->sep, c->seplen)) != NULL) {
+        memmove(out, cur, hit - cur);
+        out += hit - cur;
+        cur = hit + c->seplen;
+    }
+    memmove(out, cur, end - cur);
+    out += end - cur;
+    *out = 0;
+    sink += out - s;
+    return c->len;
+}
+
+static size_t run_strndup(corpus* c) {
+    char* s = strndup(c->data + c->len / 4, c->len - c->len / 2);
+    sink += s[0];
+    free(s);
+    return c->len / 2;
+}
+
+/* Record the pieces between separators as pointer and length pairs */
+static size_t run_memmem_views(corpus* c) {
+    struct { const char* ptr; size_t len; }* views = malloc(c->nparts * sizeof(*views));
+    if (!views)
+        return c->len;
+    size_t n = 0;
+    const char* cur = c->data;
+    const char* end = c->data + c->len;
+    const char* hit;
+    while (n + 1 < c->nparts && (hit = memmem(cur, end - cur, c->sep, c->seplen)) != NULL) {
+        views[n].ptr = cur;
+        views[n++].len = hit - cur;
+        cur = hit + c->seplen;
+    }
+    views[n].ptr = cur;
+    views[n++].len = end - cur;
+    sink += n;
+    free(views);
+    return c->len;
+}
+
+static size_t run_strtok(corpus* c) {
+    string s = restore(c);
+    char* save;
+    size_t n = 0;
+    for (char* tok = strtok_r(s, c->sep, &save); tok; tok = strtok_r(NULL, c->sep, &save)) {
+        char* copy = strdup(tok);
+        n += copy[0];
+        free(copy);
+    }
+    sink += n;
+    return c->len;
+}
+
+static size_t run_strdup_parts(corpus* c) {
+    char** copies = malloc(c->nparts * sizeof(char*));
+    if (!copies)
+        return c->len;
+    for (size_t i = 0; i < c->nparts; i++) {
+        copies[i] = strdup(c->cparts[i]);
+        sink += copies[i][0];
+    }
+    for (size_t i = 0; i < c->nparts; i++)
+        free(copies[i]);
+    free(copies);
+    return c->len;
+}
+
+static size_t run_strspn(corpus* c) {
+    string s = restore(c);
+    size_t skip = strspn(s, "0123456789-: ");
+    memmove(s, s + skip, c->len - skip + 1);
+    sink += skip;
+    return c->len;
+}
+
+static size_t run_strcspn(corpus* c) {
+    sink += strcspn(c->data, "\t\"<>\\");
+    return c->len;
+}
+
+static size_t run_strspn_trim(corpus* c) {
+    static const char set[] = "0123456789-: \n";
+    string s = restore(c);
+    size_t skip = strspn(s, set);
+    size_t end = c->len;
+    while (end > skip && strchr(set, s[end - 1]))
+        end--;
+    memmove(s, s + skip, end - skip);
+    s[end - skip] = 0;
+    sink += end - skip;
+    return c->len;
+}
+
+static size_t run_strchr_rtrim(corpus* c) {
+    static const char set[] = "0123456789-: \n";
+    string s = restore(c);
+    size_t end = c->len;
+    while (end > 0 && strchr(set, s[end - 1]))
+        end--;
+    s[end] = 0;
+    sink += end;
+    return c->len;
+}
+
+static size_t run_strspn_all(corpus* c) {
+    char set[97];
+    printable(set);
+    sink += strspn(c->data, set);
+    return c->len;
+}
+
+static size_t run_strpbrk(corpus* c) {
+    char* hit = strpbrk(c->data, "\t\"<>\\");
+    sink += hit ? (size_t)(hit - c->data) : 0;
+    return c->len;
+}
+
+static size_t run_strstr_replace(corpus* c) {
+    size_t count = 0;
+    for (const char* p = c->data; (p = strstr(p, c->sep)) != NULL; p += c->seplen)
+        count++;
+    char* out = malloc(c->len + count * 2 + 1);
+    char* o = out;
+    const char* p = c->data;
+    const char* hit;
+    while ((hit = strstr(p, c->sep)) != NULL) {
+        memcpy(o, p, hit - p);
+        o += hit - p;
+        memcpy(o, "\r\n", 2);
+        o += 2;
+        p = hit + c->seplen;
+    }
+    strcpy(o, p);
+    sink += out[0];
+    free(out);
+    return c->len;
+}
+
+static size_t run_memmem_keywords(corpus* c) {
+    static const char* keys[] = {"ERROR", "timeout", "status=503", "user", "cache=miss", "needle-x7"};
+    size_t total = 0;
+    for (size_t i = 0; i < 6; i++) {
+        size_t klen = strlen(keys[i]);
+        const char* cur = c->data;
+        const char* end = c->data + c->len;
+        while ((cur = memmem(cur, end - cur, keys[i], klen)) != NULL) {
+            total++;
+            cur++;
+        }
+    }
+    sink += total;
+    return c->len;
+}
+
+static size_t run_memcmp_equal(corpus* c) {
+    sink += sgetlen(c->hashed) == c->len && memcmp(c->data, c->hashed, c->len) == 0;
+    return c->len;
+}
+
+static int cmp_key(const void* a, const void* b) {
+    return strcmp(a, b);
+}
+
+static size_t run_tsearch(corpus* c) {
+    void* root = NULL;
+    for (size_t pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < c->nparts; i++) {
+            char** found = tfind(c->cparts[i], &root, cmp_key);
+            if (!found)
+                found = tsearch(strdup(c->cparts[i]), &root, cmp_key);
+            sink += strlen(*found);
+        }
+    }
+    tdestroy(root, free);
+    return 2 * c->len;
+}
+
+static size_t run_snprintf_append(corpus* c) {
+    size_t cap = 64, len = 0;
+    char* buf = malloc(cap);
+    for (size_t i = 0; i < c->len / 8 && buf; i++) {
+        char tmp[24];
+        int n = snprintf(tmp, sizeof(tmp), "%zu,", (size_t)(i * 2654435761u));
+        if (len + n + 1 > cap) {
+            char* grown = realloc(buf, cap * 2);
+            if (!grown) break;
+            buf = grown;
+            cap *= 2;
+        }
+        memcpy(buf + len, tmp, n + 1);
+        len += n;
+    }
+    sink += len;
+    free(buf);
+    return c->len;
+}
+
+static size_t run_strtoull(corpus* c) {
+    unsigned long long total = 0;
+    const char* p = c->data;
+    const char* end = c->data + c->len;
+    while (p < end) {
+        char* next = (char*)p;
+        if ((unsigned char)(*p - '0') < 10)
+            total += strtoull(p, &next, 10);
+        p = next > p ? next : p + 1;
+    }
+    sink += total;
+    return c->len;
+}
+
+static size_t run_strtoll(corpus* c) {
+    long long total = 0;
+    const char* p = c->data;
+    const char* end = c->data + c->len;
+    while (p < end) {
+        char* next = (char*)p;
+        if ((unsigned char)(*p - '0') < 10)
+            total += strtoll(p, &next, 10);
+        p = next > p ? next : p + 1;
+    }
+    sink += total;
+    return c->len;
+}
+
+static size_t run_strtod(corpus* c) {
+    double total = 0;
+    const char* p = c->data;
+    const char* end = c->data + c->len;
+    while (p < end) {
+        char* next = (char*)p;
+        if ((unsigned char)(*p - '0') < 10)
+            total += strtod(p, &next);
+        p = next > p ? next : p + 1;
+    }
+    sink += total;
+    return c->len;
+}
+
+/* Search each chunk behind the last nlen - 1 bytes of the previous one */
+static size_t run_memmem_chunks(corpus* c) {
+    char* buf = malloc(c->nlen + STREAM_CHUNK);
+    if (!buf)
+        return c->len;
+    size_t keep = 0, count = 0;
+    for (size_t off = 0; off < c->len; off += STREAM_CHUNK) {
+        size_t n = c->len - off < STREAM_CHUNK ? c->len - off : STREAM_CHUNK;
+        memcpy(buf + keep, c->data + off, n);
+        size_t total = keep + n;
+        for (const char* p = buf; (p = memmem(p, buf + total - p, c->needle, c->nlen)) != NULL; p++)
+            count++;
+        keep = total < c->nlen - 1 ? total : c->nlen - 1;
+        memmove(buf, buf + total - keep, keep);
+    }
+    sink += count;
+    free(buf);
+    return c->len;
+}
+
+static size_t run_memmove_insert(corpus* c) {
+    size_t len = c->len;
+    char* buf = malloc(len + 1);
+    memcpy(buf, c->data, len);
+    for (size_t i = 0; i < 64 && buf; i++) {
+        size_t at = i * c->len / 64;
+        char* grown = realloc(buf, len + c->nlen + 1);
+        if (!grown) break;
+        buf = grown;
+        memmove(buf + at + c->nlen, buf + at, len - at);
+        memcpy(buf + at, c->needle, c->nlen);
+        len += c->nlen;
+    }
+    sink += len;
+    free(buf);
+    return c->len;
+}
+
+static size_t run_memmove_erase(corpus* c) {
+    string s = restore(c);
+    size_t start = c->len / 4, end = c->len - c->len / 4;
+    memmove(s + start, s + end, c->len - end + 1);
+    sink += s[0];
+    return c->len;
+}
+
+static const bench benches[] = {
+    {"snew/sfree", "safe_string", NULL, false, run_snew, 0},
+    {"snewlen/sfree", "safe_string", NULL, false, run_snewlen, 0},
+    {"sdup", "safe_string", NULL, false, run_sdup, 0},
+    {"sshare/sfree", "safe_string", NULL, false, run_sshare, 0},
+    {"sdup(shared)/sfree", "safe_string", NULL, false, run_sdup_shared, 0},
+    {"sretain/sunshare", "safe_string", NULL, false, run_sunshare, 0},
+    {"smapfile/scount", "safe_string", NULL, false, run_smapfile, 0},
+    {"sgetlen/supdatelen", "safe_string", NULL, false, run_sgetlen, 0},
+    {"sjoin", "safe_string", NULL, false, run_sjoin, 0},
+    {"sjoins", "safe_string", NULL, false, run_sjoins, 0},
+    {"sjoinv", "safe_string", NULL, false, run_sjoinv, 0},
+    {"scatc", "safe_string", NULL, false, run_scatc, 0},
+    {"scats", "safe_string", NULL, false, run_scats, 0},
+    {"scat", "safe_string", NULL, false, run_scat, 0},
+    {"sreserve/scat", "safe_string", NULL, false, run_sreserve, 0},
+    {"sshrink_to_fit", "safe_string", NULL, false, run_sshrink_to_fit, 0},
+    {"sclear/scat", "safe_string", NULL, false, run_sclear, 0},
+    {"supper", "safe_string", NULL, false, run_supper, 0},
+    {"slower", "safe_string", NULL, false, run_slower, 0},
+    {"supper_ascii", "safe_string", NULL, false, run_supper_ascii, 0},
+    {"slower_ascii", "safe_string", NULL, false, run_slower_ascii, 0},
+    {"sstartswith", "safe_string", NULL, false, run_sstartswith, 0},
+    {"sendswith", "safe_string", NULL, false, run_sendswith, 0},
+    {"sfind", "safe_string", NULL, true, run_sfind, 0},
+    {"sfind_advanced", "safe_string", NULL, true, run_sfind_advanced, 0},
+    {"srfind", "safe_string", NULL, false, run_srfind, 0},
+    {"scount", "safe_string", NULL, true, run_scount, 0},
+    {"sfind_parallel", "safe_string", NULL, true, run_sfind_parallel, 0},
+    {"scount_parallel", "safe_string", NULL, true, run_scount_parallel, 0},
+    {"sfind_view", "safe_string", NULL, true, run_sfind_view, 0},
+    {"sslice_view", "safe_string", NULL, false, run_sslice_view, 0},
+    {"ssplit_views", "safe_string", NULL, false, run_ssplit_views, 0},
+    {"strim", "safe_string", NULL, false, run_strim, 0},
+    {"sremove", "safe_string", NULL, false, run_sremove, 0},
+    {"sslice", "safe_string", NULL, false, run_sslice, 0},
+    {"sbite", "safe_string", NULL, false, run_sbite, 64 << 10},
+    {"stok_next", "safe_string", NULL, false, run_stok, 0},
+    {"ssplit/sfreearr", "safe_string", NULL, false, run_ssplit, 0},
+    {"sacreate/sasplit", "safe_string", NULL, false, run_sasplit, 0},
+    {"sacreate/sanew", "safe_string", NULL, false, run_sanew, 0},
+    {"ssplit_array", "safe_string", NULL, false, run_ssplit_array, 0},
+    {"sarrnew/sarrpush", "safe_string", NULL, false, run_sarrpush, 0},
+    {"sjoin_array", "safe_string", NULL, false, run_sjoin_array, 0},
+    {"sltrimchar", "safe_string", NULL, false, run_sltrimchar, 0},
+    {"scspn", "safe_string", NULL, false, run_scspn, 0},
+    {"strimchars", "safe_string", NULL, false, run_strimchars, 0},
+    {"srtrimchars", "safe_string", NULL, false, run_srtrimchars, 0},
+    {"sspn", "safe_string", NULL, false, run_sspn, 0},
+    {"sfind_any_of", "safe_string", NULL, false, run_sfind_any_of, 0},
+    {"sutf8_valid_view", "safe_string", NULL, false, run_sutf8_valid, 0},
+    {"sutf8_count_view", "safe_string", NULL, false, run_sutf8_count, 0},
+    {"sutf8_offset_view", "safe_string", NULL, false, run_sutf8_offset, 0},
+    {"sreplace", "safe_string", NULL, false, run_sreplace, 0},
+    {"sreplace_inplace", "safe_string", NULL, false, run_sreplace_inplace, 0},
+    {"spcompile/spfree", "safe_string", NULL, false, run_spcompile, 0},
+    {"sfindp", "safe_string", NULL, true, run_sfindp, 0},
+    {"srfindp", "safe_string", NULL, false, run_srfindp, 0},
+    {"scountp", "safe_string", NULL, true, run_scountp, 0},
+    {"sremovep", "safe_string", NULL, false, run_sremovep, 0},
+    {"sbitep", "safe_string", NULL, false, run_sbitep, 64 << 10},
+    {"ssplitp", "safe_string", NULL, false, run_ssplitp, 0},
+    {"sreplacep", "safe_string", NULL, false, run_sreplacep, 0},
+    {"smfind", "safe_string", NULL, false, run_smfind, 0},
+    {"smfindall", "safe_string", NULL, false, run_smfindall, 0},
+    {"smcount", "safe_string", NULL, false, run_smcount, 0},
+    {"shash_view", "safe_string", NULL, false, run_shash_view, 0},
+    {"shash", "safe_string", NULL, false, run_shash, 0},
+    {"shashed/shash", "safe_string", NULL, false, run_shashed, 0},
+    {"sequal", "safe_string", NULL, false, run_sequal, 0},
+    {"sicreate/sintern", "safe_string", NULL, false, run_sintern, 0},
+    {"scatfmt", "safe_string", NULL, false, run_scatfmt, 0},
+    {"scatu64/scatn", "safe_string", NULL, false, run_scatu64, 0},
+    {"stou64_view", "safe_string", NULL, false, run_stou64, 0},
+    {"stoi64_view", "safe_string", NULL, false, run_stoi64, 0},
+    {"stod_view", "safe_string", NULL, false, run_stod, 0},
+    {"sscreate/ssfeed", "safe_string", NULL, true, run_ssfeed, 0},
+    {"sronew/sroinsert", "safe_string", NULL, false, run_sroinsert, 0},
+    {"sronew/srocat", "safe_string", NULL, false, run_srocat, 0},
+    {"srodup/sroerase", "safe_string", NULL, false, run_sroerase, 0},
+    {"sroslice", "safe_string", NULL, false, run_sroslice, 0},
+    {"srofind", "safe_string", NULL, true, run_srofind, 0},
+    {"srocount", "safe_string", NULL, true, run_srocount, 0},
+    {"sroflatten", "safe_string", NULL, false, run_sroflatten, 0},
+
+    {"strdup", "libc", "snew/sfree", false, run_strdup, 0},
+    {"malloc+memcpy", "libc", "snewlen/sfree", false, run_malloc_memcpy, 0},
+    {"malloc+memcpy", "libc", "sshare/sfree", false, run_malloc_memcpy, 0},
+    {"strdup", "libc", "sdup(shared)/sfree", false, run_strdup, 0},
+    {"malloc+memcpy", "libc", "sretain/sunshare", false, run_malloc_memcpy, 0},
+    {"read+scount_view", "libc", "smapfile/scount", false, run_read_file, 0},
+    {"strlen", "libc", "sgetlen/supdatelen", false, run_strlen, 0},
+    {"strlen+memcpy", "libc", "sjoin", false, run_join_strlen, 0},
+    {"strcpy+strcat", "libc", "scatc", false, run_strcat, 0},
+    {"realloc+memcpy", "libc", "scat", false, run_realloc_append, 0},
+    {"realloc+memcpy", "libc", "sreserve/scat", false, run_realloc_append, 0},
+    {"malloc+realloc", "libc", "sshrink_to_fit", false, run_realloc_shrink, 0},
+    {"realloc+memcpy", "libc", "sclear/scat", false, run_realloc_append, 0},
+    {"toupper", "libc", "supper", false, run_toupper, 0},
+    {"tolower", "libc", "slower", false, run_tolower, 0},
+    {"strncmp", "libc", "sstartswith", false, run_strncmp, 0},
+    {"memcmp", "libc", "sendswith", false, run_memcmp_end, 0},
+    {"memmem", "libc", "sfind", true, run_memmem, 0},
+    {"strstr", "libc", "sfind", true, run_strstr, 0},
+    {"memrchr", "libc", "srfind", false, run_memrchr, 0},
+    {"memmem_count", "libc", "scount", true, run_memmem_count, 0},
+    {"memmem_remove", "libc", "sremove", false, run_memmem_remove, 0},
+    {"memmem", "libc", "sfind_view", true, run_memmem, 0},
+    {"strndup", "libc", "sslice", false, run_strndup, 0},
+    {"strndup", "libc", "sslice_view", false, run_strndup, 0},
+    {"memmem_views", "libc", "ssplit_views", false, run_memmem_views, 0},
+    {"strtok_r+strdup", "libc", "ssplit/sfreearr", false, run_strtok, 0},
+    {"strtok_r+strdup", "libc", "sacreate/sasplit", false, run_strtok, 0},
+    {"strdup/free", "libc", "sacreate/sanew", false, run_strdup_parts, 0},
+    {"strtok_r+strdup", "libc", "ssplit_array", false, run_strtok, 0},
+    {"strdup/free", "libc", "sarrnew/sarrpush", false, run_strdup_parts, 0},
+    {"strlen+memcpy", "libc", "sjoin_array", false, run_join_strlen, 0},
+    {"strspn+memmove", "libc", "sltrimchar", false, run_strspn, 0},
+    {"strcspn", "libc", "scspn", false, run_strcspn, 0},
+    {"strspn+memmove", "libc", "strimchars", false, run_strspn_trim, 0},
+    {"strchr", "libc", "srtrimchars", false, run_strchr_rtrim, 0},
+    {"strspn", "libc", "sspn", false, run_strspn_all, 0},
+    {"strpbrk", "libc", "sfind_any_of", false, run_strpbrk, 0},
+    {"strstr_replace", "libc", "sreplace", false, run_strstr_replace, 0},
+    {"strstr_replace", "libc", "sreplace_inplace", false, run_strstr_replace, 0},
+    {"memmem_keywords", "libc", "smcount", false, run_memmem_keywords, 0},
+    {"memcmp", "libc", "sequal", false, run_memcmp_equal, 0},
+    {"tsearch+strdup", "libc", "sicreate/sintern", false, run_tsearch, 0},
+    {"snprintf+memcpy", "libc", "scatu64/scatn", false, run_snprintf_append, 0},
+    {"strtoull", "libc", "stou64_view", false, run_strtoull, 0},
+    {"strtoll", "libc", "stoi64_view", false, run_strtoll, 0},
+    {"strtod", "libc", "stod_view", false, run_strtod, 0},
+    {"memmem_chunks", "libc", "sscreate/ssfeed", true, run_memmem_chunks, 0},
+    {"realloc+memmove", "libc", "sronew/sroinsert", false, run_memmove_insert, 0},
+    {"realloc+memcpy", "libc", "sronew/srocat", false, run_realloc_append, 0},
+    {"memmove", "libc", "srodup/sroerase", false, run_memmove_erase, 0},
+    {"strndup", "libc", "sroslice", false, run_strndup, 0},
+    {"memmem", "libc", "srofind", true, run_memmem, 0},
+    {"memmem_count", "libc", "srocount", true, run_memmem_count, 0},
+    {"malloc+memcpy", "libc", "sroflatten", false, run_malloc_memcpy, 0},
+};
+#define BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+    Warm up for WARMUP_NS, size a batch to take at least BATCH_NS and
+    return the median time per call over REPETITIONS batches.
+*/
+static double measure(const bench* b, corpus* c, size_t* bytes) {
+    uint64_t start = now_ns();
+    size_t iters = 0;
+    do {
+        *bytes = b->run(c);
+        iters++;
+    } while (now_ns() - start < WARMUP_NS);
+
+    uint64_t per_call = (now_ns() - start) / iters + 1;
+    size_t batch = BATCH_NS / per_call + 1;
+
+    double samples[REPETITIONS];
+    for (size_t r = 0; r < REPETITIONS; r++) {
+        uint64_t t0 = now_ns();
+        for (size_t i = 0; i < batch; i++)
+            b->run(c);
+        samples[r] = (double)(now_ns() - t0) / batch;
+    }
+    qsort(samples, REPETITIONS, sizeof(double), cmp_double);
+    return samples[REPETITIONS / 2];
+}
+
+int main(int argc, char** argv) {
+    bool quick = false;
+    const char* filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--filter name]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static const struct { const char* kind; size_t len; } corpora[] = {
+        {"log", 64}, {"random", 64},
+        {"log", 4096}, {"random", 4096},
+        {"log", 64 << 10},
+        {"log", 1 << 20}, {"random", 1 << 20}, {"adversarial", 1 << 20},
+        {"log", 16 << 20}, {"random", 16 << 20},
+    };
+
+    printf("{\n  \"suite\": \"safe_string\",\n  \"seed\": %llu,\n  \"results\": [", (unsigned long long)SEED);
+    bool first = true;
+    for (size_t k = 0; k < sizeof(corpora) / sizeof(corpora[0]); k++) {
+        if (quick && corpora[k].len > (64 << 10))
+            continue;
+        corpus c;
+        if (!corpus_init(&c, corpora[k].kind, corpora[k].len)) {
+            fprintf(stderr, "failed to build %s corpus of %zu bytes\n", corpora[k].kind, corpora[k].len);
+            return 1;
+        }
+        bool adversarial = strcmp(c.kind, "adversarial") == 0;
+        for (size_t i = 0; i < BENCHES; i++) {
+            const bench* b = &benches[i];
+            if (filter && !strstr(b->name, filter) && !(b->compare && strstr(b->compare, filter)))
+                continue;
+            if (adversarial && !b->search_only)
+                continue;
+            if (b->max_len && c.len > b->max_len)
+                continue;
+            size_t bytes;
+            double ns = measure(b, &c, &bytes);
+            printf("%s\n    {\"name\": \"%s\", \"impl\": \"%s\", \"baseline_for\": %s%s%s, "
+                   "\"corpus\": \"%s\", \"size\": %zu, \"ns_per_op\": %.1f, \"gb_per_s\": %.3f}",
+                   first ? "" : ",", b->name, b->impl,
+                   b->compare ? "\"" : "", b->compare ? b->compare : "null", b->compare ? "\"" : "",
+                   c.kind, c.len, ns, bytes / ns);
+            first = false;
+            fflush(stdout);
+        }
+        corpus_free(&c);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
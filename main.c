@@ -4,6 +4,10 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <time.h>
+#include <ctype.h>
+#include <locale.h>
+#include <pthread.h>
+#include <math.h>
 
 int test_count = 0;
 int fail_count = 0;
@@ -362,6 +366,54 @@ void test_slower_weird_strings(void) {
     sfree(b);
 }
 
+void test_supper_ascii_as_intended(void) {
+    assert_equal(supper_ascii(NULL) == false, "Must be false", __func__);
+    assert_equal(slower_ascii(NULL) == false, "Must be false 2", __func__);
+
+    char all[256];
+    char upper[256];
+    char lower[256];
+    for (int i = 0; i < 256; i++) {
+        all[i] = (char)i;
+        upper[i] = (char)(i >= 'a' && i <= 'z' ? i - 32 : i);
+        lower[i] = (char)(i >= 'A' && i <= 'Z' ? i + 32 : i);
+    }
+    /* Every offset, so each byte value lands in the vector body and the tail */
+    for (size_t off = 0; off < 64; off++) {
+        string s = snewlen(all + off, 256 - off);
+        assert_equal(supper_ascii(s), "Must work", __func__);
+        assert_equal(memcmp(s, upper + off, 256 - off) == 0, "Only a-z must change", __func__);
+        assert_equal(slower_ascii(s), "Must work 2", __func__);
+        assert_equal(memcmp(s, lower + off, 256 - off) == 0, "Only A-Z must change", __func__);
+        assert_equal(s[256 - off] == 0, "Must be null-terminated", __func__);
+        sfree(s);
+    }
+
+    string h = snew("Content-Type: Text/HTML; Charset=UTF-8\r\nX-Forwarded-For: 10.0.0.1");
+    slower_ascii(h);
+    assert_equal(strcmp(h, "content-type: text/html; charset=utf-8\r\nx-forwarded-for: 10.0.0.1") == 0,
+                 "Must lower a header", __func__);
+    sfree(h);
+}
+
+void test_supper_follows_locale(void) {
+    if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+        return;
+    char all[256];
+    for (int i = 0; i < 256; i++)
+        all[i] = (char)i;
+    string u = snewlen(all, 256);
+    string l = snewlen(all, 256);
+    assert_equal(supper(u) && slower(l), "Must work", __func__);
+    for (int i = 0; i < 256; i++) {
+        assert_equal((unsigned char)u[i] == toupper(i), "Must match toupper", __func__);
+        assert_equal((unsigned char)l[i] == tolower(i), "Must match tolower", __func__);
+    }
+    sfree(u);
+    sfree(l);
+    setlocale(LC_CTYPE, "C");
+}
+
 void test_sstartswith_null_input(void) {
     string s = snew("abcdefghij");
     assert_equal(s != NULL, "String must not be NULL", __func__);
@@ -454,6 +506,65 @@ void test_sfind_invalid_len(void) {
     sfree(s);
 }
 
+void test_sfind_block_boundaries(void) {
+    char buf[300];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = 'a' + i % 3;
+    string s = snewlen(buf, sizeof(buf));
+    const char* pattern = "xyzzy";
+    size_t hits[] = {0, 15, 31, 47, 63, 100, 127, 200, 250, 295};
+    size_t nhits = sizeof(hits) / sizeof(hits[0]);
+    for (size_t i = 0; i < nhits; i++)
+        memcpy(s + hits[i], pattern, 5);
+
+    ssize_t first = sfind(s, 5, pattern);
+    assert_equal(first == 0, "First match must be at 0", __func__);
+    ssize_t last = srfind(s, 5, pattern);
+    assert_equal(last == 295, "Last match must be at 295", __func__);
+    assert_equal(scount(s, 5, pattern) == (ssize_t)nhits, "Every match must be counted", __func__);
+    assert_equal(scount(s, 1, "x") == (ssize_t)nhits, "Every byte must be counted", __func__);
+
+    memcpy(s, "abc", 3);
+    assert_equal(sfind(s, 5, pattern) == 15, "Second match must be found", __func__);
+    memcpy(s + 295, "abcab", 5);
+    assert_equal(srfind(s, 5, pattern) == 250, "Second last match must be found", __func__);
+    assert_equal(scount(s, 2, "zz") == (ssize_t)nhits - 2, "Short pattern must be counted", __func__);
+    assert_equal(sfind(s, 5, "xyzzz") == -1, "Pattern must not be found", __func__);
+    sfree(s);
+}
+
+void test_sfind_advanced_as_intended(void) {
+    string s = snew("abcdefghij");
+    assert_equal(sfind_advanced(s, 1, "j") == 9, "Pattern must be found 0", __func__);
+    assert_equal(sfind_advanced(s, 3, "abc") == 0, "Pattern must be found 1", __func__);
+    assert_equal(sfind_advanced(s, 3, "hij") == 7, "Pattern must be found 2", __func__);
+    assert_equal(sfind_advanced(s, 10, "abcdefghij") == 0, "Pattern must be found 3", __func__);
+    assert_equal(sfind_advanced(s, 2, "lo") == -1, "Pattern must not be found", __func__);
+    assert_equal(sfind_advanced(NULL, 2, "lo") == -1, "NULL must fail", __func__);
+    assert_equal(sfind_advanced(s, 0, "") == -1, "Empty pattern must fail", __func__);
+    sfree(s);
+
+    string p = snew("abaabaabaabbabaabaabaab");
+    assert_equal(sfind_advanced(p, 6, "abaabb") == 6, "Periodic pattern must be found", __func__);
+    assert_equal(sfind_advanced(p, 9, "abaabaaba") == 0, "Periodic pattern must be found 2", __func__);
+    assert_equal(sfind_advanced(p, 8, "baabaabb") == 4, "Periodic pattern must be found 3", __func__);
+    assert_equal(sfind_advanced(p, 5, "aabbb") == -1, "Periodic pattern must not be found", __func__);
+    sfree(p);
+
+    char buf[4096];
+    memset(buf, 'a', sizeof(buf));
+    string a = snewlen(buf, sizeof(buf));
+    char pattern[64];
+    memset(pattern, 'a', sizeof(pattern));
+    pattern[63] = 'b';
+    assert_equal(sfind_advanced(a, 64, pattern) == -1, "Adversarial pattern must not be found", __func__);
+    assert_equal(sfind(a, 64, pattern) == -1, "Adversarial pattern must not be found 2", __func__);
+    a[4095] = 'b';
+    assert_equal(sfind_advanced(a, 64, pattern) == 4032, "Adversarial pattern must be found", __func__);
+    assert_equal(sfind(a, 64, pattern) == 4032, "Adversarial pattern must be found 2", __func__);
+    sfree(a);
+}
+
 void test_sfind_time(void) {
     int val = 200000000;
     int other = val - 100;
@@ -841,6 +952,1375 @@ void test_sreplace_as_intended(void) {
     sfree(something);
 }
 
+void test_sreplace_growing(void) {
+    string s = snew("{x} and {x}, {x}");
+    string res = sreplace(s, 3, "{x}", 6, "value!");
+    assert_equal(strcmp(res, "value! and value!, value!") == 0, "Must replace every match", __func__);
+    assert_equal(sgetlen(res) == 25, "Length must be exact", __func__);
+    sfree(res);
+    res = sreplace(s, 3, "{y}", 1, "z");
+    assert_equal(strcmp(res, s) == 0, "Must copy when nothing matches", __func__);
+    sfree(res);
+    assert_equal(sreplace(s, 3, "{x}", 1, NULL) == NULL, "Must fail on NULL replacement", __func__);
+    sfree(s);
+}
+
+void test_sreplace_inplace_invalid_input(void) {
+    assert_equal(sreplace_inplace(NULL, 1, "a", 1, "b") == NULL, "Must fail on NULL string", __func__);
+    string s = snew("abc");
+    assert_equal(sreplace_inplace(s, 0, "", 1, "b") == NULL, "Must fail on empty pattern", __func__);
+    s = snew("abc");
+    assert_equal(sreplace_inplace(s, 1, "a", 1, NULL) == NULL, "Must fail on NULL replacement", __func__);
+    s = snew("abc");
+    string same = sreplace_inplace(s, 4, "abcd", 1, "x");
+    assert_equal(same == s && strcmp(s, "abc") == 0, "Long pattern must leave s unchanged", __func__);
+    sfree(s);
+}
+
+void test_sreplace_inplace_as_intended(void) {
+    string s = snew("a--b--c----d");
+    string p = s;
+    s = sreplace_inplace(s, 2, "--", 1, "+");
+    assert_equal(s == p, "Shrinking must not reallocate", __func__);
+    assert_equal(strcmp(s, "a+b+c++d") == 0, "Must replace in place", __func__);
+    assert_equal(sgetlen(s) == 8, "Length must be updated", __func__);
+
+    s = sreplace_inplace(s, 1, "+", 3, "<=>");
+    assert_equal(strcmp(s, "a<=>b<=>c<=><=>d") == 0, "Must grow and replace", __func__);
+    assert_equal(sgetlen(s) == 16, "Length must be updated 2", __func__);
+
+    s = sreplace_inplace(s, 3, "<=>", 0, "");
+    assert_equal(strcmp(s, "abcd") == 0, "Must remove", __func__);
+    sfree(s);
+
+    s = snew("xxxx");
+    s = sreplace_inplace(s, 1, "x", 2, "yy");
+    assert_equal(strcmp(s, "yyyyyyyy") == 0, "Must grow when every byte matches", __func__);
+    sfree(s);
+}
+
+void test_tiny_strings(void) {
+    char buf[40];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = (char)('a' + i % 26);
+    for (size_t len = 0; len <= sizeof(buf); len++) {
+        string s = snewlen(buf, len);
+        assert_equal(sgetlen(s) == len, "Length must be kept", __func__);
+        assert_equal(sgetavail(s) == 0, "New strings are exact", __func__);
+        assert_equal(memcmp(s, buf, len) == 0 && s[len] == 0, "Content must be kept", __func__);
+        sfree(s);
+    }
+
+    string s = snew("key");
+    s = scat(s, 3, "123");
+    assert_equal(strcmp(s, "key123") == 0, "Tiny strings must grow", __func__);
+    assert_equal(sgetavail(s) > 0, "Growth must leave spare capacity", __func__);
+    s = sshrink_to_fit(s);
+    assert_equal(sgetavail(s) == 0 && strcmp(s, "key123") == 0, "Must shrink back", __func__);
+    for (int i = 0; i < 10; i++)
+        s = scat(s, 3, "abc");
+    assert_equal(sgetlen(s) == 36 && strcmp(s + 30, "abcabc") == 0, "Must grow past the tiny limit", __func__);
+    assert_equal(sremove(s, 3, "abc"), "Must remove", __func__);
+    assert_equal(strcmp(s, "key123") == 0 && sgetlen(s) == 6, "Must shrink the length", __func__);
+    sfree(s);
+
+    s = snew("abcd");
+    assert_equal(strim(s, 1, "a") && strcmp(s, "bcd") == 0, "Must trim a tiny string", __func__);
+    assert_equal(sgetlen(s) == 3, "Length must be updated", __func__);
+    string d = sdup(s);
+    assert_equal(strcmp(d, "bcd") == 0 && sgetlen(d) == 3, "Must duplicate", __func__);
+    sclear(d);
+    assert_equal(sgetlen(d) == 0 && d[0] == 0, "Must clear", __func__);
+    sfree(d);
+    sfree(s);
+
+    sarena* a = sacreate(0);
+    string t = sanew(a, "short");
+    assert_equal(strcmp(t, "short") == 0 && sgetlen(t) == 5, "Arena strings must work", __func__);
+    t = scat(t, 2, "er");
+    assert_equal(strcmp(t, "shorter") == 0, "Arena strings must move to the heap", __func__);
+    sfree(t);
+    safree(a);
+}
+
+void test_shash_as_intended(void) {
+    assert_equal(shash(NULL) == 0, "NULL must hash to 0", __func__);
+    assert_equal(!sequal(NULL, NULL), "Must fail on NULL", __func__);
+
+    assert_equal(shashed(NULL) == NULL, "Must fail on NULL", __func__);
+
+    const char* text = "a key long enough to get a hash slot in its header";
+    string a = shashed(snew(text));
+    string b = shashed(snew(text));
+    string t = snew("tiny key");
+    string u = shashed(snew("tiny key"));
+    sview v = {text, strlen(text)};
+    assert_equal(strcmp(a, text) == 0 && sgetlen(a) == strlen(text), "Must keep the bytes", __func__);
+    assert_equal(strcmp(u, "tiny key") == 0 && sgetlen(u) == 8, "Must keep the bytes of tiny strings", __func__);
+    assert_equal(shash(u) == shash(t) && shash(u) == shash(u) && sequal(u, t), "Strings with and without a slot must agree", __func__);
+    assert_equal(shashed(u) == u, "Must keep an existing slot", __func__);
+    assert_equal(shash(a) == shash(b), "Equal strings must hash the same", __func__);
+    assert_equal(shash(a) == shash(a), "Cached hash must be stable", __func__);
+    assert_equal(shash(a) == shash_view(v), "Views must hash like strings", __func__);
+    assert_equal(shash(t) == shash_view((sview){"tiny key", 8}), "Tiny strings must hash", __func__);
+    assert_equal(shash(a) != shash(t), "Different strings should hash differently", __func__);
+    assert_equal(sequal(a, b) && sequal(a, a), "Must be equal", __func__);
+    assert_equal(!sequal(a, t), "Must differ by length", __func__);
+
+    /* Every mutator must drop the cached hash */
+    uint64_t before = shash(a);
+    a = scat(a, 1, "!");
+    assert_equal(shash(a) != before, "scat must invalidate", __func__);
+    assert_equal(!sequal(a, b), "Must not be equal after scat", __func__);
+    before = shash(a);
+    supper(a);
+    assert_equal(shash(a) != before, "supper must invalidate", __func__);
+    before = shash(a);
+    slower_ascii(a);
+    assert_equal(shash(a) != before, "slower_ascii must invalidate", __func__);
+    before = shash(a);
+    strim(a, 1, "!");
+    assert_equal(shash(a) == shash(b) && sequal(a, b), "strim must invalidate", __func__);
+    sremove(a, 4, "long");
+    assert_equal(shash(a) != shash(b), "sremove must invalidate", __func__);
+    before = shash(a);
+    a = sreplace_inplace(a, 3, "key", 3, "KEY");
+    assert_equal(shash(a) != before, "sreplace_inplace must invalidate", __func__);
+    before = shash(a);
+    a[0] = 'A';
+    supdatelen(a, sgetlen(a));
+    assert_equal(shash(a) != before, "supdatelen must invalidate", __func__);
+    before = shash(b);
+    b = sreserve(b, 4096);
+    assert_equal(shash(b) == before && shash(b) == shash_view(v), "Moving must keep the hash", __func__);
+    b = sshare(b);
+    assert_equal(shash(b) == before && shashed(b) == b, "Sharing must keep the slot", __func__);
+    string c = sretain(b);
+    c = sunshare(c);
+    assert_equal(c != b && shash(c) == before && shashed(c) == c, "Copies must keep the slot", __func__);
+    sfree(a);
+    sfree(b);
+    sfree(c);
+    sfree(t);
+    sfree(u);
+}
+
+void test_sintern_invalid_input(void) {
+    sview v = {"abc", 3};
+    assert_equal(sintern(NULL, "abc") == NULL, "Must fail on NULL table", __func__);
+    assert_equal(sintern_view(NULL, v) == NULL, "Must fail on NULL table 2", __func__);
+    assert_equal(sicount(NULL) == 0, "NULL table must be empty", __func__);
+    sifree(NULL);
+
+    sintab* it = sicreate(0);
+    assert_equal(sintern(it, NULL) == NULL, "Must fail on NULL string", __func__);
+    assert_equal(sintern_view(it, sview_of(NULL)) == NULL, "Must fail on NULL view", __func__);
+    assert_equal(sicount(it) == 0, "Nothing must be added", __func__);
+    sifree(it);
+}
+
+void test_sintern_as_intended(void) {
+    sintab* it = sicreate(0);
+    string host = snew("api.example.org");
+    string a = sintern(it, host);
+    assert_equal(a != host && strcmp(a, host) == 0, "Must copy the bytes", __func__);
+    assert_equal(sintern(it, host) == a, "Must return the canonical string", __func__);
+    assert_equal(sintern_view(it, (sview){"api.example.org", 15}) == a, "Views must find it too", __func__);
+    assert_equal(shash(a) == shash(host), "Hash must be kept", __func__);
+    sfree(a);
+    assert_equal(strcmp(a, "api.example.org") == 0, "sfree must not release it", __func__);
+    assert_equal(sintern_view(it, (sview){"", 0}) != NULL, "Must intern the empty string", __func__);
+
+    /* Enough distinct keys to grow the table several times */
+    string line = snew("host-0,host-1,host-2,host-1,host-0");
+    sview parts[5];
+    ssplit_views(sview_of(line), 1, ",", parts, 5);
+    assert_equal(sintern_view(it, parts[0]) == sintern_view(it, parts[4]), "Must deduplicate views", __func__);
+    assert_equal(sintern_view(it, parts[1]) == sintern_view(it, parts[3]), "Must deduplicate views 2", __func__);
+    char buf[32];
+    string first[1000];
+    for (int i = 0; i < 1000; i++) {
+        int n = snprintf(buf, sizeof(buf), "key-%d", i);
+        first[i] = sintern_view(it, (sview){buf, n});
+    }
+    assert_equal(sicount(it) == 1004, "Must count distinct strings", __func__);
+    bool same = true;
+    for (int i = 0; i < 1000; i++) {
+        int n = snprintf(buf, sizeof(buf), "key-%d", i);
+        same = same && sintern_view(it, (sview){buf, n}) == first[i];
+    }
+    assert_equal(same, "Pointers must survive growth", __func__);
+    sfree(line);
+    sfree(host);
+    sifree(it);
+}
+
+static void* intern_worker(void* arg) {
+    sintab* it = arg;
+    char buf[32];
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 2000; i++) {
+            int n = snprintf(buf, sizeof(buf), "token-%d", i);
+            string s = sintern_view(it, (sview){buf, n});
+            if (s == NULL || strcmp(s, buf) != 0)
+                return NULL;
+        }
+    }
+    return it;
+}
+
+void test_sintern_threads(void) {
+    sintab* it = sicreate(0);
+    pthread_t threads[4];
+    void* results[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, intern_worker, it);
+    for (int i = 0; i < 4; i++)
+        pthread_join(threads[i], &results[i]);
+    for (int i = 0; i < 4; i++)
+        assert_equal(results[i] == it, "Every thread must get the right strings", __func__);
+    assert_equal(sicount(it) == 2000, "Must not create duplicates", __func__);
+    sifree(it);
+}
+
+void test_sshare_invalid_input(void) {
+    assert_equal(sshare(NULL) == NULL, "Must fail on NULL", __func__);
+    assert_equal(sretain(NULL) == NULL, "Must fail on NULL 2", __func__);
+    assert_equal(sunshare(NULL) == NULL, "Must fail on NULL 3", __func__);
+    srelease(NULL);
+
+    string s = snew("not reference-counted");
+    assert_equal(sretain(s) == NULL, "Must fail on a plain string", __func__);
+    assert_equal(sunshare(s) == s, "Plain strings are never shared", __func__);
+    string d = sdup(s);
+    assert_equal(d != s && strcmp(d, s) == 0, "Plain strings must be copied", __func__);
+    sfree(d);
+    sfree(s);
+}
+
+void test_sshare_as_intended(void) {
+    string s = sshare(snew("tiny"));
+    assert_equal(s != NULL && strcmp(s, "tiny") == 0 && sgetlen(s) == 4, "Must share a tiny string", __func__);
+    assert_equal(sshare(s) == s, "Must not convert twice", __func__);
+    string r = sretain(s);
+    assert_equal(r == s, "Must return the same string", __func__);
+    string d = sdup(s);
+    assert_equal(d == s, "sdup must not copy", __func__);
+
+    /* Three references now, nothing may change the bytes in place */
+    assert_equal(!supper(s) && !strim(s, 1, "t") && !sremove(s, 1, "i"), "Must refuse shared strings", __func__);
+    assert_equal(!sltrimchar(s, 1, "t") && sbite(s, 1, "i") == NULL, "Must refuse shared strings 2", __func__);
+    sclear(s);
+    assert_equal(strcmp(s, "tiny") == 0 && sgetlen(s) == 4, "Must not change shared bytes", __func__);
+
+    string c = scat(d, 4, "-cat");
+    assert_equal(c != s && strcmp(c, "tiny-cat") == 0, "scat must copy", __func__);
+    assert_equal(strcmp(s, "tiny") == 0, "Other references must not change", __func__);
+    sfree(c);
+
+    string u = sunshare(r);
+    assert_equal(u != s && strcmp(u, "tiny") == 0, "Must copy a shared string", __func__);
+    assert_equal(supper(u) && strcmp(u, "TINY") == 0, "The copy must be changeable", __func__);
+    assert_equal(strcmp(s, "tiny") == 0, "Other references must not change 2", __func__);
+    srelease(u);
+
+    /* The last reference is not shared any more */
+    assert_equal(sunshare(s) == s, "Last reference must not be copied", __func__);
+    assert_equal(supper(s) && strcmp(s, "TINY") == 0, "Last reference must be changeable", __func__);
+    uint64_t before = shash(s);
+    s = sreserve(s, 100);
+    assert_equal(shash(s) == before && sgetavail(s) == 96, "Must grow in place", __func__);
+    srelease(s);
+
+    s = sshare(snew("a-b-c"));
+    r = sretain(s);
+    string rep = sreplace_inplace(r, 1, "-", 1, "+");
+    assert_equal(rep != s && strcmp(rep, "a+b+c") == 0, "Must replace into a copy", __func__);
+    assert_equal(strcmp(s, "a-b-c") == 0, "Must keep the shared bytes", __func__);
+    sfree(rep);
+    sfree(s);
+}
+
+static void* share_worker(void* arg) {
+    string s = arg;
+    size_t sum = 0;
+    for (size_t i = 0; i < sgetlen(s); i++)
+        sum += (unsigned char)s[i];
+    string copy = sdup(s);
+    srelease(s);
+    srelease(copy);
+    return (void*)sum;
+}
+
+void test_sshare_threads(void) {
+    string body = snewlen(NULL, 1 << 16);
+    memset(body, 'x', 1 << 16);
+    body = sshare(body);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, share_worker, sretain(body));
+    bool ok = true;
+    for (int i = 0; i < 4; i++) {
+        void* sum;
+        pthread_join(threads[i], &sum);
+        ok = ok && (size_t)sum == (size_t)'x' << 16;
+    }
+    assert_equal(ok, "Every thread must see the bytes", __func__);
+    assert_equal(sunshare(body) == body, "Only one reference must be left", __func__);
+    srelease(body);
+}
+
+void test_sparallel_invalid_input(void) {
+    string s = snew("abc");
+    assert_equal(sfind_parallel(NULL, 1, "a") == -1, "Must fail on NULL string", __func__);
+    assert_equal(scount_parallel(s, 1, NULL) == -1, "Must fail on NULL pattern", __func__);
+    assert_equal(sfind_parallel(s, 0, "") == -1, "Must fail on empty pattern", __func__);
+    assert_equal(scount_parallel(s, 4, "abcd") == -1, "Must fail on long pattern", __func__);
+    assert_equal(sfind_parallel(s, 1, "c") == 2, "Short strings must still work", __func__);
+    sfree(s);
+}
+
+void test_sparallel_as_intended(void) {
+    size_t len = 6u << 20;
+    size_t chunk = 1u << 20;
+    string s = snewlen(NULL, len);
+    memset(s, 'a', len);
+    assert_equal(sfind_parallel(s, 3, "xyz") == -1, "Must not find", __func__);
+    assert_equal(scount_parallel(s, 3, "aaa") == (ssize_t)(len - 2), "Must count overlapping matches", __func__);
+
+    /* Matches straddling chunk boundaries, and one in the last window */
+    size_t at[] = {chunk - 1, 2 * chunk - 2, 3 * chunk, 5 * chunk - 3, len - 3};
+    for (size_t i = 0; i < 5; i++)
+        memcpy(s + at[i], "xyz", 3);
+    assert_equal(sfind_parallel(s, 3, "xyz") == (ssize_t)at[0], "Must find the first match", __func__);
+    assert_equal(scount_parallel(s, 3, "xyz") == 5, "Must count boundary matches once", __func__);
+    assert_equal(scount_parallel(s, 3, "xyz") == scount(s, 3, "xyz"), "Must agree with scount", __func__);
+    memset(s + at[0], 'a', 3);
+    assert_equal(sfind_parallel(s, 3, "xyz") == (ssize_t)at[1], "Must find a later match", __func__);
+    memcpy(s + 5, "xyz", 3);
+    assert_equal(sfind_parallel(s, 3, "xyz") == 5, "Must find an early match", __func__);
+    sfree(s);
+}
+
+void test_smapfile_invalid_input(void) {
+    assert_equal(smapfile(NULL, 0) == NULL, "Must fail on NULL path", __func__);
+    assert_equal(smapfile("/nonexistent/safe_string", 0) == NULL, "Must fail on a missing file", __func__);
+    assert_equal(smapfile("/", 0) == NULL, "Must fail on a directory", __func__);
+    assert_equal(!smadvise(NULL, SMAP_SEQUENTIAL), "Must fail on NULL", __func__);
+    string s = snew("heap string");
+    assert_equal(!smadvise(s, SMAP_SEQUENTIAL), "Must fail on a heap string", __func__);
+    sfree(s);
+}
+
+void test_smapfile_as_intended(void) {
+    const char* path = "smapfile_test.tmp";
+    const char* text = "GET /a 200\nGET /b 404\nPOST /c 200\n";
+    FILE* f = fopen(path, "wb");
+    fputs(text, f);
+    fclose(f);
+
+    string s = smapfile(path, SMAP_SEQUENTIAL | SMAP_WILLNEED);
+    assert_equal(s != NULL && sgetlen(s) == strlen(text), "Must map the file", __func__);
+    assert_equal(strcmp(s, text) == 0, "Bytes must match and be terminated", __func__);
+    assert_equal(scount(s, 4, " 200") == 2 && sfind(s, 4, "POST") == 22, "Must be searchable", __func__);
+    assert_equal(shash(s) == shash_view((sview){text, strlen(text)}), "Must be hashable", __func__);
+    assert_equal(smadvise(s, SMAP_RANDOM) && smadvise(s, 0), "Must accept hints", __func__);
+    size_t n = 0;
+    string* lines = ssplit(s, 1, "\n", &n);
+    assert_equal(n == 4 && strcmp(lines[1], "GET /b 404") == 0, "Must split", __func__);
+    sfreearr(lines, n);
+    assert_equal(!supper(s) && !strim(s, 1, "G") && !sremove(s, 1, "/"), "Must refuse in place changes", __func__);
+    assert_equal(strcmp(s, text) == 0, "Bytes must not change", __func__);
+    s = scat(s, 4, "EOF\n");
+    assert_equal(s != NULL && sgetlen(s) == strlen(text) + 4, "scat must copy to the heap", __func__);
+    assert_equal(supper(s) && strncmp(s, "GET /A", 6) == 0, "The copy must be changeable", __func__);
+    sfree(s);
+
+    /* A file of exactly one page still needs its terminating zero */
+    f = fopen(path, "wb");
+    for (int i = 0; i < 4096; i++)
+        fputc('x', f);
+    fclose(f);
+    s = smapfile(path, 0);
+    assert_equal(sgetlen(s) == 4096 && s[4096] == 0 && s[4095] == 'x', "Must terminate page sized files", __func__);
+    string u = sunshare(s);
+    assert_equal(u != NULL && sgetlen(u) == 4096 && slower(u), "sunshare must copy a mapping", __func__);
+    sfree(u);
+
+    f = fopen(path, "wb");
+    fclose(f);
+    s = smapfile(path, 0);
+    assert_equal(s != NULL && sgetlen(s) == 0 && s[0] == 0, "Must map an empty file", __func__);
+    sfree(s);
+    remove(path);
+}
+
+void test_sstream_invalid_input(void) {
+    size_t out[4];
+    assert_equal(sscreate(0, "a") == NULL, "Must fail on empty pattern", __func__);
+    assert_equal(sscreate(1, NULL) == NULL, "Must fail on NULL pattern", __func__);
+    assert_equal(ssfeed(NULL, "a", 1, out, 4) == -1, "Must fail on NULL stream", __func__);
+    sstream* ss = sscreate(2, "ab");
+    assert_equal(ssfeed(ss, NULL, 1, out, 4) == -1, "Must fail on NULL chunk", __func__);
+    assert_equal(ssfeed(ss, "ab", 2, NULL, 4) == -1, "Must fail on NULL output", __func__);
+    assert_equal(ssfeed(ss, NULL, 0, NULL, 0) == 0, "Must accept an empty chunk", __func__);
+    assert_equal(ssfeed_file(ss, NULL, out, 4) == -1, "Must fail on NULL file", __func__);
+    assert_equal(ssfeed_fd(ss, -1, out, 4) == -1, "Must fail on a bad descriptor", __func__);
+    assert_equal(sspos(ss) == 0 && sspos(NULL) == 0, "Nothing must be consumed", __func__);
+    assert_equal(ssfeed(ss, "a", 1, out, 4) == 0 && ssfeed(ss, NULL, 0, out, 4) == 0, "Must keep the tail", __func__);
+    assert_equal(ssfeed(ss, "b", 1, out, 4) == 1 && out[0] == 0, "Must match across an empty chunk", __func__);
+    ssfree(ss);
+    ssfree(NULL);
+    ssreset(NULL);
+}
+
+void test_sstream_as_intended(void) {
+    const char* text = "abaababaabababaabab aba";
+    size_t len = strlen(text);
+    sstream* ss = sscreate(3, "aba");
+    size_t want[16], got[16];
+    size_t nwant = 0;
+    for (size_t i = 0; i + 3 <= len; i++)
+        if (memcmp(text + i, "aba", 3) == 0)
+            want[nwant++] = i;
+
+    ssize_t n = ssfeed(ss, text, len, got, 16);
+    assert_equal(n == (ssize_t)nwant && memcmp(got, want, nwant * sizeof(size_t)) == 0, "One chunk must find all matches", __func__);
+
+    /* Byte by byte, every match spans a boundary */
+    ssreset(ss);
+    size_t total = 0;
+    for (size_t i = 0; i < len; i++)
+        total += ssfeed(ss, text + i, 1, got + total, 16 - total);
+    assert_equal(total == nwant && memcmp(got, want, nwant * sizeof(size_t)) == 0, "Single bytes must find all matches", __func__);
+    assert_equal(sspos(ss) == len, "Must count consumed bytes", __func__);
+
+    /* Every split into two chunks */
+    int ok = 1;
+    for (size_t cut = 0; cut <= len; cut++) {
+        ssreset(ss);
+        total = ssfeed(ss, text, cut, got, 16);
+        total += ssfeed(ss, text + cut, len - cut, got + total, 16 - total);
+        ok &= total == nwant && memcmp(got, want, nwant * sizeof(size_t)) == 0;
+    }
+    assert_equal(ok, "Every split must find all matches", __func__);
+
+    ssreset(ss);
+    n = ssfeed(ss, text, len, got, 2);
+    assert_equal(n == (ssize_t)nwant && got[0] == want[0] && got[1] == want[1], "Must count past the output capacity", __func__);
+    ssfree(ss);
+
+    /* A long pattern fed in small random chunks */
+    size_t big = 100000;
+    char* data = malloc(big + 1);
+    srand(18);
+    for (size_t i = 0; i < big; i++)
+        data[i] = "ab"[rand() % 2];
+    data[big] = 0;
+    string s = snew(data);
+    const char* pat = "abbabaab";
+    ss = sscreate(8, pat);
+    total = 0;
+    size_t first = SIZE_MAX;
+    for (size_t i = 0; i < big;) {
+        size_t step = 1 + rand() % 13;
+        if (step > big - i) step = big - i;
+        size_t at;
+        ssize_t k = ssfeed(ss, data + i, step, &at, 1);
+        if (k > 0 && first == SIZE_MAX) first = at;
+        total += k;
+        i += step;
+    }
+    assert_equal(total == (size_t)scount(s, 8, pat), "Random chunks must agree with scount", __func__);
+    assert_equal(first == (size_t)sfind(s, 8, pat), "Random chunks must agree with sfind", __func__);
+
+    /* The drivers read whole files */
+    FILE* f = tmpfile();
+    fwrite(data, 1, big, f);
+    rewind(f);
+    ssreset(ss);
+    n = ssfeed_file(ss, f, &first, 1);
+    assert_equal(n == (ssize_t)total && first == (size_t)sfind(s, 8, pat), "ssfeed_file must find all matches", __func__);
+    rewind(f);
+    ssreset(ss);
+    n = ssfeed_fd(ss, fileno(f), NULL, 0);
+    assert_equal(n == (ssize_t)total && sspos(ss) == big, "ssfeed_fd must find all matches", __func__);
+    fclose(f);
+    ssfree(ss);
+    sfree(s);
+    free(data);
+}
+
+void test_srope_invalid_input(void) {
+    assert_equal(sronew(1, NULL) == NULL, "Must fail on NULL bytes", __func__);
+    assert_equal(srocat(NULL, sronew(1, "a")) == NULL, "Must fail on NULL rope", __func__);
+    assert_equal(sroinsert(NULL, 0, 1, "a") == NULL, "Must fail on NULL rope", __func__);
+    assert_equal(sroinsert(sronew(1, "a"), 2, 1, "b") == NULL, "Must fail past the end", __func__);
+    assert_equal(sroerase(sronew(3, "abc"), 2, 1) == NULL, "Must fail on start > end", __func__);
+    srope* r = sronew(3, "abc");
+    assert_equal(sroslice(r, 1, 4) == NULL, "Must fail past the end", __func__);
+    assert_equal(srofind(r, 0, "") == -1 && srocount(r, 1, NULL) == -1, "Must fail on bad patterns", __func__);
+    assert_equal(srofind(NULL, 1, "a") == -1 && sroflatten(NULL) == NULL, "Must fail on NULL rope", __func__);
+    size_t pos = 0;
+    sview v;
+    assert_equal(!sronext(r, &pos, NULL) && !sronext(NULL, &pos, &v), "Must fail on NULL arguments", __func__);
+    assert_equal(srolen(NULL) == 0 && srodup(NULL) == NULL, "NULL must be empty", __func__);
+    srofree(r);
+    srofree(NULL);
+}
+
+void test_srope_as_intended(void) {
+    srope* r = sronew(0, NULL);
+    char* ref = malloc(1 << 20);
+    size_t len = 0;
+    srand(19);
+    int ok = 1;
+    char buf[6000];
+    for (int step = 0; step < 400; step++) {
+        size_t pos = rand() % (len + 1);
+        if (rand() % 4 == 0 && len > 0) {
+            size_t end = pos + rand() % (len - pos + 1);
+            r = sroerase(r, pos, end);
+            memmove(ref + pos, ref + end, len - end);
+            len -= end - pos;
+        } else {
+            size_t n = rand() % 2 ? 1 + (size_t)rand() % 8 : (size_t)rand() % sizeof(buf);
+            for (size_t i = 0; i < n; i++)
+                buf[i] = 'a' + rand() % 3;
+            r = sroinsert(r, pos, n, buf);
+            memmove(ref + pos + n, ref + pos, len - pos);
+            memcpy(ref + pos, buf, n);
+            len += n;
+        }
+        ok &= srolen(r) == len;
+    }
+    string flat = snewlen(ref, len);
+    free(ref);
+    string out = sroflatten(r);
+    assert_equal(ok && out != NULL && sequal(out, flat), "Random edits must match a flat string", __func__);
+    sfree(out);
+    assert_equal(srocount(r, 3, "abc") == scount(flat, 3, "abc"), "srocount must agree with scount", __func__);
+    assert_equal(srofind(r, 4, "cbac") == sfind(flat, 4, "cbac"), "srofind must agree with sfind", __func__);
+
+    srope* keep = srodup(r);
+    srope* mid = sroslice(r, len / 3, 2 * len / 3);
+    out = sroflatten(mid);
+    assert_equal(sgetlen(out) == 2 * len / 3 - len / 3 && memcmp(out, flat + len / 3, sgetlen(out)) == 0, "Must slice", __func__);
+    sfree(out);
+    r = srocat(r, mid);
+    r = sroerase(r, 0, len);
+    out = sroflatten(r);
+    assert_equal(sgetlen(out) == 2 * len / 3 - len / 3 && memcmp(out, flat + len / 3, sgetlen(out)) == 0, "Must concatenate and erase", __func__);
+    sfree(out);
+    out = sroflatten(keep);
+    assert_equal(sequal(out, flat), "Older versions must not change", __func__);
+    sfree(out);
+
+    size_t pos = 0, total = 0, chunks = 0;
+    sview v;
+    while (sronext(keep, &pos, &v)) {
+        ok &= memcmp(v.ptr, flat + total, v.len) == 0;
+        total += v.len;
+        chunks++;
+    }
+    assert_equal(ok && total == len && chunks > 1, "Must iterate over chunks", __func__);
+
+    /* A match spanning two leaves */
+    srofree(r);
+    r = srocat(sronew(3, "xab"), sronew(3, "cxx"));
+    assert_equal(srofind(r, 3, "abc") == 1 && srocount(r, 2, "xx") == 1, "Must find across chunks", __func__);
+    srofree(r);
+    srofree(keep);
+    sfree(flat);
+}
+
+void test_scatfmt_invalid_input(void) {
+    const char* fmt = NULL;
+    const sview* volatile noparts = NULL;
+    assert_equal(scatfmt(NULL, "%d", 1) == NULL, "Must fail on NULL string", __func__);
+    assert_equal(scatfmt(snew("a"), fmt) == NULL, "Must fail on NULL format", __func__);
+    assert_equal(scatn(NULL, 0, NULL) == NULL, "Must fail on NULL string", __func__);
+    assert_equal(scatn(snew("a"), 1, noparts) == NULL, "Must fail on NULL parts", __func__);
+    sview bad[] = {{"a", 1}, {NULL, 2}};
+    assert_equal(scatn(snew("a"), 2, bad) == NULL, "Must fail on a NULL fragment", __func__);
+    sview huge[] = {{"a", SIZE_MAX}, {"b", 2}};
+    assert_equal(scatn(snew("a"), 2, huge) == NULL, "Must fail on overflow", __func__);
+    assert_equal(scatu64(NULL, 1) == NULL && scati64(NULL, -1) == NULL, "Must fail on NULL string", __func__);
+    assert_equal(scathex(NULL, 1, 0) == NULL, "Must fail on NULL string", __func__);
+    assert_equal(scathex(snew("a"), 1, SIZE_MAX) == NULL, "Must fail on a huge width", __func__);
+}
+
+void test_scatfmt_as_intended(void) {
+    string s = snew("id=");
+    s = scatfmt(s, "%d,%s", 42, "ok");
+    assert_equal(strcmp(s, "id=42,ok") == 0 && sgetlen(s) == 8, "Must format", __func__);
+    char big[300];
+    memset(big, 'x', 299);
+    big[299] = 0;
+    s = scatfmt(s, "[%s]", big);
+    assert_equal(sgetlen(s) == 309 && s[8] == '[' && s[308] == ']' && s[309] == 0, "Must grow once and retry", __func__);
+    s = sreserve(s, 400);
+    string before = s;
+    s = scatfmt(s, "%05.1f", 2.25);
+    assert_equal(s == before && strcmp(s + 309, "002.2") == 0, "Must format into spare capacity", __func__);
+    s = scatfmt(s, "%s", "");
+    assert_equal(sgetlen(s) == 314, "Empty output must keep the string", __func__);
+    sfree(s);
+
+    s = sshare(snew("shared"));
+    string other = sretain(s);
+    s = scatfmt(s, "-%u", 7u);
+    assert_equal(strcmp(s, "shared-7") == 0 && strcmp(other, "shared") == 0, "Must not change shared strings", __func__);
+    sfree(other);
+
+    sview parts[] = {{": ", 2}, {NULL, 0}, {"a\0b", 3}, {"!", 1}};
+    s = scatn(s, 4, parts);
+    assert_equal(sgetlen(s) == 14 && memcmp(s, "shared-7: a\0b!", 15) == 0, "Must append fragments", __func__);
+    s = scatn(s, 0, NULL);
+    assert_equal(sgetlen(s) == 14, "No fragments must keep the string", __func__);
+    sfree(s);
+
+    int64_t ints[] = {0, 7, -7, 9, 10, 99, 100, -100, 12345, 999999999, 1000000000, INT64_MAX, INT64_MIN};
+    char want[64];
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        s = scati64(snew("n="), ints[i]);
+        snprintf(want, sizeof(want), "n=%lld", (long long)ints[i]);
+        ok &= strcmp(s, want) == 0 && sgetlen(s) == strlen(want);
+        sfree(s);
+    }
+    assert_equal(ok, "scati64 must match printf", __func__);
+    uint64_t p = 1;
+    for (int i = 0; i < 20; i++, p *= 10) {
+        uint64_t vals[] = {p - 1, p, p + 1};
+        for (int k = 0; k < 3; k++) {
+            s = scatu64(snew(""), vals[k]);
+            snprintf(want, sizeof(want), "%llu", (unsigned long long)vals[k]);
+            ok &= strcmp(s, want) == 0;
+            sfree(s);
+        }
+    }
+    s = scatu64(snew(""), UINT64_MAX);
+    assert_equal(ok && strcmp(s, "18446744073709551615") == 0, "scatu64 must match printf", __func__);
+    sfree(s);
+
+    s = scathex(snew("0x"), 0, 0);
+    s = scathex(s, 0x1f, 4);
+    s = scathex(s, 0xdeadbeefcafe1234ull, 2);
+    s = scathex(s, 0xa, 20);
+    assert_equal(strcmp(s, "0x0001fdeadbeefcafe12340000000000000000000a") == 0, "scathex must pad and convert", __func__);
+    sfree(s);
+}
+
+void test_stoi64_invalid_input(void) {
+    int64_t i = 7;
+    uint64_t u = 7;
+    double d = 7;
+    bool ovf = true;
+    assert_equal(stoi64(NULL, &i, &ovf) == 0 && !ovf, "Must fail on NULL string", __func__);
+    assert_equal(stou64_view((sview){"12", 2}, NULL, NULL) == 0, "Must fail on NULL output", __func__);
+    assert_equal(stod_view((sview){NULL, 3}, &d, NULL) == 0, "Must fail on NULL view", __func__);
+    const char* bad[] = {"", "-", "+", " 1", "x1", "-+1", ".", "-.e5", "e5", "in", "na"};
+    int ok = 1;
+    for (size_t k = 0; k < sizeof(bad) / sizeof(bad[0]); k++) {
+        sview v = {bad[k], strlen(bad[k])};
+        ok &= stoi64_view(v, &i, NULL) == 0 && stou64_view(v, &u, NULL) == 0 && stod_view(v, &d, NULL) == 0;
+    }
+    assert_equal(ok && i == 7 && u == 7 && d == 7, "Must not parse non-numbers", __func__);
+    assert_equal(stou64_view((sview){"-1", 2}, &u, NULL) == 0, "Unsigned must refuse a minus", __func__);
+}
+
+void test_stoi64_as_intended(void) {
+    int64_t i;
+    uint64_t u;
+    bool ovf;
+    string s = snew("-12345,678");
+    assert_equal(stoi64(s, &i, &ovf) == 6 && i == -12345 && !ovf, "Must stop at the separator", __func__);
+    assert_equal(stoi64_view((sview){s + 7, 3}, &i, NULL) == 3 && i == 678, "Must parse a view", __func__);
+    assert_equal(stoi64_view((sview){s, 3}, &i, NULL) == 3 && i == -12, "Must stop at the view's end", __func__);
+    sfree(s);
+
+    assert_equal(stou64_view((sview){"+0000123456789012345678x", 24}, &u, &ovf) == 23 && u == 123456789012345678ull && !ovf,
+                 "Must parse long runs of digits", __func__);
+    assert_equal(stou64_view((sview){"18446744073709551615", 20}, &u, &ovf) == 20 && u == UINT64_MAX && !ovf,
+                 "Must parse the largest value", __func__);
+    assert_equal(stou64_view((sview){"18446744073709551616", 20}, &u, &ovf) == 20 && u == UINT64_MAX && ovf,
+                 "Must report overflow", __func__);
+    assert_equal(stou64_view((sview){"28446744073709551616", 20}, &u, &ovf) == 20 && ovf, "Must report wrapped overflow", __func__);
+    assert_equal(stou64_view((sview){"000000000000000000000000001", 27}, &u, &ovf) == 27 && u == 1 && !ovf,
+                 "Leading zeros must not overflow", __func__);
+    assert_equal(stoi64_view((sview){"-9223372036854775808", 20}, &i, &ovf) == 20 && i == INT64_MIN && !ovf,
+                 "Must parse the smallest value", __func__);
+    assert_equal(stoi64_view((sview){"9223372036854775808", 19}, &i, &ovf) == 19 && i == INT64_MAX && ovf,
+                 "Must saturate on overflow", __func__);
+    assert_equal(stoi64_view((sview){"-99999999999999999999999", 24}, &i, &ovf) == 24 && i == INT64_MIN && ovf,
+                 "Must saturate on negative overflow", __func__);
+}
+
+void test_stod_as_intended(void) {
+    double d;
+    bool ovf;
+    const char* in[] = {"0", "-0.0", "1.5", "3.14159", ".5", "5.", "1e10", "1E-5", "-2.5e+3",
+                        "123456789012345678", "0.1", "2.2250738585072014e-308", "4.9e-324",
+                        "1.7976931348623157e308", "9007199254740993", "0.000000000000000000000000000000012345678901234567890123",
+                        "1234567890123456789012345678901234567890", "7.2057594037927933e16", "1e-400"};
+    int ok = 1;
+    for (size_t k = 0; k < sizeof(in) / sizeof(in[0]); k++) {
+        double want = strtod(in[k], NULL);
+        size_t n = stod_view((sview){in[k], strlen(in[k])}, &d, &ovf);
+        ok &= n == strlen(in[k]) && memcmp(&d, &want, sizeof(d)) == 0 && !ovf;
+    }
+    assert_equal(ok, "Must round like strtod", __func__);
+
+    string s = snew("12.5e;x 3e 4.e2");
+    assert_equal(stod(s, &d, NULL) == 4 && d == 12.5, "An incomplete exponent must not be consumed", __func__);
+    assert_equal(stod_view((sview){s + 8, 2}, &d, NULL) == 1 && d == 3, "Must stop before a bare e", __func__);
+    assert_equal(stod_view((sview){s + 11, 4}, &d, NULL) == 4 && d == 400, "Must accept an empty fraction", __func__);
+    assert_equal(stod_view((sview){s, 2}, &d, NULL) == 2 && d == 12, "Must stop at the view's end", __func__);
+    sfree(s);
+
+    assert_equal(stod_view((sview){"1e400", 5}, &d, &ovf) == 5 && d == INFINITY && ovf, "Must report overflow", __func__);
+    assert_equal(stod_view((sview){"-1.8e308", 8}, &d, &ovf) == 8 && d == -INFINITY && ovf, "Must report rounding overflow", __func__);
+    assert_equal(stod_view((sview){"-Infinity", 9}, &d, &ovf) == 9 && d == -INFINITY && !ovf, "Must parse infinity", __func__);
+    assert_equal(stod_view((sview){"infx", 4}, &d, NULL) == 3 && d == INFINITY, "Must parse inf", __func__);
+    assert_equal(stod_view((sview){"NaN", 3}, &d, NULL) == 3 && d != d, "Must parse nan", __func__);
+}
+
+void test_sjoinv_invalid_input(void) {
+    sview parts[] = {{"a", 1}, {NULL, 1}};
+    const sview* volatile noparts = NULL;
+    assert_equal(sjoinv(NULL, 1, noparts, 1, ",") == NULL, "Must fail on NULL parts", __func__);
+    assert_equal(sjoinv(NULL, 2, parts, 1, ",") == NULL, "Must fail on a NULL part", __func__);
+    assert_equal(sjoinv(snew("x"), 1, parts, 1, NULL) == NULL, "Must fail on NULL separator", __func__);
+    sview huge[] = {{"a", SIZE_MAX - 1}, {"b", 1}};
+    assert_equal(sjoinv(snew("x"), 2, huge, 1, ",") == NULL, "Must fail on overflow", __func__);
+}
+
+void test_sjoinv_as_intended(void) {
+    sview parts[] = {{"id", 2}, {"", 0}, {"a\0b", 3}, {NULL, 0}};
+    string s = sjoinv(NULL, 4, parts, 2, ", ");
+    assert_equal(sgetlen(s) == 11 && memcmp(s, "id, , a\0b, ", 12) == 0, "Must join binary parts", __func__);
+    s = sjoinv(s, 2, parts, 0, NULL);
+    assert_equal(sgetlen(s) == 13 && memcmp(s + 11, "id", 3) == 0, "Must append to a string", __func__);
+    string same = sjoinv(s, 0, NULL, 1, ",");
+    assert_equal(same == s && sgetlen(s) == 13, "No parts must keep the string", __func__);
+    sfree(s);
+    s = sjoinv(NULL, 0, NULL, 0, NULL);
+    assert_equal(s != NULL && sgetlen(s) == 0, "No parts must make an empty string", __func__);
+    sfree(s);
+
+    /* Big enough for the thread pool */
+    size_t n = 700000;
+    sview* many = malloc(n * sizeof(sview));
+    char* words[] = {"alpha", "be", "", "gamma-delta", "x"};
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        char* w = words[(i * 7) % 5];
+        many[i] = (sview){w, strlen(w)};
+        total += many[i].len + 3;
+    }
+    s = sjoinv(snew("head:"), n, many, 3, " | ");
+    assert_equal(sgetlen(s) == 5 + total - 3, "Must size a large join", __func__);
+    int ok = 1;
+    char* p = s + 5;
+    for (size_t i = 0; i < n && ok; i++) {
+        ok &= memcmp(p, many[i].ptr, many[i].len) == 0;
+        p += many[i].len;
+        if (i < n - 1) {
+            ok &= memcmp(p, " | ", 3) == 0;
+            p += 3;
+        }
+    }
+    assert_equal(ok && *p == 0 && memcmp(s, "head:", 5) == 0, "Must copy a large join", __func__);
+    sfree(s);
+    free(many);
+}
+
+void test_stok_invalid_input(void) {
+    stok t;
+    sview v;
+    stok_init(&t, NULL, 1, ",");
+    assert_equal(!stok_next(&t, &v), "NULL string must have no tokens", __func__);
+    string s = snew("a,b");
+    stok_init(&t, s, 0, ",");
+    assert_equal(!stok_next(&t, &v), "Empty separator must have no tokens", __func__);
+    stok_init(&t, s, 1, NULL);
+    assert_equal(!stok_next(&t, &v), "NULL separator must have no tokens", __func__);
+    stok_initp(&t, sview_of(s), NULL);
+    assert_equal(!stok_next(&t, &v), "NULL pattern must have no tokens", __func__);
+    stok_init(&t, s, 1, ",");
+    assert_equal(!stok_next(&t, NULL) && !stok_next(NULL, &v), "Must fail on NULL arguments", __func__);
+    assert_equal(stok_rest(NULL).ptr == NULL, "NULL cursor must have no rest", __func__);
+    stok_init(NULL, s, 1, ",");
+    sfree(s);
+}
+
+void test_stok_as_intended(void) {
+    string s = snew("a,,bc,");
+    const char* want[] = {"a", "", "bc", ""};
+    stok t;
+    sview v;
+    size_t n = 0;
+    int ok = 1;
+    stok_init(&t, s, 1, ",");
+    while (stok_next(&t, &v)) {
+        ok &= n < 4 && v.len == strlen(want[n]) && memcmp(v.ptr, want[n], v.len) == 0;
+        n++;
+    }
+    assert_equal(ok && n == 4, "Must yield every token", __func__);
+    assert_equal(!stok_next(&t, &v) && stok_rest(&t).len == 0, "Must stay exhausted", __func__);
+    sfree(s);
+
+    s = snew("GET / HTTP/1.1\r\nHost: x\r\n\r\nbody\r\nbytes");
+    stok_init(&t, s, 2, "\r\n");
+    assert_equal(stok_next(&t, &v) && v.len == 14 && v.ptr == s, "Must point into the string", __func__);
+    assert_equal(stok_next(&t, &v) && v.len == 7 && memcmp(v.ptr, "Host: x", 7) == 0, "Must find the next line", __func__);
+    assert_equal(stok_next(&t, &v) && v.len == 0, "Must yield the blank line", __func__);
+    assert_equal(stok_rest(&t).len == 11 && memcmp(stok_rest(&t).ptr, "body", 4) == 0, "Must expose the rest", __func__);
+    sfree(s);
+
+    s = snew("");
+    stok_init(&t, s, 1, "\n");
+    assert_equal(stok_next(&t, &v) && v.len == 0 && !stok_next(&t, &v), "Empty string must have one empty token", __func__);
+    sfree(s);
+
+    /* Long separators, compiled or not, must agree with ssplit_views */
+    size_t len = 200000;
+    s = snewlen(NULL, len);
+    srand(23);
+    for (size_t i = 0; i < len; i++)
+        s[i] = "ab"[rand() % 2];
+    const char* sep = "abbaabbaabbaabbaabbaabbaabbaabbaabbaab";
+    size_t seplen = strlen(sep);
+    ssize_t total = ssplit_views(sview_of(s), seplen, sep, NULL, 0);
+    sview* parts = malloc(total * sizeof(sview));
+    ssplit_views(sview_of(s), seplen, sep, parts, total);
+    spattern* sp = spcompile(seplen, sep);
+    stok u;
+    stok_init(&t, s, seplen, sep);
+    stok_initp(&u, sview_of(s), sp);
+    n = 0;
+    sview w;
+    while (stok_next(&t, &v)) {
+        ok &= stok_next(&u, &w) && v.ptr == w.ptr && v.len == w.len;
+        ok &= (ssize_t)n < total && v.ptr == parts[n].ptr && v.len == parts[n].len;
+        n++;
+    }
+    assert_equal(ok && (ssize_t)n == total && !stok_next(&u, &w), "Must agree with ssplit_views", __func__);
+    spfree(sp);
+    free(parts);
+    sfree(s);
+}
+
+void test_scharset_invalid_input(void) {
+    scharset ws = scharset_of(2, " \t");
+    scharset none = scharset_of(3, NULL);
+    assert_equal(!scharset_has(&none, ' ') && !scharset_has(NULL, ' '), "NULL must give an empty set", __func__);
+    assert_equal(!strimchars(NULL, &ws) && !srtrimchars(NULL, &ws) && !sltrimchars(NULL, &ws), "Must fail on NULL string", __func__);
+    string s = snew(" a ");
+    assert_equal(!strimchars(s, NULL) && !srtrimchars(s, NULL), "Must fail on NULL set", __func__);
+    assert_equal(sspn(NULL, &ws) == 0 && scspn(s, NULL) == 0, "Spans of NULL must be empty", __func__);
+    assert_equal(sfind_any_of(NULL, &ws) == -1 && sfind_any_of(s, NULL) == -1, "Must not find in NULL", __func__);
+    sfree(s);
+    s = sshare(snew(" a "));
+    string other = sretain(s);
+    assert_equal(!strimchars(s, &ws) && sgetlen(s) == 3, "Must refuse shared strings", __func__);
+    sfree(other);
+    sfree(s);
+}
+
+void test_scharset_as_intended(void) {
+    scharset ws = scharset_of(4, " \t\r\n");
+    string s = snew(" \t hello world\r\n");
+    assert_equal(strimchars(s, &ws) && strcmp(s, "hello world") == 0 && sgetlen(s) == 11, "Must trim both ends", __func__);
+    sfree(s);
+    s = snew("  x  ");
+    assert_equal(srtrimchars(s, &ws) && strcmp(s, "  x") == 0, "Must trim the end", __func__);
+    assert_equal(sltrimchars(s, &ws) && strcmp(s, "x") == 0, "Must trim the beginning", __func__);
+    sfree(s);
+    s = snew(" \t\r\n");
+    assert_equal(strimchars(s, &ws) && sgetlen(s) == 0 && s[0] == 0, "Must trim everything", __func__);
+    sfree(s);
+
+    /* Long enough for the vector kernels, with bytes above 0x7f */
+    char line[300];
+    memset(line, ' ', 100);
+    memcpy(line + 100, "key=\xe9t\xc3\xa9;v!", 11);
+    memset(line + 111, '\t', 189);
+    s = snewlen(line, 300);
+    scharset delims = scharset_of(3, "=;\xc3");
+    assert_equal(sspn(s, &ws) == 100, "sspn must skip leading blanks", __func__);
+    assert_equal(sfind_any_of(s, &delims) == 103, "Must find the first delimiter", __func__);
+    sview v = {s + 104, 196};
+    assert_equal(scspn_view(v, &delims) == 2 && sfind_any_of_view(v, &delims) == 2, "Must find high bytes", __func__);
+    assert_equal(scspn(s, &delims) == 103 && sfind_any_of(s, &ws) == 0, "scspn must stop at the set", __func__);
+    assert_equal(strimchars(s, &ws) && sgetlen(s) == 11 && memcmp(s, "key=", 4) == 0, "Must trim long runs", __func__);
+    scharset high = scharset_of(1, "\xe9");
+    assert_equal(sfind_any_of(s, &high) == 4 && scharset_has(&high, '\xe9') && !scharset_has(&high, 'e'), "Must handle bytes above 0x7f", __func__);
+    sfree(s);
+}
+
+void test_sutf8_invalid_input(void) {
+    sview none = {NULL, 3};
+    assert_equal(!sutf8_valid(NULL) && !sutf8_valid_view(none), "NULL must not be valid", __func__);
+    assert_equal(sutf8_count(NULL) == -1 && sutf8_count_view(none) == -1, "Must not count NULL", __func__);
+    assert_equal(sutf8_offset(NULL, 0) == -1 && sutf8_offset_view(none, 0) == -1, "Must not index NULL", __func__);
+    const char* bad[] = {
+        "\x80", "a\xbf", "\xc0\xaf", "\xc1\xbf", "\xe0\x9f\xbf", "\xf0\x8f\xbf\xbf",
+        "\xed\xa0\x80", "\xed\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff",
+        "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\xc3(", "\xe2\x28\xa1", "\xc3\xa9\xa9",
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        string s = snew(bad[i]);
+        ok &= !sutf8_valid(s) && !sutf8_valid(s);
+        sfree(s);
+    }
+    assert_equal(ok, "Must reject overlongs, surrogates, large and broken sequences", __func__);
+    string s = snew("abc");
+    assert_equal(sutf8_offset(s, 4) == -1, "Must fail past the last code point", __func__);
+    sfree(s);
+}
+
+void test_sutf8_as_intended(void) {
+    string s = snew("na\xc3\xafve \xe2\x82\xac \xf0\x9f\x98\x80");
+    assert_equal(sutf8_valid(s) && sutf8_valid(s), "Must accept valid UTF-8", __func__);
+    assert_equal(sutf8_count(s) == 9, "Must count code points", __func__);
+    assert_equal(sutf8_offset(s, 3) == 4 && sutf8_offset(s, 7) == 10 && sutf8_offset(s, 8) == 11,
+                 "Must find code point offsets", __func__);
+    assert_equal(sutf8_offset(s, 9) == 15 && sutf8_offset(s, 0) == 0, "Must handle both ends", __func__);
+    s = scat(s, 2, "\xe2\x82");
+    assert_equal(!sutf8_valid(s), "Must check again after a change", __func__);
+    s = scat(s, 1, "\xac");
+    assert_equal(sutf8_valid(s) && sutf8_count(s) == 10, "Must accept the completed sequence", __func__);
+    sfree(s);
+    assert_equal(sutf8_valid_view((sview){"", 0}) && sutf8_count_view((sview){"", 0}) == 0, "Empty input is valid", __func__);
+    s = sshare(snew("shared \xc3\xa9t\xc3\xa9 string"));
+    string other = sretain(s);
+    sarena* a = sacreate(0);
+    string in = sanew(a, "arena \xe2\x82\xac string");
+    assert_equal(sutf8_valid(s) && sutf8_valid(other) && sutf8_valid(in),
+                 "Must validate shared and arena strings", __func__);
+    assert_equal(sutf8_valid(in) && (in[-1] & (1 << 3)) == 0, "Must not tag arena strings", __func__);
+    sfree(other);
+    sfree(s);
+    safree(a);
+
+    /* Long inputs take the vector paths, sequences straddle the blocks */
+    size_t n = 10000;
+    char* buf = malloc(n * 3);
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 7 == 3) {
+            memcpy(buf + len, "\xe2\x82\xac", 3);
+            len += 3;
+        } else {
+            buf[len++] = (char)('a' + i % 26);
+        }
+    }
+    s = snewlen(buf, len);
+    assert_equal(sutf8_valid(s) && sutf8_count(s) == (ssize_t)n, "Must validate and count long input", __func__);
+    bool ok = true;
+    for (size_t i = 0, off = 0; i <= n; off += (i % 7 == 3) ? 3 : 1, i++)
+        ok &= sutf8_offset(s, i) == (ssize_t)off;
+    assert_equal(ok, "Must find every code point of long input", __func__);
+    ok = true;
+    for (size_t cut = len - 40; cut < len; cut++)
+        ok &= sutf8_valid_view((sview){buf, cut}) == ((buf[cut] & 0xc0) != 0x80);
+    assert_equal(ok, "Must reject input cut inside a sequence", __func__);
+    buf[len / 2 + (buf[len / 2] & 0x80 ? 0 : 1)] = (char)0xc0;
+    assert_equal(!sutf8_valid_view((sview){buf, len}), "Must find an error in long input", __func__);
+    sfree(s);
+    free(buf);
+}
+
+void test_scat_geometric_growth(void) {
+    string s = snew("");
+    for (int i = 0; i < 1000; i++)
+        s = scat(s, 10, "abcdefghij");
+    assert_equal(s != NULL, "Must be a valid pointer", __func__);
+    assert_equal(sgetlen(s) == 10000, "Length must be updated", __func__);
+    assert_equal(sgetavail(s) > 0, "Appends must leave spare capacity", __func__);
+    assert_equal(memcmp(s + 9990, "abcdefghij", 11) == 0, "Content must be kept", __func__);
+    sfree(s);
+}
+
+void test_sreserve_as_intended(void) {
+    assert_equal(sreserve(NULL, 10) == NULL, "Must fail on NULL", __func__);
+    assert_equal(sgetavail(NULL) == 0, "NULL has no capacity", __func__);
+
+    string s = snew("abc");
+    assert_equal(sgetavail(s) == 0, "New strings are exact", __func__);
+    s = sreserve(s, 100);
+    assert_equal(s != NULL, "Must reserve", __func__);
+    assert_equal(sgetavail(s) == 97, "Capacity must be exact", __func__);
+    assert_equal(sgetlen(s) == 3 && strcmp(s, "abc") == 0, "Content must be kept", __func__);
+    string same = sreserve(s, 50);
+    assert_equal(same == s, "Smaller reservation must not move", __func__);
+
+    s = sreserve(s, 70000);
+    assert_equal(s != NULL && sgetavail(s) == 69997, "Must switch header", __func__);
+    assert_equal(strcmp(s, "abc") == 0, "Content must be kept 2", __func__);
+    char* before = s;
+    for (int i = 0; i < 1000; i++)
+        s = scat(s, 10, "abcdefghij");
+    assert_equal(s == before, "Reserved capacity must be used", __func__);
+    sfree(s);
+}
+
+void test_sshrink_to_fit_as_intended(void) {
+    assert_equal(sshrink_to_fit(NULL) == NULL, "Must fail on NULL", __func__);
+
+    string s = snewlen(NULL, 300);
+    memcpy(s, "short", 6);
+    supdatelen(s, 5);
+    s = sshrink_to_fit(s);
+    assert_equal(s != NULL, "Must shrink", __func__);
+    assert_equal(sgetavail(s) == 0, "No spare capacity must be left", __func__);
+    assert_equal(sgetlen(s) == 5 && strcmp(s, "short") == 0, "Content must be kept", __func__);
+    s = scat(s, 3, "end");
+    assert_equal(s != NULL && strcmp(s, "shortend") == 0, "Must still append", __func__);
+    sfree(s);
+}
+
+void test_sclear_as_intended(void) {
+    sclear(NULL);
+    string s = snew("something longer than a tiny string");
+    sclear(s);
+    assert_equal(sgetlen(s) == 0, "Length must be 0", __func__);
+    assert_equal(s[0] == 0, "Must be empty", __func__);
+    assert_equal(sgetavail(s) == 35, "Capacity must be kept", __func__);
+    char* before = s;
+    s = scat(s, 4, "some");
+    assert_equal(s == before, "Capacity must be reused", __func__);
+    assert_equal(strcmp(s, "some") == 0, "Must append", __func__);
+    sfree(s);
+}
+
+void test_sarena_invalid_input(void) {
+    size_t n;
+    assert_equal(sanewlen(NULL, "abc", 3) == NULL, "Must fail on NULL arena", __func__);
+    assert_equal(sanew(NULL, "abc") == NULL, "Must fail on NULL arena 2", __func__);
+    sarena* a = sacreate(0);
+    assert_equal(a != NULL, "Must create an arena", __func__);
+    assert_equal(sanew(a, NULL) == NULL, "Must fail on NULL input", __func__);
+    assert_equal(sadup(a, NULL) == NULL, "Must fail on NULL string", __func__);
+    assert_equal(saslice(a, NULL, 0, 1) == NULL, "Must fail on NULL string 2", __func__);
+    assert_equal(sasplit(a, NULL, 1, ",", &n) == NULL, "Must fail on NULL string 3", __func__);
+    string s = sanew(a, "abc");
+    assert_equal(saslice(a, s, 2, 1) == NULL, "Must fail on start >= end", __func__);
+    assert_equal(sasplit(a, s, 0, "", &n) == NULL, "Must fail on empty separator", __func__);
+    assert_equal(sasplit(a, s, 4, "abcd", &n) == NULL, "Must fail on long separator", __func__);
+    sareset(NULL);
+    safree(NULL);
+    safree(a);
+}
+
+void test_sarena_as_intended(void) {
+    sarena* a = sacreate(128);
+    string s = sanew(a, "GET /index.html HTTP/1.1");
+    assert_equal(s != NULL && sgetlen(s) == 24, "Must create a string", __func__);
+    assert_equal(strcmp(s, "GET /index.html HTTP/1.1") == 0, "Content must be copied", __func__);
+    sfree(s);
+    assert_equal(strcmp(s, "GET /index.html HTTP/1.1") == 0, "sfree must not release it", __func__);
+
+    string z = sanewlen(a, NULL, 10);
+    assert_equal(z != NULL && sgetlen(z) == 10 && z[5] == 0, "Must zero the buffer", __func__);
+    string d = sadup(a, s);
+    assert_equal(d != s && strcmp(d, s) == 0, "Must duplicate", __func__);
+    string sl = saslice(a, s, 4, 15);
+    assert_equal(sl != NULL && strcmp(sl, "/index.html") == 0, "Must slice", __func__);
+
+    size_t n;
+    string* parts = sasplit(a, s, 1, " ", &n);
+    assert_equal(parts != NULL && n == 3, "Must split", __func__);
+    assert_equal(strcmp(parts[0], "GET") == 0 && strcmp(parts[2], "HTTP/1.1") == 0, "Pieces must be correct", __func__);
+    assert_equal(sgetlen(parts[1]) == 11, "Piece length must be correct", __func__);
+
+    string big = sanewlen(a, NULL, 1000);
+    assert_equal(big != NULL && sgetlen(big) == 1000, "Must hold strings larger than a block", __func__);
+    string after = sanew(a, "after");
+    assert_equal(after != NULL && strcmp(after, "after") == 0, "Must keep allocating", __func__);
+
+    string grown = scat(d, 4, "!!!!");
+    assert_equal(grown != NULL && strcmp(grown, "GET /index.html HTTP/1.1!!!!") == 0, "Must move to the heap", __func__);
+    assert_equal(strcmp(d, "GET /index.html HTTP/1.1") == 0, "Arena copy must be untouched", __func__);
+    sfree(grown);
+
+    sareset(a);
+    string again = sanew(a, "again");
+    assert_equal(again != NULL && strcmp(again, "again") == 0, "Must reuse the arena", __func__);
+    safree(a);
+}
+
+void test_sview_invalid_input(void) {
+    sview null = sview_of(NULL);
+    assert_equal(null.ptr == NULL && null.len == 0, "NULL string must give an empty view", __func__);
+    assert_equal(sfind_view(null, 1, "a") == -1, "Must fail on NULL view", __func__);
+    assert_equal(srfind_view(null, 1, "a") == -1, "Must fail on NULL view 2", __func__);
+    assert_equal(scount_view(null, 1, "a") == -1, "Must fail on NULL view 3", __func__);
+    assert_equal(!sstartswith_view(null, 1, "a"), "Must fail on NULL view 4", __func__);
+    assert_equal(!sendswith_view(null, 1, "a"), "Must fail on NULL view 5", __func__);
+    assert_equal(ssplit_views(null, 1, ",", NULL, 0) == -1, "Must fail on NULL view 6", __func__);
+    assert_equal(sslice_view(null, 0, 1).ptr == NULL, "Must fail on NULL view 7", __func__);
+    assert_equal(sbite_view(NULL, 1, ",").ptr == NULL, "Must fail on NULL view 8", __func__);
+
+    string s = snew("abc");
+    sview v = sview_of(s);
+    assert_equal(sfind_view(v, 0, "") == -1, "Must fail on empty pattern", __func__);
+    assert_equal(scount_view(v, 4, "abcd") == -1, "Must fail on long pattern", __func__);
+    assert_equal(sslice_view(v, 2, 2).ptr == NULL, "Must fail on start >= end", __func__);
+    assert_equal(sslice_view(v, 1, 4).ptr == NULL, "Must fail on end > len", __func__);
+    assert_equal(ssplit_views(v, 1, ",", NULL, 1) == -1, "Must fail on NULL output", __func__);
+    sview before = v;
+    assert_equal(sbite_view(&v, 1, ",").ptr == NULL, "Must fail when not found", __func__);
+    assert_equal(v.ptr == before.ptr && v.len == before.len, "View must be unchanged", __func__);
+    sfree(s);
+}
+
+void test_sview_as_intended(void) {
+    string s = snew("Host: example.org\r\nAccept: */*\r\nX-Id: 42");
+    sview v = sview_of(s);
+    assert_equal(v.ptr == s && v.len == sgetlen(s), "View must cover the string", __func__);
+    assert_equal(sfind_view(v, 2, "\r\n") == 17, "Must find", __func__);
+    assert_equal(srfind_view(v, 2, "\r\n") == 30, "Must find from the right", __func__);
+    assert_equal(scount_view(v, 2, "\r\n") == 2, "Must count", __func__);
+    assert_equal(sstartswith_view(v, 5, "Host:"), "Must start with", __func__);
+    assert_equal(sendswith_view(v, 2, "42"), "Must end with", __func__);
+
+    sview host = sslice_view(v, 6, 17);
+    assert_equal(host.ptr == s + 6 && host.len == 11, "Slice must point into s", __func__);
+    assert_equal(memcmp(host.ptr, "example.org", 11) == 0, "Slice must be correct", __func__);
+    assert_equal(sfind_view(host, 1, ".") == 7, "Must search inside a slice", __func__);
+    assert_equal(sfind_view(host, 2, "\r\n") == -1, "Must not look past the slice", __func__);
+
+    sview lines[4];
+    assert_equal(ssplit_views(v, 2, "\r\n", NULL, 0) == 3, "Must size the split", __func__);
+    assert_equal(ssplit_views(v, 2, "\r\n", lines, 4) == 3, "Must split", __func__);
+    assert_equal(lines[1].len == 11 && memcmp(lines[1].ptr, "Accept: */*", 11) == 0, "Piece must be correct", __func__);
+    assert_equal(lines[2].ptr == s + 32, "Pieces must point into s", __func__);
+    assert_equal(ssplit_views(v, 2, "\r\n", lines, 1) == 3, "Must report the total", __func__);
+
+    sview rest = v;
+    sview first = sbite_view(&rest, 2, "\r\n");
+    assert_equal(first.ptr == s && first.len == 17, "Must bite the head", __func__);
+    assert_equal(rest.ptr == s + 19 && rest.len == sgetlen(s) - 19, "Must advance the rest", __func__);
+    assert_equal(strcmp(s, "Host: example.org\r\nAccept: */*\r\nX-Id: 42") == 0, "String must be untouched", __func__);
+
+    spattern* colon = spcompile(2, ": ");
+    assert_equal(sfindp_view(rest, colon) == 6, "Must find a compiled pattern", __func__);
+    assert_equal(scountp_view(rest, colon) == 2, "Must count a compiled pattern", __func__);
+    spfree(colon);
+
+    sarena* a = sacreate(0);
+    size_t n;
+    sview* parts = sasplit_views(a, v, 2, "\r\n", &n);
+    assert_equal(parts != NULL && n == 3, "Must split into the arena", __func__);
+    assert_equal(parts[2].len == 8 && memcmp(parts[2].ptr, "X-Id: 42", 8) == 0, "Last piece must be correct", __func__);
+    safree(a);
+    sfree(s);
+}
+
+void test_spcompile_invalid_input(void) {
+    assert_equal(spcompile(0, "") == NULL, "Must fail on empty pattern", __func__);
+    assert_equal(spcompile(3, NULL) == NULL, "Must fail on NULL pattern", __func__);
+    assert_equal(spgetlen(NULL) == 0, "NULL pattern has no length", __func__);
+    spfree(NULL);
+
+    spattern* p = spcompile(3, "abc");
+    assert_equal(sfindp(NULL, p) == -1, "Must fail on NULL string", __func__);
+    assert_equal(scountp(NULL, p) == -1, "Must fail on NULL string 2", __func__);
+    assert_equal(sremovep(NULL, p) == false, "Must fail on NULL string 3", __func__);
+    string s = snew("ab");
+    assert_equal(sfindp(s, NULL) == -1, "Must fail on NULL pattern", __func__);
+    assert_equal(sfindp(s, p) == -1, "Must fail when pattern is longer", __func__);
+    assert_equal(srfindp(s, p) == -1, "Must fail when pattern is longer 2", __func__);
+    assert_equal(scountp(s, p) == -1, "Must fail when pattern is longer 3", __func__);
+    sfree(s);
+    spfree(p);
+}
+
+void test_spattern_as_intended(void) {
+    string s = snew("key=value; key2=value2; key3=value3");
+    spattern* sep = spcompile(2, "; ");
+    assert_equal(spgetlen(sep) == 2, "Length must be stored", __func__);
+    assert_equal(sfindp(s, sep) == 9, "Pattern must be found", __func__);
+    assert_equal(srfindp(s, sep) == 22, "Pattern must be found 2", __func__);
+    assert_equal(scountp(s, sep) == 2, "Pattern must be counted", __func__);
+
+    size_t n;
+    string* arr = ssplitp(s, sep, &n);
+    assert_equal(arr != NULL && n == 3, "Must split into 3 elems", __func__);
+    assert_equal(strcmp(arr[1], "key2=value2") == 0, "Middle elem must be correct", __func__);
+    sfreearr(arr, n);
+
+    string r = sreplacep(s, sep, 1, "&");
+    assert_equal(strcmp(r, "key=value&key2=value2&key3=value3") == 0, "Must replace", __func__);
+    sfree(r);
+
+    string first = sbitep(s, sep);
+    assert_equal(strcmp(first, "key=value") == 0, "Must bite", __func__);
+    assert_equal(strcmp(s, "key2=value2; key3=value3") == 0, "Must leave the rest", __func__);
+    sfree(first);
+    spfree(sep);
+
+    spattern* eq = spcompile(1, "=");
+    assert_equal(sremovep(s, eq), "Must remove", __func__);
+    assert_equal(strcmp(s, "key2value2; key3value3") == 0, "Must remove every match", __func__);
+    assert_equal(sgetlen(s) == 22, "Length must be updated", __func__);
+    spfree(eq);
+    sfree(s);
+
+    char buf[1000];
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = 'a' + i % 7;
+    string big = snewlen(buf, sizeof(buf));
+    const char* needles[] = {"bcdefgabcdefgabcdefgabcdefgabcdefga", "gabcdefg", "cde", "fgabcdeg"};
+    for (size_t i = 0; i < sizeof(needles) / sizeof(needles[0]); i++) {
+        size_t len = strlen(needles[i]);
+        spattern* p = spcompile(len, needles[i]);
+        assert_equal(sfindp(big, p) == sfind(big, len, needles[i]), "Must agree with sfind", __func__);
+        assert_equal(srfindp(big, p) == srfind(big, len, needles[i]), "Must agree with srfind", __func__);
+        assert_equal(scountp(big, p) == scount(big, len, needles[i]), "Must agree with scount", __func__);
+        spfree(p);
+    }
+    sfree(big);
+
+    /* Overlapping matches of a periodic needle, counted in one Two-Way pass */
+    memset(buf, 'a', sizeof(buf));
+    memcpy(buf + 500, "ab", 2);
+    big = snewlen(buf, sizeof(buf));
+    spattern* run = spcompile(64, buf);
+    assert_equal(scountp(big, run) == scount(big, 64, buf) && scountp(big, run) == 438 + 435,
+                 "Must count overlapping periodic matches", __func__);
+    spfree(run);
+    sfree(big);
+}
+
+void test_smcompile_invalid_input(void) {
+    const char* patterns[] = {"GET", "", "POST"};
+    size_t lens[] = {3, 0, 4};
+    const size_t* volatile nolens = NULL;
+    const char** volatile nopatterns = NULL;
+    assert_equal(smcompile(0, lens, patterns) == NULL, "Must fail on 0 patterns", __func__);
+    assert_equal(smcompile(3, nolens, patterns) == NULL, "Must fail on NULL lens", __func__);
+    assert_equal(smcompile(3, lens, nopatterns) == NULL, "Must fail on NULL patterns", __func__);
+    assert_equal(smcompile(3, lens, patterns) == NULL, "Must fail on empty pattern", __func__);
+    smfree(NULL);
+
+    smulti* m = smcompile(1, lens, patterns);
+    size_t counts[1];
+    assert_equal(smfind(NULL, m, NULL) == -1, "Must fail on NULL string", __func__);
+    assert_equal(smfindall(NULL, m, NULL, 0) == -1, "Must fail on NULL string 2", __func__);
+    assert_equal(smcount(NULL, m, counts) == -1, "Must fail on NULL string 3", __func__);
+    string s = snew("GET");
+    assert_equal(smfind(s, NULL, NULL) == -1, "Must fail on NULL automaton", __func__);
+    assert_equal(smfindall(s, m, NULL, 1) == -1, "Must fail on NULL output", __func__);
+    assert_equal(smcount(s, m, NULL) == -1, "Must fail on NULL counts", __func__);
+    sfree(s);
+    smfree(m);
+}
+
+void test_smulti_as_intended(void) {
+    const char* patterns[] = {"he", "she", "his", "hers", "he"};
+    size_t lens[] = {2, 3, 3, 4, 2};
+    smulti* m = smcompile(5, lens, patterns);
+    assert_equal(m != NULL, "Must compile", __func__);
+
+    string s = snew("ushers and his sheep");
+    size_t which = 99;
+    assert_equal(smfind(s, m, &which) == 1, "Leftmost match must be found", __func__);
+    assert_equal(which == 1, "Leftmost match must be 'she'", __func__);
+
+    smatch matches[16];
+    ssize_t found = smfindall(s, m, matches, 16);
+    assert_equal(found == 8, "Every match must be reported", __func__);
+    assert_equal(matches[0].pos == 1 && matches[0].pattern == 1, "First match must be 'she'", __func__);
+    assert_equal(matches[1].pos == 2 && matches[1].pattern == 0, "Second match must be 'he'", __func__);
+    assert_equal(matches[2].pos == 2 && matches[2].pattern == 4, "Duplicate pattern must be reported", __func__);
+    assert_equal(matches[3].pos == 2 && matches[3].pattern == 3, "Fourth match must be 'hers'", __func__);
+    assert_equal(smfindall(s, m, NULL, 0) == found, "Must count without output", __func__);
+
+    size_t counts[5];
+    assert_equal(smcount(s, m, counts) == found, "Total must match", __func__);
+    for (size_t i = 0; i < 5; i++)
+        assert_equal(counts[i] == (size_t)scount(s, lens[i], patterns[i]), "Must agree with scount", __func__);
+    sfree(s);
+
+    string none = snew("nothing to see");
+    assert_equal(smfind(none, m, &which) == -1, "Must not be found", __func__);
+    assert_equal(smcount(none, m, counts) == 0, "Must count nothing", __func__);
+    sfree(none);
+    smfree(m);
+}
+
+void test_sarray_invalid_input(void) {
+    assert_equal(!sarrpush(NULL, "a", 1), "Must fail on NULL array", __func__);
+    assert_equal(sarrlen(NULL) == 0, "NULL array must be empty", __func__);
+    assert_equal(sarrget(NULL, 0).ptr == NULL, "Must fail on NULL array 2", __func__);
+    assert_equal(sjoin_array(NULL, 1, ",") == NULL, "Must fail on NULL array 3", __func__);
+    sarrfree(NULL);
+
+    sarray* a = sarrnew(0, 0);
+    assert_equal(a != NULL, "Must create an empty array", __func__);
+    assert_equal(!sarrpush(a, NULL, 1), "Must fail on NULL input", __func__);
+    assert_equal(sjoin_array(a, 1, ",") == NULL, "Must fail on empty array", __func__);
+    assert_equal(sarrget(a, 0).ptr == NULL, "Must fail on out of range index", __func__);
+    size_t i = 0;
+    sview v;
+    assert_equal(!sarrnext(a, &i, &v), "Must not iterate an empty array", __func__);
+    sarrfree(a);
+
+    string s = snew("abc");
+    assert_equal(ssplit_array(NULL, 1, ",") == NULL, "Must fail on NULL string", __func__);
+    assert_equal(ssplit_array(s, 1, NULL) == NULL, "Must fail on NULL separator", __func__);
+    assert_equal(ssplit_array(s, 0, "") == NULL, "Must fail on empty separator", __func__);
+    assert_equal(ssplit_array(s, 4, "abcd") == NULL, "Must fail on long separator", __func__);
+    sfree(s);
+}
+
+void test_sarray_as_intended(void) {
+    sarray* a = sarrnew(2, 4);
+    const char* words[] = {"alpha", "", "gamma", "delta", "epsilon"};
+    for (size_t i = 0; i < 5; i++)
+        assert_equal(sarrpush(a, words[i], strlen(words[i])), "Must append", __func__);
+    assert_equal(sarrlen(a) == 5, "Must hold all elements", __func__);
+    sview v = sarrget(a, 2);
+    assert_equal(v.len == 5 && memcmp(v.ptr, "gamma", 5) == 0, "Must get by index", __func__);
+    assert_equal(strcmp(sarrget(a, 4).ptr, "epsilon") == 0, "Elements must be terminated", __func__);
+    assert_equal(sarrget(a, 1).len == 0, "Must keep empty elements", __func__);
+
+    size_t i = 0, total = 0;
+    while (sarrnext(a, &i, &v))
+        total += v.len;
+    assert_equal(i == 5 && total == 22, "Must iterate over every element", __func__);
+
+    string joined = sjoin_array(a, 2, ", ");
+    assert_equal(strcmp(joined, "alpha, , gamma, delta, epsilon") == 0, "Must join", __func__);
+    assert_equal(sgetlen(joined) == 30, "Joined length must be exact", __func__);
+    sarrfree(a);
+
+    a = ssplit_array(joined, 2, ", ");
+    assert_equal(sarrlen(a) == 5, "Must split into all pieces", __func__);
+    for (size_t j = 0; j < 5; j++) {
+        v = sarrget(a, j);
+        assert_equal(v.len == strlen(words[j]) && memcmp(v.ptr, words[j], v.len) == 0,
+                     "Split must match the input", __func__);
+    }
+    string again = sjoin_array(a, 2, ", ");
+    assert_equal(strcmp(again, joined) == 0, "Split and join must round trip", __func__);
+    sfree(again);
+    sarrfree(a);
+    sfree(joined);
+
+    string s = snew(",x,,");
+    a = ssplit_array(s, 1, ",");
+    assert_equal(sarrlen(a) == 4, "Must keep leading and trailing pieces", __func__);
+    assert_equal(sarrget(a, 1).len == 1 && sarrget(a, 3).len == 0, "Must split at every separator", __func__);
+    sarrfree(a);
+    sfree(s);
+}
+
 void test_scat_null_input(void) {
     assert_equal(scat(NULL, 1, "/") == NULL, "Must fail", __func__);
     string s1 = snew("Yeah");
@@ -948,6 +2428,9 @@ int main(void) {
     test_slower_null_passed();
     test_slower_weird_strings();
 
+    test_supper_ascii_as_intended();
+    test_supper_follows_locale();
+
     test_sstartswith_null_input();
     test_sstartswith_invalid_len();
     test_sstartswith_as_intended();
@@ -959,6 +2442,10 @@ int main(void) {
     test_sfind_as_intended();
     test_sfind_null_input();
     test_sfind_invalid_len();
+    test_sfind_block_boundaries();
+    test_sfind_advanced_as_intended();
+    test_sparallel_invalid_input();
+    test_sparallel_as_intended();
     // test_sfind_time();
 
     test_srfind_as_intended();
@@ -993,10 +2480,59 @@ int main(void) {
     test_sltrimchar_as_intended();
 
     test_sreplace_as_intended();
+    test_sreplace_growing();
+    test_sreplace_inplace_invalid_input();
+    test_sreplace_inplace_as_intended();
 
     test_scat_null_input();
     test_scat_as_intended();
     test_scat_as_intended_buf_allocated_before();
+    test_scat_geometric_growth();
+
+    test_sreserve_as_intended();
+    test_sshrink_to_fit_as_intended();
+    test_sclear_as_intended();
+    test_tiny_strings();
+    test_shash_as_intended();
+    test_sshare_invalid_input();
+    test_sshare_as_intended();
+    test_sshare_threads();
+    test_smapfile_invalid_input();
+    test_smapfile_as_intended();
+    test_sstream_invalid_input();
+    test_sstream_as_intended();
+    test_srope_invalid_input();
+    test_srope_as_intended();
+    test_scatfmt_invalid_input();
+    test_scatfmt_as_intended();
+    test_stoi64_invalid_input();
+    test_stoi64_as_intended();
+    test_stod_as_intended();
+    test_sjoinv_invalid_input();
+    test_sjoinv_as_intended();
+    test_stok_invalid_input();
+    test_stok_as_intended();
+    test_scharset_invalid_input();
+    test_scharset_as_intended();
+    test_sutf8_invalid_input();
+    test_sutf8_as_intended();
+
+    test_sarena_invalid_input();
+    test_sarena_as_intended();
+
+    test_sview_invalid_input();
+    test_sview_as_intended();
+    test_sarray_invalid_input();
+    test_sarray_as_intended();
+    test_sintern_invalid_input();
+    test_sintern_as_intended();
+    test_sintern_threads();
+
+    test_spcompile_invalid_input();
+    test_spattern_as_intended();
+
+    test_smcompile_invalid_input();
+    test_smulti_as_intended();
 
     printf("\nTests run: %d\nFailures: %d\n", test_count, fail_count);
     if (fail_count == 0) {
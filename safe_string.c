@@ -6,20 +6,117 @@
 #include <stdlib.h>
 #include "safe_string.h"
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <locale.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
 
 /* Definitions */
 #define H_TYPE_8 0
 #define H_TYPE_16 1
 #define H_TYPE_32 2
 #define H_TYPE_64 3
-#define H_MASK 3
+/*
+    Tiny strings have no header but the type byte, whose upper bits
+    hold the length. They are always allocated exactly, so they have
+    no spare capacity and no room for the flag bits below.
+*/
+#define H_TYPE_TINY 4
+#define H_MASK 7
+#define H_TINY_SHIFT 3
+#define H_TINY_MAX 31
+/* Flag bit: the string lives in an sarena and is not freed on its own */
+#define H_ARENA (1 << 7)
+/*
+    Flag bit: an atomic 64-bit hash slot precedes the header and starts
+    the allocation, see shashed(). A slot value of 0 means the hash is
+    not cached.
+*/
+#define H_HASHED (1 << 6)
+/*
+    Flag bit: an atomic reference count precedes the hash slot
+    and starts the allocation, see sshare().
+*/
+#define H_REFCOUNT (1 << 5)
+/*
+    Flag bit: the bytes are a read-only mapping of a file that starts
+    right after the page holding the header, see smapfile().
+*/
+#define H_MAPPED (1 << 4)
+/*
+    Flag bit: the bytes are known to be valid UTF-8, see sutf8_valid().
+    Cleared together with the cached hash whenever the string changes.
+*/
+#define H_UTF8 (1 << 3)
+/* Size of each optional slot in front of the header */
+#define H_SLOT sizeof(uint64_t)
+
+/* Default block size of an sarena */
+#define SARENA_BLOCK (64 * 1024)
+
+/* Above this capacity appends stop doubling and grow linearly */
+#define SMAX_PREALLOC (1024 * 1024)
+
+/*
+    Patterns at least this long are searched with Two-Way instead of the
+    first/last byte filter, whose worst case is O(n * plen).
+*/
+#define TWOWAY_MIN_PLEN 32
+
+/* Search algorithms of a compiled pattern */
+#define SP_BYTE 0
+#define SP_FILTER 1
+#define SP_HORSPOOL 2
+#define SP_TWOWAY 3
 
 #define HDR(T, s) ((Header##T *)(s - sizeof(Header##T)))
 
+typedef struct sablock {
+    struct sablock* next;
+    size_t used;
+    size_t size;
+    max_align_t data[];
+} sablock;
+
+struct sarena {
+    sablock* head;
+    size_t blocksize;
+};
+
+struct spattern {
+    const char* bytes;
+    size_t len;
+    uint8_t algo;
+    bool periodic;
+    size_t suffix;
+    size_t period;
+    size_t shift[UCHAR_MAX + 1];
+    char buf[];
+};
+
 /* Functions */
 
+/*
+    Flag bits of a type byte. Tiny strings use those bits
+    for their length, so they never have any flags set.
+*/
+static inline
+uint8_t getFlags(const uint8_t flag) {
+    if ((flag & H_MASK) == H_TYPE_TINY)
+        return 0;
+    return flag & ~H_MASK;
+}
+
 static inline
 uint8_t getReqType(const size_t ilen) {
     if (ilen < 1 << 8)
@@ -38,6 +135,8 @@ uint8_t getReqType(const size_t ilen) {
 static inline
 uint8_t getHlen(const uint8_t type) {
     switch(type & H_MASK) {
+        case H_TYPE_TINY:
+            return sizeof(HeaderTiny);
         case H_TYPE_8:
             return sizeof(Header8);
         case H_TYPE_16:
@@ -50,11 +149,58 @@ uint8_t getHlen(const uint8_t type) {
     return 0;
 }
 
+/* Bytes in front of the header that belong to the allocation */
+static inline
+size_t getPrefix(const uint8_t flag) {
+    uint8_t flags = getFlags(flag);
+    return (flags & H_HASHED ? H_SLOT : 0) + (flags & H_REFCOUNT ? H_SLOT : 0);
+}
+
+static inline
+atomic_size_t* srcslot(const string s) {
+    uint8_t flag = s[-1];
+    if (!(getFlags(flag) & H_REFCOUNT))
+        return NULL;
+    return (atomic_size_t*)(s - getHlen(flag) - getPrefix(flag));
+}
+
+/*
+    Check if s must not be changed in place: other references
+    to it exist, or its bytes are a read-only file mapping.
+*/
+static inline
+bool sreadonly(const string s) {
+    if (getFlags(s[-1]) & H_MAPPED)
+        return true;
+    atomic_size_t* rc = srcslot(s);
+    return rc && atomic_load_explicit(rc, memory_order_acquire) > 1;
+}
+
+static inline
+atomic_uint_least64_t* shashslot(const string s) {
+    uint8_t flag = s[-1];
+    if (!(getFlags(flag) & H_HASHED))
+        return NULL;
+    return (atomic_uint_least64_t*)(s - getHlen(flag) - H_SLOT);
+}
+
+/* Drop the cached hash, every function that changes the bytes must call this */
+static inline
+void sinvalidate(const string s) {
+    atomic_uint_least64_t* slot = shashslot(s);
+    if (slot)
+        atomic_store_explicit(slot, 0, memory_order_relaxed);
+    if (getFlags(s[-1]) & H_UTF8)
+        s[-1] &= ~H_UTF8;
+}
+
 static inline
 size_t sgetalloc(const string s) {
     if (s == NULL) return 0;
     uint8_t flag = s[-1];
     switch (flag & H_MASK) {
+        case H_TYPE_TINY:
+            return flag >> H_TINY_SHIFT;
         case H_TYPE_8:
             return HDR(8, s)->allocated;
         case H_TYPE_16:
@@ -70,7 +216,13 @@ size_t sgetalloc(const string s) {
 static inline
 void ssetlen(const string s, const size_t len) {
     uint8_t flag = s[-1];
+    sinvalidate(s);
     switch (flag & H_MASK) {
+        case H_TYPE_TINY:
+        {
+            s[-1] = (char)(H_TYPE_TINY | len << H_TINY_SHIFT);
+            break;
+        }
         case H_TYPE_8:
         {
             HDR(8, s)->len = len;
@@ -123,64 +275,207 @@ void ssetalloc(const string s, const size_t newalloc) {
     return;
 }
 
+static inline
+size_t getTypeMax(const uint8_t type) {
+    switch(type & H_MASK) {
+        case H_TYPE_TINY:
+            return H_TINY_MAX;
+        case H_TYPE_8:
+            return UINT8_MAX;
+        case H_TYPE_16:
+            return UINT16_MAX;
+        case H_TYPE_32:
+            return UINT32_MAX;
+        case H_TYPE_64:
+            return SIZE_MAX;
+    }
+    return 0;
+}
+
+/*
+    Header type for a string of length len in an allocation of
+    newalloc bytes. Only exact allocations without flags can be tiny.
+*/
+static inline
+uint8_t getNewType(size_t len, size_t newalloc, uint8_t flags) {
+    if (newalloc == len && len <= H_TINY_MAX && !flags)
+        return H_TYPE_TINY;
+    return getReqType(newalloc);
+}
+
+/*
+    Copy s into a new heap allocation for newalloc bytes and release s.
+
+    flags may hold H_REFCOUNT to give the copy a reference count of 1
+    and H_HASHED to give it a hash slot, which keeps a cached hash.
+    Releasing s frees it, drops one reference if it is shared, unmaps
+    a file mapping or does nothing for arena strings.
+    Return NULL and leave s untouched if the allocation fails.
+*/
+static
+string smove(string s, size_t newalloc, uint8_t flags) {
+    size_t len = sgetlen(s);
+    uint8_t type = getNewType(len, newalloc, flags);
+    size_t hlen = getHlen(type);
+    size_t prefix = getPrefix(type | flags);
+    if (prefix + hlen + newalloc + 1 < newalloc)
+        return NULL;
+
+    uint8_t* h = malloc(prefix + hlen + newalloc + 1);
+    if (h == NULL)
+        return NULL;
+    string str = (string)(h + prefix + hlen);
+    memcpy(str, s, len + 1);
+    str[-1] = (char)(type | (flags & (H_HASHED | H_REFCOUNT)));
+    if (flags & H_REFCOUNT)
+        atomic_init(srcslot(str), 1);
+    atomic_uint_least64_t* to = shashslot(str);
+    if (to)
+        atomic_init(to, 0);
+    ssetlen(str, len);
+    ssetalloc(str, newalloc);
+    /* The bytes did not change, so a cached hash stays valid */
+    atomic_uint_least64_t* from = shashslot(s);
+    if (from && to)
+        atomic_store_explicit(to, atomic_load_explicit(from, memory_order_relaxed),
+                              memory_order_relaxed);
+    sfree(s);
+    return str;
+}
+
+/*
+    Move the buffer into an allocation for exactly newalloc bytes.
+
+    The header type follows newalloc, so the string may switch to a
+    bigger or a smaller header, down to a tiny one if newalloc == len(s).
+    Strings from an arena, shared strings and file mappings are copied,
+    so the result is always safe to change. Expects newalloc >= len(s).
+    Return NULL and leave s untouched if the allocation fails.
+*/
+static
+string sresize(string s, size_t newalloc) {
+    uint8_t flag = s[-1];
+    uint8_t flags = getFlags(flag) & (H_HASHED | H_REFCOUNT);
+    uint8_t type = getNewType(sgetlen(s), newalloc, flags);
+    size_t hlen = getHlen(type) + getPrefix(type | flags);
+
+    if (type != (flag & H_MASK) || hlen != getHlen(flag) + getPrefix(flag) ||
+        (getFlags(flag) & H_ARENA) || sreadonly(s))
+        return smove(s, newalloc, flags);
+    if (hlen + newalloc + 1 < newalloc)
+        return NULL;
+    void* h = realloc(s - hlen, hlen + newalloc + 1);
+    if (h == NULL)
+        return NULL;
+    s = (string)((uint8_t*)h + hlen);
+    ssetalloc(s, newalloc);
+    return s;
+}
+
+/*
+    Make sure at least addroom bytes can be appended without reallocating.
+
+    Capacity grows geometrically: it is doubled while it is below
+    SMAX_PREALLOC and grows by SMAX_PREALLOC after that, so a sequence
+    of appends reallocates O(log n) times. The capacity is capped at
+    what the header needed for the new length can describe.
+    Shared strings are always copied, which releases one reference.
+*/
 static inline
 string smakeroom(string s, size_t addroom) {
-    void* h, *new_h;
-    size_t oldlen, newlen, avail, new_hlen;
-    uint8_t old_type, new_type;
+    size_t oldlen, newlen, newalloc, maxalloc;
 
     oldlen = sgetlen(s);
-    avail = sgetalloc(s) - oldlen;
-    if (avail >= addroom) return s;
+    if (sgetalloc(s) - oldlen >= addroom && !sreadonly(s)) return s;
 
-    old_type = s[-1];
-    h = s - getHlen(old_type);
     newlen = oldlen + addroom;
-    new_type = getReqType(newlen);
-    new_hlen = getHlen(new_type);
-
-    if (new_type == old_type) {
-        new_h = realloc(h, new_hlen + newlen + 1);
-        if (!new_h) return NULL;
-        s = (string)((uint8_t*)new_h + new_hlen);
-    } else {
-        new_h = malloc(new_hlen + newlen + 1);
-        if (new_h == NULL) return NULL;
-        memcpy((char*)new_h + new_hlen, s, oldlen + 1);
-        free(h);
-        s = (string)((uint8_t*)new_h + new_hlen);
-        s[-1] = (char)new_type;
-        ssetlen(s, oldlen);
-    }
-    ssetalloc(s, newlen);
-    return s;
+    if (newlen < oldlen)
+        return NULL;
+    if (newlen < SMAX_PREALLOC)
+        newalloc = newlen * 2;
+    else
+        newalloc = newlen + SMAX_PREALLOC;
+    maxalloc = getTypeMax(getReqType(newlen));
+    if (newalloc < newlen || newalloc > maxalloc)
+        newalloc = maxalloc;
+    return sresize(s, newalloc);
 }
 
 /*
-    Create a new null-terminated string with length ilen.
+    Bump-allocate size bytes from the arena, aligned for any header.
 
-    If input string is NULL, a buffer of length ilen is initialized with zero bytes.
+    Requests larger than the block size get a block of their own.
     Return NULL if malloc fails.
-    Return NULL if ilen causes overflow.
+*/
+static
+void* saalloc(sarena* a, size_t size) {
+    const size_t align = sizeof(max_align_t);
+    size_t off;
+    sablock* b = a->head;
 
-    ilen > strlen(input) causes undefined behaviour.
+    if (size > SIZE_MAX - align)
+        return NULL;
+    size = (size + align - 1) & ~(align - 1);
+    if (b != NULL) {
+        off = b->used;
+        if (b->size - off >= size) {
+            b->used = off + size;
+            return (char*)b->data + off;
+        }
+    }
+
+    size_t bsize = size > a->blocksize ? size : a->blocksize;
+    if (bsize > SIZE_MAX - sizeof(sablock))
+        return NULL;
+    b = malloc(sizeof(sablock) + bsize);
+    if (b == NULL)
+        return NULL;
+    b->size = bsize;
+    b->used = size;
+    if (a->head != NULL && bsize > a->blocksize) {
+        /* Keep bumping in the current block, the big one is full anyway */
+        b->next = a->head->next;
+        a->head->next = b;
+    } else {
+        b->next = a->head;
+        a->head = b;
+    }
+    return b->data;
+}
+
+/*
+    Create a string like snewlen, taking the memory from arena a
+    or from malloc if a is NULL. flags may hold H_HASHED to reserve
+    a hash slot. Strings with flags, including the H_ARENA bit of
+    arena strings, never get a tiny header.
 */
-string snewlen(const void* input, size_t ilen) {
+static
+string snewlen_in(sarena* a, const void* input, size_t ilen, uint8_t flags) {
     void* h;
     string str;
-    uint8_t type = getReqType(ilen);
+    uint8_t type = !a && !flags && ilen <= H_TINY_MAX ? H_TYPE_TINY : getReqType(ilen);
     uint8_t hlen = getHlen(type);
+    uint8_t prefix = flags & H_HASHED ? H_SLOT : 0;
     uint8_t* flag;
     
-    if (hlen + ilen + 1 < ilen) return NULL;
+    if (prefix + hlen + ilen + 1 < ilen) return NULL;
 
-    h = malloc(hlen + ilen + 1);
+    h = a ? saalloc(a, prefix + hlen + ilen + 1) : malloc(prefix + hlen + ilen + 1);
     if (h == NULL) return NULL;
-    if (input == NULL) memset(h, 0, hlen + ilen + 1);
+    if (input == NULL) memset(h, 0, prefix + hlen + ilen + 1);
+    if (prefix) {
+        atomic_init((atomic_uint_least64_t*)h, 0);
+        h = (uint8_t*)h + prefix;
+    }
     str = (string)((uint8_t*)h + hlen);
     flag = (uint8_t*)str - 1;
 
     switch(type) {
+        case H_TYPE_TINY:
+        {
+            *flag = (uint8_t)(type | ilen << H_TINY_SHIFT);
+            break;
+        }
         case H_TYPE_8: 
         {
             Header8* hdr = (Header8*)h;
@@ -215,12 +510,28 @@ string snewlen(const void* input, size_t ilen) {
         }
     }
 
+    if (a)
+        *flag |= H_ARENA;
+    *flag |= flags & H_HASHED;
     if (input && ilen)
         memcpy(str, input, ilen);
     str[ilen] = 0;
     return str;
 }
 
+/*
+    Create a new null-terminated string with length ilen.
+
+    If input string is NULL, a buffer of length ilen is initialized with zero bytes.
+    Return NULL if malloc fails.
+    Return NULL if ilen causes overflow.
+
+    ilen > strlen(input) causes undefined behaviour.
+*/
+string snewlen(const void* input, size_t ilen) {
+    return snewlen_in(NULL, input, ilen, 0);
+}
+
 /*
     Create a new null-terminated string.
 
@@ -237,14 +548,30 @@ string snew(const void* input) {
     return snewlen(input, ilen);
 }
 
+static
+void sunmap(const string s);
+
 /*
     Free the allocated memory.
 
     If input is NULL, do nothing.
+    Strings created in an arena are released with the arena,
+    so nothing is done for them either.
+    For reference-counted strings this drops one reference and
+    frees the memory when the last one is gone.
+    File mappings are unmapped.
 */
 void sfree(const string s) {
     if (s == NULL) return;
-    free(s - getHlen(s[-1]));
+    if (getFlags(s[-1]) & H_ARENA) return;
+    atomic_size_t* rc = srcslot(s);
+    if (rc && atomic_fetch_sub_explicit(rc, 1, memory_order_acq_rel) != 1)
+        return;
+    if (getFlags(s[-1]) & H_MAPPED) {
+        sunmap(s);
+        return;
+    }
+    free(s - getHlen(s[-1]) - getPrefix(s[-1]));
     return;
 }
 
@@ -260,6 +587,8 @@ size_t sgetlen(const string s) {
     if (s == NULL) return 0;
     uint8_t flag = s[-1];
     switch (flag & H_MASK) {
+        case H_TYPE_TINY:
+            return flag >> H_TINY_SHIFT;
         case H_TYPE_8:
             return HDR(8, s)->len;
         case H_TYPE_16:
@@ -283,16 +612,132 @@ void supdatelen(const string s, size_t len) {
     return;
 }
 
+/*
+    Get the amount of bytes that can be appended without reallocating.
+
+    If input is NULL, return 0.
+*/
+size_t sgetavail(const string s) {
+    if (s == NULL) return 0;
+    return sgetalloc(s) - sgetlen(s);
+}
+
+/*
+    Make sure the string can hold at least capacity bytes.
+
+    The capacity is reserved exactly, without the growth policy of appends.
+    Return NULL if s is NULL.
+    Return NULL if the allocation fails; s is left untouched in that case.
+    Return the string, which may have moved.
+*/
+string sreserve(string s, size_t capacity) {
+    if (s == NULL) return NULL;
+    if (sgetalloc(s) >= capacity) return s;
+    return sresize(s, capacity);
+}
+
+/*
+    Release the unused capacity of a string.
+
+    The header shrinks as well if the length fits a smaller one.
+    Return NULL if s is NULL.
+    Return NULL if the allocation fails; s is left untouched in that case.
+    Return the string, which may have moved.
+*/
+string sshrink_to_fit(string s) {
+    if (s == NULL) return NULL;
+    size_t len = sgetlen(s);
+    if (sgetalloc(s) == len) return s;
+    return sresize(s, len);
+}
+
+/*
+    Make the string empty but keep its capacity for reuse.
+    Tiny strings (up to 31 bytes) cannot record spare capacity,
+    so for them this only sets the length.
+
+    If input is NULL or read-only, do nothing.
+*/
+void sclear(string s) {
+    if (s == NULL || sreadonly(s)) return;
+    ssetlen(s, 0);
+    s[0] = 0;
+    return;
+}
+
 /*
     Create a duplicate of the given null-terminated string.
 
+    Reference-counted strings are not copied, another reference
+    to the same bytes is returned instead, see sshare().
     Return NULL if malloc fails.
     Return NULL if string causes overflow.
 */
 string sdup(const string s) {
+    if (s != NULL && srcslot(s) != NULL)
+        return sretain(s);
     return snewlen(s, sgetlen(s));
 }
 
+/*
+    Turn s into a reference-counted string with a count of 1.
+
+    Reference-counted strings are shared with sretain() or sdup() in O(1)
+    and released with srelease() or sfree(); the counting is atomic, so
+    references may be passed between threads. A shared string must not be
+    changed: functions that return a string copy it first, functions that
+    change it in place fail on it. See sunshare().
+
+    Return NULL if s is NULL.
+    Return NULL if malloc fails; s is left untouched in that case.
+    Return the string, which may have moved.
+*/
+string sshare(string s) {
+    if (s == NULL) return NULL;
+    if (srcslot(s) != NULL) return s;
+    return smove(s, sgetalloc(s), H_REFCOUNT | (getFlags(s[-1]) & H_HASHED));
+}
+
+/*
+    Take another reference to a reference-counted string.
+
+    Return NULL if s is NULL or not reference-counted.
+    Return s.
+*/
+string sretain(string s) {
+    if (s == NULL) return NULL;
+    atomic_size_t* rc = srcslot(s);
+    if (rc == NULL) return NULL;
+    atomic_fetch_add_explicit(rc, 1, memory_order_relaxed);
+    return s;
+}
+
+/*
+    Drop one reference, freeing the string with the last one.
+    Same as sfree().
+
+    If input is NULL, do nothing.
+*/
+void srelease(string s) {
+    sfree(s);
+}
+
+/*
+    Make sure s can be changed in place.
+
+    If s is shared, it is copied into a new reference-counted string
+    and one reference to s is dropped. A file mapping is copied to the
+    heap and unmapped. Otherwise s is returned as is.
+
+    Return NULL if s is NULL.
+    Return NULL if malloc fails; s is left untouched in that case.
+*/
+string sunshare(string s) {
+    if (s == NULL) return NULL;
+    if (!sreadonly(s)) return s;
+    return smove(s, sgetalloc(s), getFlags(s[-1]) & (H_HASHED | H_REFCOUNT));
+}
+
 /*
     Join n C-strings together with separators of length seplen.
 
@@ -467,431 +912,5100 @@ string scat(string s, size_t cstr_len, char* cstr) {
 }
 
 /*
-    Change all characters to upper case.
+    Append printf-style formatted text to a given string.
 
-    Return false if string is NULL.
-    Return true on success.
+    The text is formatted straight into the spare capacity; if it does
+    not fit, the string grows once to the exact size needed and the
+    text is formatted again.
+
+    Return NULL if s or fmt is NULL.
+    Return NULL and free s if formatting or malloc/realloc fails.
 */
-bool supper(string s) {
-    if (s == NULL) return false;
-    for (size_t i = 0; i < sgetlen(s); i++)
-        s[i] = toupper(s[i]);
-    return true;
+string scatvfmt(string s, const char* fmt, va_list ap) {
+    if (s == NULL) return NULL;
+    if (fmt == NULL) {
+        sfree(s);
+        return NULL;
+    }
+    string new = smakeroom(s, 0);
+    if (new == NULL) {
+        sfree(s);
+        return NULL;
+    }
+    s = new;
+    size_t len = sgetlen(s);
+    size_t avail = sgetavail(s);
+    va_list again;
+    va_copy(again, ap);
+    int n = vsnprintf(s + len, avail + 1, fmt, ap);
+    if (n >= 0 && (size_t)n > avail) {
+        new = smakeroom(s, n);
+        if (new == NULL) {
+            va_end(again);
+            sfree(s);
+            return NULL;
+        }
+        s = new;
+        n = vsnprintf(s + len, n + 1, fmt, again);
+    }
+    va_end(again);
+    if (n < 0) {
+        s[len] = 0;
+        sfree(s);
+        return NULL;
+    }
+    ssetlen(s, len + n);
+    return s;
 }
 
 /*
-    Change all characters to lower case.
+    Append printf-style formatted text to a given string.
+    See scatvfmt().
 
-    Return false if string is NULL.
-    Return true on success.
+    Example:
+        s = scatfmt(s, "%s: %d\n", key, value);
 */
-bool slower(string s) {
-    if (s == NULL) return false;
-    for (size_t i = 0; i < sgetlen(s); i++)
-        s[i] = tolower(s[i]);
-    return true;
+string scatfmt(string s, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    s = scatvfmt(s, fmt, ap);
+    va_end(ap);
+    return s;
 }
 
 /*
-    Check if a string starts with 'pattern'.
-
-    Return false if string or pattern is NULL.
-    Return false if plen > len(string).
-    Return false if plen is 0.
+    Append n fragments to a given string,
+    growing it at most once for all of them.
 
-    Behaviour is undefined if plen != len(pattern).
+    Empty fragments are skipped.
+    Return NULL if s is NULL.
+    Return NULL and free s if parts is NULL and n > 0.
+    Return NULL and free s if a fragment is NULL and not empty.
+    Return NULL and free s if the total length causes overflow.
+    Return NULL and free s if malloc/realloc fails.
 */
-bool sstartswith(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return false;
-    if (plen > sgetlen(s) || plen == 0)
-        return false;
-    return memcmp(s, pattern, plen) == 0;
+string scatn(string s, size_t n, const sview parts[n]) {
+    if (s == NULL) return NULL;
+    if (parts == NULL && n) {
+        sfree(s);
+        return NULL;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((parts[i].ptr == NULL && parts[i].len) || total + parts[i].len < total) {
+            sfree(s);
+            return NULL;
+        }
+        total += parts[i].len;
+    }
+    size_t len = sgetlen(s);
+    string new = smakeroom(s, total);
+    if (new == NULL) {
+        sfree(s);
+        return NULL;
+    }
+    char* p = new + len;
+    for (size_t i = 0; i < n; i++) {
+        if (parts[i].len == 0) continue;
+        memcpy(p, parts[i].ptr, parts[i].len);
+        p += parts[i].len;
+    }
+    ssetlen(new, len + total);
+    new[len + total] = 0;
+    return new;
 }
 
-/*
-    Check if a string ends with 'pattern'.
+/* "00" to "99", so each division by 100 emits two digits */
+static const char sdigits100[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
 
-    Return false if string or pattern is NULL.
-    Return false if plen > len(string).
-    Return false if plen is 0.
+static const char sdigits16[] = "0123456789abcdef";
 
-    Behaviour is undefined if plen != len(pattern).
-*/
-bool sendswith(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return false;
-    if (plen > sgetlen(s) || plen == 0)
-        return false;
-    return memcmp(s + sgetlen(s) - plen, pattern, plen) == 0;
+static
+size_t sdeclen(uint64_t v) {
+    size_t n = 1;
+    for (uint64_t p = 10; v >= p; p *= 10) {
+        n++;
+        if (n == 20) break;
+    }
+    return n;
 }
 
-static inline
-size_t* lps(size_t plen, const char* pattern) {
-    size_t* table = malloc(plen * sizeof(size_t));
-    if (table == NULL)
+/* Append the digits of v and, if neg, a minus sign in front of them */
+static
+string scatdec(string s, uint64_t v, bool neg) {
+    if (s == NULL) return NULL;
+    size_t n = sdeclen(v) + neg;
+    size_t len = sgetlen(s);
+    string new = smakeroom(s, n);
+    if (new == NULL) {
+        sfree(s);
         return NULL;
-    size_t j = 0, i = 1;
-    while (i < plen) {
-        if (pattern[i] == pattern[j]) {
-            j++;
-            table[i] = j;
+    }
+    char* p = new + len + n;
+    while (v >= 100) {
+        const char* d = sdigits100 + 2 * (v % 100);
+        v /= 100;
+        *--p = d[1];
+        *--p = d[0];
+    }
+    if (v >= 10) {
+        *--p = sdigits100[2 * v + 1];
+        *--p = sdigits100[2 * v];
+    } else {
+        *--p = '0' + v;
+    }
+    if (neg)
+        *--p = '-';
+    ssetlen(new, len + n);
+    new[len + n] = 0;
+    return new;
+}
+
+/*
+    Append the decimal digits of an unsigned integer to a given string.
+
+    Return NULL if s is NULL.
+    Return NULL and free s if malloc/realloc fails.
+*/
+string scatu64(string s, uint64_t v) {
+    return scatdec(s, v, false);
+}
+
+/*
+    Append the decimal digits of a signed integer to a given string.
+
+    Return NULL if s is NULL.
+    Return NULL and free s if malloc/realloc fails.
+*/
+string scati64(string s, int64_t v) {
+    if (v < 0)
+        return scatdec(s, -(uint64_t)v, true);
+    return scatdec(s, v, false);
+}
+
+/*
+    Append the lowercase hex digits of v to a given string,
+    padded with zeros to at least width digits.
+
+    Return NULL if s is NULL.
+    Return NULL and free s if width causes overflow.
+    Return NULL and free s if malloc/realloc fails.
+
+    Example:
+        s = scathex(s, 0x1f, 4); // appends "001f"
+*/
+string scathex(string s, uint64_t v, size_t width) {
+    if (s == NULL) return NULL;
+    size_t digits = 1;
+    while (digits < 16 && (v >> (4 * digits)))
+        digits++;
+    size_t n = digits > width ? digits : width;
+    size_t len = sgetlen(s);
+    string new = smakeroom(s, n);
+    if (new == NULL) {
+        sfree(s);
+        return NULL;
+    }
+    char* p = new + len;
+    memset(p, '0', n - digits);
+    p += n;
+    for (size_t i = 0; i < digits; i++) {
+        *--p = sdigits16[v & 15];
+        v >>= 4;
+    }
+    ssetlen(new, len + n);
+    new[len + n] = 0;
+    return new;
+}
+
+static
+bool sflipcase(char* s, size_t n, char first);
+
+/*
+    Check if the ctype locale is "C" or "POSIX". There toupper() and
+    tolower() change ASCII letters only, so the vector kernels give
+    the same result.
+*/
+static
+bool sctype_is_c(void) {
+    const char* name = setlocale(LC_CTYPE, NULL);
+    return name != NULL && (strcmp(name, "C") == 0 || strcmp(name, "POSIX") == 0);
+}
+
+/*
+    Change all characters to upper case.
+
+    Every byte goes through toupper(), so the result follows the
+    current locale. In the "C" locale ASCII letters are converted
+    with the vector kernels.
+
+    Return false if string is NULL or read-only.
+    Return true on success.
+*/
+bool supper(string s) {
+    if (s == NULL || sreadonly(s)) return false;
+    size_t len = sgetlen(s);
+    sinvalidate(s);
+    if (sctype_is_c()) {
+        sflipcase(s, len, 'a');
+        return true;
+    }
+    for (size_t i = 0; i < len; i++)
+        s[i] = toupper((unsigned char)s[i]);
+    return true;
+}
+
+/*
+    Change all characters to lower case.
+
+    Every byte goes through tolower(), so the result follows the
+    current locale. In the "C" locale ASCII letters are converted
+    with the vector kernels.
+
+    Return false if string is NULL or read-only.
+    Return true on success.
+*/
+bool slower(string s) {
+    if (s == NULL || sreadonly(s)) return false;
+    size_t len = sgetlen(s);
+    sinvalidate(s);
+    if (sctype_is_c()) {
+        sflipcase(s, len, 'A');
+        return true;
+    }
+    for (size_t i = 0; i < len; i++)
+        s[i] = tolower((unsigned char)s[i]);
+    return true;
+}
+
+/*
+    Change ASCII letters to upper case, leaving every other byte as is.
+    Does not depend on the locale.
+
+    Return false if string is NULL or read-only.
+    Return true on success.
+*/
+bool supper_ascii(string s) {
+    if (s == NULL || sreadonly(s)) return false;
+    sinvalidate(s);
+    sflipcase(s, sgetlen(s), 'a');
+    return true;
+}
+
+/*
+    Change ASCII letters to lower case, leaving every other byte as is.
+    Does not depend on the locale.
+
+    Return false if string is NULL or read-only.
+    Return true on success.
+*/
+bool slower_ascii(string s) {
+    if (s == NULL || sreadonly(s)) return false;
+    sinvalidate(s);
+    sflipcase(s, sgetlen(s), 'A');
+    return true;
+}
+
+/*
+    Check if a string starts with 'pattern'.
+
+    Return false if string or pattern is NULL.
+    Return false if plen > len(string).
+    Return false if plen is 0.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+bool sstartswith(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return false;
+    return sstartswith_view(sview_of(s), plen, pattern);
+}
+
+/*
+    Check if a string ends with 'pattern'.
+
+    Return false if string or pattern is NULL.
+    Return false if plen > len(string).
+    Return false if plen is 0.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+bool sendswith(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return false;
+    return sendswith_view(sview_of(s), plen, pattern);
+}
+
+/*
+    Substring search kernels.
+
+    All kernels work on a raw (pointer, length) haystack and expect
+    0 < plen <= n. The SIMD variants compare the first and the last byte
+    of the pattern against W consecutive positions at once and call
+    memcmp only for the positions where both bytes match.
+    The best available kernel set is chosen once at startup.
+*/
+typedef struct search_kernels {
+    ssize_t (*find)(const char* s, size_t n, const char* p, size_t plen);
+    ssize_t (*rfind)(const char* s, size_t n, const char* p, size_t plen);
+    size_t (*count)(const char* s, size_t n, const char* p, size_t plen);
+} search_kernels;
+
+static inline
+bool match_at(const char* s, const char* p, size_t plen) {
+    return s[0] == p[0] && s[plen - 1] == p[plen - 1] &&
+           (plen < 3 || memcmp(s + 1, p + 1, plen - 2) == 0);
+}
+
+static
+ssize_t find_generic(const char* s, size_t n, const char* p, size_t plen) {
+    const char* cur = s;
+    const char* last = s + n - plen;
+    while (cur <= last) {
+        cur = memchr(cur, p[0], last - cur + 1);
+        if (cur == NULL)
+            return -1;
+        if (match_at(cur, p, plen))
+            return cur - s;
+        cur++;
+    }
+    return -1;
+}
+
+static
+ssize_t rfind_generic(const char* s, size_t n, const char* p, size_t plen) {
+    for (size_t idx = n - plen + 1; idx-- > 0;) {
+        if (match_at(s + idx, p, plen))
+            return idx;
+    }
+    return -1;
+}
+
+static
+size_t count_generic(const char* s, size_t n, const char* p, size_t plen) {
+    size_t count = 0;
+    const char* cur = s;
+    const char* last = s + n - plen;
+    while (cur <= last) {
+        cur = memchr(cur, p[0], last - cur + 1);
+        if (cur == NULL)
+            break;
+        if (match_at(cur, p, plen))
+            count++;
+        cur++;
+    }
+    return count;
+}
+
+static const search_kernels kernels_generic = {
+    find_generic, rfind_generic, count_generic
+};
+
+/*
+    Flip the case of every byte in [first, first + 26), which is
+    either 'a'..'z' or 'A'..'Z'. Return true if any byte is not ASCII.
+*/
+typedef bool (*flipcase_fn)(char* s, size_t n, char first);
+
+static
+bool flipcase_generic(char* s, size_t n, char first) {
+    unsigned char high = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = s[i];
+        high |= c;
+        if ((unsigned char)(c - first) < 26)
+            s[i] = c ^ 0x20;
+    }
+    return high > 0x7f;
+}
+
+/*
+    Length of the prefix of s whose bytes are all in the set (accept)
+    or all outside it (!accept).
+*/
+typedef size_t (*charspan_fn)(const char* s, size_t n, const scharset* cs, bool accept);
+
+static inline
+bool scharset_test(const scharset* cs, unsigned char c) {
+    return (cs->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+static
+size_t charspan_generic(const char* s, size_t n, const scharset* cs, bool accept) {
+    size_t i = 0;
+    while (i < n && scharset_test(cs, s[i]) == accept)
+        i++;
+    return i;
+}
+
+typedef bool (*utf8valid_fn)(const char* s, size_t n);
+typedef size_t (*utf8count_fn)(const char* s, size_t n);
+
+/* Skips runs of 8 ASCII bytes, then decodes one sequence at a time */
+static
+bool utf8valid_generic(const char* s, size_t n) {
+    const unsigned char* p = (const unsigned char*)s;
+    size_t i = 0;
+    while (i < n) {
+        uint64_t w;
+        if (n - i >= 8 && (memcpy(&w, p + i, 8), !(w & 0x8080808080808080ull))) {
+            i += 8;
+            continue;
+        }
+        unsigned char c = p[i];
+        if (c < 0x80) {
             i++;
+            continue;
+        }
+        size_t need;
+        uint32_t cp;
+        if (c >= 0xc2 && c <= 0xdf) {
+            need = 1;
+            cp = c & 0x1f;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            need = 2;
+            cp = c & 0x0f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            need = 3;
+            cp = c & 0x07;
         } else {
-            if (j != 0) {
-                j = table[j - 1];
-            } else {
-                table[i] = 0;
-                i++;
-            }
+            return false;
         }
+        if (n - i <= need)
+            return false;
+        for (size_t k = 1; k <= need; k++) {
+            if ((p[i + k] & 0xc0) != 0x80)
+                return false;
+            cp = cp << 6 | (p[i + k] & 0x3f);
+        }
+        if (need == 2 && (cp < 0x800 || (cp >= 0xd800 && cp <= 0xdfff)))
+            return false;
+        if (need == 3 && (cp < 0x10000 || cp > 0x10ffff))
+            return false;
+        i += need + 1;
     }
-    return table;
+    return true;
+}
+
+/* Every byte but a continuation byte 10xxxxxx starts a code point */
+static
+size_t utf8count_generic(const char* s, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+        count += (signed char)s[i] > -65;
+    return count;
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SSTR_X86_DISPATCH 1
+#include <immintrin.h>
+
 /*
-    After testing it turned out that the naive approach is faster in most cases.
+    Stamp out find/rfind/count for one instruction set.
+    EQMASK(ptr, vec) must return a bit mask with bit k set
+    if ptr[k] equals the byte broadcast in vec.
 */
-ssize_t sfind_advanced(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return -1;
-    size_t n = sgetlen(s);
-    if (plen > n || plen == 0)
-        return -1;
-    if (plen == 1) {
-        for (size_t idx = 0; idx <= n - plen; idx++) {
-            if (s[idx] == pattern[0])
-                return idx;
+#define SEARCH_KERNELS(ISA, TARGET, W, VEC, SPLAT, EQMASK)                    \
+__attribute__((target(TARGET))) static                                        \
+ssize_t find_##ISA(const char* s, size_t n, const char* p, size_t plen) {    \
+    const VEC first = SPLAT(p[0]);                                            \
+    const VEC last = SPLAT(p[plen - 1]);                                      \
+    size_t idx = 0;                                                           \
+    for (; idx + plen - 1 + W <= n; idx += W) {                               \
+        uint64_t mask = EQMASK(s + idx, first) &                              \
+                        EQMASK(s + idx + plen - 1, last);                     \
+        while (mask) {                                                        \
+            size_t k = __builtin_ctzll(mask);                                 \
+            if (plen < 3 || memcmp(s + idx + k + 1, p + 1, plen - 2) == 0)    \
+                return idx + k;                                               \
+            mask &= mask - 1;                                                 \
+        }                                                                     \
+    }                                                                         \
+    for (; idx + plen <= n; idx++) {                                          \
+        if (match_at(s + idx, p, plen))                                       \
+            return idx;                                                       \
+    }                                                                         \
+    return -1;                                                                \
+}                                                                             \
+                                                                              \
+__attribute__((target(TARGET))) static                                        \
+ssize_t rfind_##ISA(const char* s, size_t n, const char* p, size_t plen) {   \
+    const VEC first = SPLAT(p[0]);                                            \
+    const VEC last = SPLAT(p[plen - 1]);                                      \
+    size_t end = n - plen + 1;                                                \
+    for (; end >= W; end -= W) {                                              \
+        size_t idx = end - W;                                                 \
+        uint64_t mask = EQMASK(s + idx, first) &                              \
+                        EQMASK(s + idx + plen - 1, last);                     \
+        while (mask) {                                                        \
+            size_t k = 63 - __builtin_clzll(mask);                            \
+            if (plen < 3 || memcmp(s + idx + k + 1, p + 1, plen - 2) == 0)    \
+                return idx + k;                                               \
+            mask &= ~(1ull << k);                                             \
+        }                                                                     \
+    }                                                                         \
+    while (end-- > 0) {                                                       \
+        if (match_at(s + end, p, plen))                                       \
+            return end;                                                       \
+    }                                                                         \
+    return -1;                                                                \
+}                                                                             \
+                                                                              \
+__attribute__((target(TARGET))) static                                        \
+size_t count_##ISA(const char* s, size_t n, const char* p, size_t plen) {    \
+    const VEC first = SPLAT(p[0]);                                            \
+    const VEC last = SPLAT(p[plen - 1]);                                      \
+    size_t count = 0;                                                         \
+    size_t idx = 0;                                                           \
+    for (; idx + plen - 1 + W <= n; idx += W) {                               \
+        uint64_t mask = EQMASK(s + idx, first) &                              \
+                        EQMASK(s + idx + plen - 1, last);                     \
+        if (plen < 3) {                                                       \
+            count += __builtin_popcountll(mask);                              \
+            continue;                                                         \
+        }                                                                     \
+        while (mask) {                                                        \
+            size_t k = __builtin_ctzll(mask);                                 \
+            if (memcmp(s + idx + k + 1, p + 1, plen - 2) == 0)                \
+                count++;                                                      \
+            mask &= mask - 1;                                                 \
+        }                                                                     \
+    }                                                                         \
+    for (; idx + plen <= n; idx++) {                                          \
+        if (match_at(s + idx, p, plen))                                       \
+            count++;                                                          \
+    }                                                                         \
+    return count;                                                             \
+}                                                                             \
+                                                                              \
+static const search_kernels kernels_##ISA = {                                 \
+    find_##ISA, rfind_##ISA, count_##ISA                                      \
+};
+
+__attribute__((target("sse2"))) static inline
+uint64_t eqmask_sse2(const char* s, __m128i v) {
+    __m128i x = _mm_loadu_si128((const __m128i*)s);
+    return (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+}
+
+__attribute__((target("avx2"))) static inline
+uint64_t eqmask_avx2(const char* s, __m256i v) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)s);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v));
+}
+
+__attribute__((target("avx512f,avx512bw"))) static inline
+uint64_t eqmask_avx512(const char* s, __m512i v) {
+    __m512i x = _mm512_loadu_si512((const void*)s);
+    return _mm512_cmpeq_epi8_mask(x, v);
+}
+
+SEARCH_KERNELS(sse2, "sse2", 16, __m128i, _mm_set1_epi8, eqmask_sse2)
+SEARCH_KERNELS(avx2, "avx2", 32, __m256i, _mm256_set1_epi8, eqmask_avx2)
+SEARCH_KERNELS(avx512, "avx512f,avx512bw", 64, __m512i, _mm512_set1_epi8, eqmask_avx512)
+
+#undef SEARCH_KERNELS
+
+/*
+    Case flipping for one instruction set. Adding 0x80 - first moves
+    the letter range to the bottom of the signed byte range, so a single
+    signed compare selects the letters.
+*/
+#define FLIPCASE_KERNEL(ISA, TARGET, W, VEC, LOAD, STORE, SPLAT, ADD, CMPGT,   \
+                        AND, XOR, OR, MOVEMASK)                               \
+__attribute__((target(TARGET))) static                                        \
+bool flipcase_##ISA(char* s, size_t n, char first) {                          \
+    const VEC shift = SPLAT((char)(0x80 - first));                            \
+    const VEC limit = SPLAT(-128 + 26);                                       \
+    const VEC bit = SPLAT(0x20);                                              \
+    VEC high = SPLAT(0);                                                      \
+    size_t i = 0;                                                             \
+    for (; i + W <= n; i += W) {                                              \
+        VEC x = LOAD((const VEC*)(s + i));                                    \
+        VEC letters = CMPGT(limit, ADD(x, shift));                            \
+        STORE((VEC*)(s + i), XOR(x, AND(letters, bit)));                      \
+        high = OR(high, x);                                                   \
+    }                                                                         \
+    bool tail = flipcase_generic(s + i, n - i, first);                        \
+    return MOVEMASK(high) != 0 || tail;                                       \
+}
+
+FLIPCASE_KERNEL(sse2, "sse2", 16, __m128i, _mm_loadu_si128, _mm_storeu_si128,
+                _mm_set1_epi8, _mm_add_epi8, _mm_cmpgt_epi8, _mm_and_si128,
+                _mm_xor_si128, _mm_or_si128, _mm_movemask_epi8)
+FLIPCASE_KERNEL(avx2, "avx2", 32, __m256i, _mm256_loadu_si256, _mm256_storeu_si256,
+                _mm256_set1_epi8, _mm256_add_epi8, _mm256_cmpgt_epi8, _mm256_and_si256,
+                _mm256_xor_si256, _mm256_or_si256, _mm256_movemask_epi8)
+
+#undef FLIPCASE_KERNEL
+
+/* The tail is handled with masked loads and stores instead of a scalar loop */
+__attribute__((target("avx512f,avx512bw"))) static
+bool flipcase_avx512(char* s, size_t n, char first) {
+    const __m512i shift = _mm512_set1_epi8((char)-first);
+    const __m512i limit = _mm512_set1_epi8(26);
+    const __m512i bit = _mm512_set1_epi8(0x20);
+    __mmask64 high = 0;
+    for (size_t i = 0; i < n; i += 64) {
+        __mmask64 live = n - i >= 64 ? ~(__mmask64)0 : ((__mmask64)1 << (n - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi8(live, s + i);
+        __mmask64 letters = _mm512_cmplt_epu8_mask(_mm512_add_epi8(x, shift), limit);
+        _mm512_mask_storeu_epi8(s + i, letters & live, _mm512_xor_si512(x, bit));
+        high |= _mm512_movepi8_mask(x);
+    }
+    return high != 0;
+}
+/*
+    Set membership with two byte shuffles: the low nibble of a byte picks
+    a row of the set's nibble table, the high nibble picks the bit in it.
+    The row comes from nib[1] for bytes >= 0x80, selected by the sign bit.
+*/
+__attribute__((target("avx2"))) static
+size_t charspan_avx2(const char* s, size_t n, const scharset* cs, bool accept) {
+    const __m256i rows0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->nib[0]));
+    const __m256i rows1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->nib[1]));
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                          1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const uint32_t flip = accept ? 0 : ~(uint32_t)0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i lo = _mm256_and_si256(x, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(rows0, lo),
+                                         _mm256_shuffle_epi8(rows1, lo), x);
+        __m256i bit = _mm256_shuffle_epi8(bits, hi);
+        __m256i in = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+        uint32_t stop = ~((uint32_t)_mm256_movemask_epi8(in) ^ flip);
+        if (stop)
+            return i + __builtin_ctz(stop);
+    }
+    return i + charspan_generic(s + i, n - i, cs, accept);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static
+size_t charspan_avx512(const char* s, size_t n, const scharset* cs, bool accept) {
+    const __m512i rows0 = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)cs->nib[0]));
+    const __m512i rows1 = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)cs->nib[1]));
+    const __m512i bits = _mm512_broadcast_i32x4(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                                              1, 2, 4, 8, 16, 32, 64, -128));
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    const __mmask64 flip = accept ? 0 : ~(__mmask64)0;
+    for (size_t i = 0; i < n; i += 64) {
+        __mmask64 live = n - i >= 64 ? ~(__mmask64)0 : ((__mmask64)1 << (n - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi8(live, s + i);
+        __m512i lo = _mm512_and_si512(x, nibble);
+        __m512i hi = _mm512_and_si512(_mm512_srli_epi16(x, 4), nibble);
+        __m512i row = _mm512_mask_blend_epi8(_mm512_movepi8_mask(x),
+                                             _mm512_shuffle_epi8(rows0, lo),
+                                             _mm512_shuffle_epi8(rows1, lo));
+        __m512i bit = _mm512_shuffle_epi8(bits, hi);
+        __mmask64 in = _mm512_test_epi8_mask(row, bit);
+        __mmask64 stop = ~(in ^ flip) & live;
+        if (stop)
+            return i + __builtin_ctzll(stop);
+    }
+    return n;
+}
+/*
+    UTF-8 validation after Keiser and Lemire. Three nibble lookups on the
+    previous and current byte flag every invalid two-byte combination;
+    the bytes that must continue a three or four byte sequence are
+    checked against the previous two and three bytes. A block that ends
+    in the middle of a sequence is an error unless the next block
+    continues it. The input is followed by a zero block, so a sequence
+    cut off by the end of the input is caught like any other.
+*/
+#define TOO_SHORT (1 << 0)
+#define TOO_LONG (1 << 1)
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const uint8_t utf8_byte1_high[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+static const uint8_t utf8_byte1_low[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+static const uint8_t utf8_byte2_high[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+#undef TOO_SHORT
+#undef TOO_LONG
+#undef OVERLONG_3
+#undef TOO_LARGE
+#undef SURROGATE
+#undef OVERLONG_2
+#undef TOO_LARGE_1000
+#undef OVERLONG_4
+#undef TWO_CONTS
+#undef CARRY
+
+/* The 32 bytes ending N bytes before the end of x, reaching into prev */
+#define UTF8_PREV(x, prev, N) \
+    _mm256_alignr_epi8(x, _mm256_permute2x128_si256(prev, x, 0x21), 16 - (N))
+
+__attribute__((target("avx2"))) static inline
+__m256i utf8_table_avx2(const uint8_t table[16]) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table));
+}
+
+__attribute__((target("avx2"))) static
+bool utf8valid_avx2(const char* s, size_t n) {
+    const __m256i b1high = utf8_table_avx2(utf8_byte1_high);
+    const __m256i b1low = utf8_table_avx2(utf8_byte1_low);
+    const __m256i b2high = utf8_table_avx2(utf8_byte2_high);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    /* Lead bytes in the last three positions that want more bytes */
+    const __m256i last = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          (char)0xef, (char)0xdf, (char)0xbf);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i err = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    char tail[32];
+    for (size_t i = 0;; i += 32) {
+        __m256i x;
+        if (n - i >= 32) {
+            x = _mm256_loadu_si256((const __m256i*)(s + i));
+        } else {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s + i, n - i);
+            x = _mm256_loadu_si256((const __m256i*)tail);
         }
-    } else if (plen < 5) {
-        for (size_t idx = 0; idx <= n - plen; idx++) {
-            if (s[idx] == pattern[0] && memcmp(s + idx, pattern, plen) == 0)
-                return idx;
+        if (_mm256_movemask_epi8(x) == 0) {
+            err = _mm256_or_si256(err, incomplete);
+            incomplete = _mm256_setzero_si256();
+        } else {
+            __m256i p1 = UTF8_PREV(x, prev, 1);
+            __m256i sc = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(b1high, _mm256_and_si256(_mm256_srli_epi16(p1, 4), nibble)),
+                    _mm256_shuffle_epi8(b1low, _mm256_and_si256(p1, nibble))),
+                _mm256_shuffle_epi8(b2high, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+            __m256i third = _mm256_subs_epu8(UTF8_PREV(x, prev, 2), _mm256_set1_epi8(0xe0 - 0x80));
+            __m256i fourth = _mm256_subs_epu8(UTF8_PREV(x, prev, 3), _mm256_set1_epi8(0xf0 - 0x80));
+            __m256i must = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+            err = _mm256_or_si256(err, _mm256_xor_si256(must, sc));
+            incomplete = _mm256_subs_epu8(x, last);
         }
-    } else {
-        /* Variation of Knuth-Morris-Pratt Algo */
-        size_t i = 0, j = 0;
-        size_t* table = lps(plen, pattern);
-        if (table == NULL) return -1;
-        while (i < n)
-        {
-            if (pattern[j] == s[i]) 
-            {
-                i++;
-                j++;
+        prev = x;
+        if (n - i < 32)
+            break;
+        if ((i & 4095) == 0 && !_mm256_testz_si256(err, err))
+            return false;
+    }
+    return _mm256_testz_si256(err, err);
+}
+
+#undef UTF8_PREV
+
+__attribute__((target("avx2"))) static
+size_t utf8count_avx2(const char* s, size_t n) {
+    const __m256i cont = _mm256_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(x, cont)));
+    }
+    return count + utf8count_generic(s + i, n - i);
+}
+#endif
+
+static const search_kernels* kernels = &kernels_generic;
+static flipcase_fn flipcase = flipcase_generic;
+static charspan_fn charspan = charspan_generic;
+static utf8valid_fn utf8valid = utf8valid_generic;
+static utf8count_fn utf8count = utf8count_generic;
+
+#ifdef SSTR_X86_DISPATCH
+__attribute__((constructor)) static
+void select_kernels(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        kernels = &kernels_avx512;
+        flipcase = flipcase_avx512;
+        charspan = charspan_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        kernels = &kernels_avx2;
+        flipcase = flipcase_avx2;
+        charspan = charspan_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernels = &kernels_sse2;
+        flipcase = flipcase_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        utf8valid = utf8valid_avx2;
+        utf8count = utf8count_avx2;
+    }
+}
+#endif
+
+static
+bool sflipcase(char* s, size_t n, char first) {
+    return flipcase(s, n, first);
+}
+
+/*
+    Split the pattern into u = p[0, suffix) and v = p[suffix, plen) at a
+    critical position and store the period of the factorisation in *period.
+    This is the maximal suffix computation of Crochemore and Perrin done
+    for both byte orderings; the longer of the two suffixes is critical.
+*/
+static
+size_t critical_factorization(const unsigned char* p, size_t plen, size_t* period) {
+    size_t max_suffix, max_suffix_rev;
+    size_t j, k, per;
+    unsigned char a, b;
+
+    if (plen < 3) {
+        *period = 1;
+        return plen - 1;
+    }
+
+    /* max_suffix starts at -1, i.e. before the pattern */
+    max_suffix = SIZE_MAX;
+    j = 0;
+    k = per = 1;
+    while (j + k < plen) {
+        a = p[j + k];
+        b = p[max_suffix + k];
+        if (a < b) {
+            j += k;
+            k = 1;
+            per = j - max_suffix;
+        } else if (a == b) {
+            if (k != per) {
+                k++;
+            } else {
+                j += per;
+                k = 1;
             }
-            if (j == plen)
-            {
-                free(table);
-                return i - j;
+        } else {
+            max_suffix = j++;
+            k = per = 1;
+        }
+    }
+    *period = per;
+
+    max_suffix_rev = SIZE_MAX;
+    j = 0;
+    k = per = 1;
+    while (j + k < plen) {
+        a = p[j + k];
+        b = p[max_suffix_rev + k];
+        if (b < a) {
+            j += k;
+            k = 1;
+            per = j - max_suffix_rev;
+        } else if (a == b) {
+            if (k != per) {
+                k++;
+            } else {
+                j += per;
+                k = 1;
             }
-            else 
-            {
-                if (i < n && pattern[j] != s[i]) {
-                    if (j != 0)
-                        j = table[j - 1];
-                     else
-                        i++;
-                }
+        } else {
+            max_suffix_rev = j++;
+            k = per = 1;
+        }
+    }
+
+    if (max_suffix_rev + 1 < max_suffix + 1)
+        return max_suffix + 1;
+    *period = per;
+    return max_suffix_rev + 1;
+}
+
+/*
+    Compute the Two-Way factorisation and the bad-character table
+    of a pattern with 2 <= len.
+*/
+static
+void twoway_prepare(spattern* sp) {
+    const unsigned char* p = (const unsigned char*)sp->bytes;
+    size_t plen = sp->len;
+
+    sp->suffix = critical_factorization(p, plen, &sp->period);
+    sp->periodic = memcmp(p, p + sp->period, sp->suffix) == 0;
+    if (!sp->periodic)
+        sp->period = (sp->suffix > plen - sp->suffix ? sp->suffix : plen - sp->suffix) + 1;
+    for (size_t i = 0; i <= UCHAR_MAX; i++)
+        sp->shift[i] = plen;
+    for (size_t i = 0; i < plen; i++)
+        sp->shift[p[i]] = plen - i - 1;
+}
+
+/*
+    Two-Way string matching (Crochemore-Perrin).
+
+    Runs in O(n + plen) time on any input and needs no memory besides
+    the prepared pattern: the factorisation is two indices, and the
+    bad-character table lets long patterns skip ahead on mismatches.
+    If count is NULL, return the first match. Otherwise add every match,
+    overlapping ones included, to *count and return -1: the scan goes on
+    from the state a match leaves behind, so counting stays linear too.
+    Expects 2 <= len(sp) <= n.
+*/
+static
+ssize_t twoway_search(const spattern* sp, const char* s, size_t n, size_t* count) {
+    const unsigned char* h = (const unsigned char*)s;
+    const unsigned char* p = (const unsigned char*)sp->bytes;
+    size_t plen = sp->len;
+    size_t period = sp->period;
+    size_t suffix = sp->suffix;
+    size_t i, j, shift;
+
+    j = 0;
+    if (sp->periodic) {
+        /* Remember how much of the prefix already matched */
+        size_t memory = 0;
+        while (j <= n - plen) {
+            shift = sp->shift[h[j + plen - 1]];
+            if (shift > 0) {
+                if (memory && shift < period)
+                    shift = plen - period;
+                memory = 0;
+                j += shift;
+                continue;
             }
+            i = suffix > memory ? suffix : memory;
+            while (i < plen - 1 && p[i] == h[i + j])
+                i++;
+            if (i >= plen - 1) {
+                i = suffix - 1;
+                while (memory < i + 1 && p[i] == h[i + j])
+                    i--;
+                if (i + 1 < memory + 1) {
+                    if (count == NULL)
+                        return j;
+                    (*count)++;
+                }
+                j += period;
+                memory = plen - period;
+            } else {
+                j += i - suffix + 1;
+                memory = 0;
+            }
+        }
+    } else {
+        while (j <= n - plen) {
+            shift = sp->shift[h[j + plen - 1]];
+            if (shift > 0) {
+                j += shift;
+                continue;
+            }
+            i = suffix;
+            while (i < plen - 1 && p[i] == h[i + j])
+                i++;
+            if (i >= plen - 1) {
+                i = suffix - 1;
+                while (i != SIZE_MAX && p[i] == h[i + j])
+                    i--;
+                if (i == SIZE_MAX) {
+                    if (count == NULL)
+                        return j;
+                    (*count)++;
+                }
+                j += period;
+            } else {
+                j += i - suffix + 1;
+            }
+        }
+    }
+    return -1;
+}
+
+/*
+    Horspool's bad-character table: how far the window may move when
+    its last byte is c. Only bytes before the last one are entered.
+*/
+static
+void horspool_prepare(spattern* sp) {
+    const unsigned char* p = (const unsigned char*)sp->bytes;
+    size_t plen = sp->len;
+
+    for (size_t i = 0; i <= UCHAR_MAX; i++)
+        sp->shift[i] = plen;
+    for (size_t i = 0; i < plen - 1; i++)
+        sp->shift[p[i]] = plen - i - 1;
+}
+
+static
+ssize_t horspool_search(const spattern* sp, const char* s, size_t n) {
+    const unsigned char* h = (const unsigned char*)s;
+    size_t plen = sp->len;
+    unsigned char last = sp->bytes[plen - 1];
+    size_t j = 0;
+
+    while (j <= n - plen) {
+        unsigned char c = h[j + plen - 1];
+        if (c == last && memcmp(s + j, sp->bytes, plen - 1) == 0)
+            return j;
+        j += sp->shift[c];
+    }
+    return -1;
+}
+
+/*
+    Fill in a pattern for the given bytes without copying them.
+
+    The algorithm is chosen from the length and the shape of the pattern:
+    single bytes go to memchr, long patterns and patterns whose first and
+    last byte are equal (which defeats the SIMD filter) go to Two-Way,
+    and the rest use the SIMD filter, or Horspool when no vector kernel
+    is available. Expects plen > 0.
+*/
+static
+void spinit(spattern* sp, size_t plen, const char* pattern) {
+    sp->bytes = pattern;
+    sp->len = plen;
+    if (plen == 1) {
+        sp->algo = SP_BYTE;
+    } else if (plen >= TWOWAY_MIN_PLEN || (plen >= 8 && pattern[0] == pattern[plen - 1])) {
+        sp->algo = SP_TWOWAY;
+        twoway_prepare(sp);
+    } else if (plen >= 4 && kernels == &kernels_generic) {
+        sp->algo = SP_HORSPOOL;
+        horspool_prepare(sp);
+    } else {
+        sp->algo = SP_FILTER;
+    }
+}
+
+/*
+    Return the index of the first match of sp in s[0, n) or -1.
+*/
+static
+ssize_t spsearch(const spattern* sp, const char* s, size_t n) {
+    if (sp->len > n)
+        return -1;
+    switch (sp->algo) {
+        case SP_BYTE:
+        {
+            const char* hit = memchr(s, sp->bytes[0], n);
+            return hit ? hit - s : -1;
+        }
+        case SP_FILTER:
+            return kernels->find(s, n, sp->bytes, sp->len);
+        case SP_HORSPOOL:
+            return horspool_search(sp, s, n);
+        case SP_TWOWAY:
+            return twoway_search(sp, s, n, NULL);
+    }
+    return -1;
+}
+
+/*
+    Count the matches of sp in s[0, n), overlapping ones included.
+
+    Two-Way counts in one pass in O(n + plen). Horspool restarts one
+    byte after every match, which is O(n * plen) in the worst case,
+    but it is only used for patterns shorter than TWOWAY_MIN_PLEN.
+*/
+static
+size_t spcount(const spattern* sp, const char* s, size_t n) {
+    if (sp->len > n)
+        return 0;
+    if (sp->algo == SP_BYTE || sp->algo == SP_FILTER)
+        return kernels->count(s, n, sp->bytes, sp->len);
+    size_t count = 0;
+    if (sp->algo == SP_TWOWAY) {
+        twoway_search(sp, s, n, &count);
+        return count;
+    }
+    size_t start = 0;
+    ssize_t idx;
+    while ((idx = spsearch(sp, s + start, n - start)) != -1) {
+        count++;
+        start += idx + 1;
+    }
+    return count;
+}
+
+/*
+    Count the matches of sp in s[0, n) the way ssplit and sremove
+    consume them: scanning resumes after the end of every match.
+*/
+static
+size_t spcount_disjoint(const spattern* sp, const char* s, size_t n) {
+    size_t count = 0;
+    size_t start = 0;
+    ssize_t idx;
+    while ((idx = spsearch(sp, s + start, n - start)) != -1) {
+        count++;
+        start += idx + sp->len;
+    }
+    return count;
+}
+
+/*
+    Compile a pattern for repeated use.
+
+    The bytes are copied, so the pattern does not need to outlive
+    the returned object. Free it with spfree().
+
+    Return NULL if pattern is NULL or plen is 0.
+    Return NULL if malloc fails.
+*/
+spattern* spcompile(size_t plen, const char* pattern) {
+    if (pattern == NULL || plen == 0)
+        return NULL;
+    if (sizeof(spattern) + plen < plen)
+        return NULL;
+    spattern* sp = malloc(sizeof(spattern) + plen);
+    if (sp == NULL)
+        return NULL;
+    memcpy(sp->buf, pattern, plen);
+    spinit(sp, plen, sp->buf);
+    return sp;
+}
+
+/*
+    Free a pattern created by spcompile.
+
+    If input is NULL, do nothing.
+*/
+void spfree(spattern* sp) {
+    free(sp);
+}
+
+/*
+    Get the length of a compiled pattern.
+
+    If input is NULL, return 0.
+*/
+size_t spgetlen(const spattern* sp) {
+    if (sp == NULL) return 0;
+    return sp->len;
+}
+
+/*
+    Find the first substring matching 'pattern' using the Two-Way algorithm.
+
+    Same contract as sfind(). The search never allocates and is linear
+    in the length of s even for inputs like "aaaa...ab", which makes it
+    the right choice for long or highly repetitive patterns.
+*/
+ssize_t sfind_advanced(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return -1;
+    size_t n = sgetlen(s);
+    if (plen > n || plen == 0)
+        return -1;
+    spattern sp;
+    spinit(&sp, plen, pattern);
+    if (plen > 1 && sp.algo != SP_TWOWAY) {
+        sp.algo = SP_TWOWAY;
+        twoway_prepare(&sp);
+    }
+    return spsearch(&sp, s, n);
+}
+
+/*
+    Find the starting index of the first substring matching the 'pattern'.
+
+    Return -1 if s or pattern is NULL.
+    Return -1 if plen > len(s).
+    Return -1 if plen == 0.
+    Return -1 if pattern is not found.
+
+    Long patterns are matched with Two-Way, so the running time
+    stays linear in len(s) on adversarial input.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+ssize_t sfind(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return -1;
+    return sfind_view(sview_of(s), plen, pattern);
+}
+
+/*
+    Find the starting index of the first substring matching a compiled pattern.
+
+    Return -1 if s or sp is NULL.
+    Return -1 if len(sp) > len(s).
+    Return -1 if pattern is not found.
+*/
+ssize_t sfindp(string s, const spattern* sp) {
+    if (s == NULL || sp == NULL)
+        return -1;
+    return sfindp_view(sview_of(s), sp);
+}
+
+/*
+    Find the starting index of the last (right) substring matching the 'pattern'.
+
+    Return -1 if s or pattern is NULL.
+    Return -1 if plen > len(s).
+    Return -1 if plen == 0.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+ssize_t srfind(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return -1;
+    return srfind_view(sview_of(s), plen, pattern);
+}
+
+/*
+    Find the starting index of the last (right) substring matching a compiled pattern.
+
+    The compiled tables only drive forward scans, so this uses the same
+    backward kernel as srfind(): fast on typical text, but O(n * len(sp))
+    in the worst case.
+
+    Return -1 if s or sp is NULL.
+    Return -1 if len(sp) > len(s).
+    Return -1 if pattern is not found.
+*/
+ssize_t srfindp(string s, const spattern* sp) {
+    if (s == NULL || sp == NULL)
+        return -1;
+    size_t n = sgetlen(s);
+    if (sp->len > n)
+        return -1;
+    return kernels->rfind(s, n, sp->bytes, sp->len);
+}
+
+/*
+    Count the amount of substrings matching 'pattern'.
+
+    Return -1 if s or pattern is NULL.
+    Return -1 if plen > len(s).
+    Return -1 if plen == 0.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+ssize_t scount(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return -1;
+    return scount_view(sview_of(s), plen, pattern);
+}
+
+/*
+    Count the amount of substrings matching a compiled pattern.
+
+    Return -1 if s or sp is NULL.
+    Return -1 if len(sp) > len(s).
+*/
+ssize_t scountp(string s, const spattern* sp) {
+    if (s == NULL || sp == NULL)
+        return -1;
+    return scountp_view(sview_of(s), sp);
+}
+
+/*
+    Remove the given pattern from the beginning and the end of the string.
+
+    Return false if s or pattern is NULL.
+    Return false if s is read-only, see sunshare().
+    Return false if plen > len(s) or plen is 0.
+    Return true on success.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+bool strim(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL || sreadonly(s))
+        return false;
+    size_t len = sgetlen(s);
+    if (plen > len || plen == 0)
+        return false;
+    size_t newstart = 0;
+    while (newstart + plen <= len && memcmp(s + newstart, pattern, plen) == 0)
+        newstart += plen;
+    size_t rm_end = 1;
+    while (newstart < len - rm_end * plen && 
+           memcmp(s + len - rm_end * plen, pattern, plen) == 0)
+        rm_end++;
+    size_t newlen = len - newstart - (rm_end - 1) * plen;
+    if (newstart > 0)
+        memmove(s, s + newstart, newlen);
+    s[newlen] = 0;
+    ssetlen(s, newlen);
+    return true;
+}
+
+/*
+    Remove the given pattern from the string.
+
+    Return false if s or pattern is NULL.
+    Return false if s is read-only, see sunshare().
+    Return false if plen > len(s) or plen is 0.
+    Return true on success.
+
+    Behaviour is undefined if plen != len(pattern).
+*/
+bool sremove(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL || sreadonly(s))
+        return false;
+    if (plen > sgetlen(s) || plen == 0)
+        return false;
+    spattern sp;
+    spinit(&sp, plen, pattern);
+    return sremovep(s, &sp);
+}
+
+/*
+    Remove a compiled pattern from the string.
+
+    Return false if s or sp is NULL.
+    Return false if s is read-only, see sunshare().
+    Return false if len(sp) > len(s).
+    Return true on success.
+*/
+bool sremovep(string s, const spattern* sp) {
+    if (s == NULL || sp == NULL || sreadonly(s))
+        return false;
+    size_t slen = sgetlen(s);
+    if (sp->len > slen)
+        return false;
+    size_t out = 0;
+    size_t in = 0;
+    ssize_t idx;
+    while ((idx = spsearch(sp, s + in, slen - in)) != -1) {
+        memmove(s + out, s + in, idx);
+        out += idx;
+        in += idx + sp->len;
+    }
+    memmove(s + out, s + in, slen - in);
+    out += slen - in;
+    ssetlen(s, out);
+    s[out] = 0;
+    return true;
+}
+
+/*
+    Create a new string that is a slice of an existing one.
+
+    Return NULL if s is NULL.
+    Return NULL if start >= end.
+    Return NULL if malloc fails.
+    Return a slice [start, end).
+*/
+string sslice(string s, size_t start, size_t end) {
+    if (s == NULL) return NULL;
+    if (start >= end) return NULL;
+    return snewlen(s + start, end - start);
+}
+
+static
+string sbite_at(string s, size_t idx, size_t plen) {
+    string new = sslice(s, 0, idx);
+    size_t newlen = sgetlen(s) - idx - plen;
+    memmove(s, s + idx + plen, newlen);
+    s[newlen] = 0;
+    ssetlen(s, newlen);
+    return new;
+}
+
+/*
+    Bite the given string.
+
+    Example:
+        s = snew("some;;;thing")
+        pattern = ";;;"
+        new = sbite(s, 3, pattern);
+        -> new == "some" && s == "thing"
+
+    Every bite moves the rest of s to its start. To consume a whole
+    buffer token by token without copying, use stok_next() instead.
+
+    Return NULL if s is NULL or pattern is NULL.
+    Return NULL if s is read-only, see sunshare().
+    Return NULL if plen > len(s).
+    Return NULL if pattern is not found in s.
+*/
+string sbite(string s, size_t plen, const char* pattern) {
+    ssize_t idx = sfind(s, plen, pattern);
+    if (idx == -1 || sreadonly(s)) return NULL;
+    return sbite_at(s, idx, plen);
+}
+
+/*
+    Bite the given string at the first match of a compiled pattern.
+
+    Return NULL if s or sp is NULL.
+    Return NULL if s is read-only, see sunshare().
+    Return NULL if len(sp) > len(s).
+    Return NULL if pattern is not found in s.
+*/
+string sbitep(string s, const spattern* sp) {
+    ssize_t idx = sfindp(s, sp);
+    if (idx == -1 || sreadonly(s)) return NULL;
+    return sbite_at(s, idx, sp->len);
+}
+
+/*
+    Split a string using the given separator into an array of n substrings.
+
+    Return NULL if s, sep or n is NULL.
+    Return NULL if seplen > len(s) or seplen is 0.
+    Return NULL if the input causes size_t overflow.
+    Return NULL if any allocation fails.
+*/
+string* ssplit(const string s, size_t seplen, const char* sep, size_t* n) {
+    if (!s || !sep || !n)
+        return NULL;
+    if (seplen > sgetlen(s) || seplen == 0)
+        return NULL;
+    spattern sp;
+    spinit(&sp, seplen, sep);
+    return ssplitp(s, &sp, n);
+}
+
+/*
+    Split s at every match of sep, taking the pieces and the array
+    from arena a or from malloc if a is NULL.
+*/
+static
+string* ssplit_in(sarena* a, const string s, const spattern* sep, size_t* n) {
+    size_t slen = sgetlen(s);
+    if (sep->len > slen)
+        return NULL;
+    size_t count = spcount_disjoint(sep, s, slen);
+    size_t size_to_alloc = (count + 1) * sizeof(string);
+    if (size_to_alloc / sizeof(string) != count + 1)
+        return NULL;
+    string* arr = a ? saalloc(a, size_to_alloc) : malloc(size_to_alloc);
+    if (!arr)
+        return NULL;
+
+    size_t elem = 0;
+    size_t start = 0;
+    ssize_t idx;
+    while ((idx = spsearch(sep, s + start, slen - start)) != -1) {
+        arr[elem] = snewlen_in(a, s + start, idx, 0);
+        if (!arr[elem]) goto cleanup;
+        elem++;
+        start += idx + sep->len;
+    }
+    arr[elem] = snewlen_in(a, s + start, slen - start, 0);
+    if (!arr[elem] || elem != count) goto cleanup;
+    *n = elem + 1;
+    return arr;
+
+cleanup:
+    {
+        if (a)
+            return NULL;
+        for (size_t i = 0; i < elem; i++)
+            sfree(arr[i]);
+        free(arr);
+        return NULL;
+    }
+}
+
+/*
+    Split a string using a compiled separator into an array of n substrings.
+
+    Return NULL if s, sep or n is NULL.
+    Return NULL if len(sep) > len(s).
+    Return NULL if the input causes size_t overflow.
+    Return NULL if any allocation fails.
+*/
+string* ssplitp(const string s, const spattern* sep, size_t* n) {
+    if (!s || !sep || !n)
+        return NULL;
+    return ssplit_in(NULL, s, sep, n);
+}
+
+/*
+    Free an array created by ssplit.
+*/
+void sfreearr(string* arr, size_t n) {
+    if (!arr) return;
+    for (size_t i = 0; i < n; i++)
+        sfree(arr[i]);
+    free(arr);
+}
+
+/*
+    Build a set of bytes for the trim and span functions.
+
+    The set is built once and can be kept and shared; nothing is allocated.
+    A NULL chars gives an empty set.
+
+    Example:
+        scharset ws = scharset_of(4, " \t\r\n");
+        strimchars(s, &ws);
+*/
+scharset scharset_of(size_t n, const char* chars) {
+    scharset cs;
+    memset(&cs, 0, sizeof(cs));
+    if (chars == NULL) return cs;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = chars[i];
+        cs.bits[c >> 6] |= 1ull << (c & 63);
+        cs.nib[c >> 7][c & 15] |= 1 << ((c >> 4) & 7);
+    }
+    return cs;
+}
+
+/*
+    Check whether c is in the set.
+
+    Return false if cs is NULL.
+*/
+bool scharset_has(const scharset* cs, char c) {
+    if (cs == NULL) return false;
+    return scharset_test(cs, c);
+}
+
+/* Length of the suffix of s[0, n) whose bytes are all in the set */
+static
+size_t srcharspan(const char* s, size_t n, const scharset* cs) {
+    size_t i = n;
+    while (i > 0 && scharset_test(cs, s[i - 1]))
+        i--;
+    return n - i;
+}
+
+/*
+    Trim any character in c_arr from the beginning of the given string.
+
+    Return false if s or c_arr is NULL.
+    Return false if s is read-only, see sunshare().
+    Return false if c_size is 0.
+
+    Behaviour is undefined if c_size != len(c_arr).
+*/
+bool sltrimchar(string s, size_t c_size, char* c_arr) {
+    if (!s || !c_arr || !c_size || sreadonly(s))
+        return false;
+    scharset cs = scharset_of(c_size, c_arr);
+    return sltrimchars(s, &cs);
+}
+
+/*
+    Trim the characters in a set from the beginning of the given string.
+
+    Return false if s or cs is NULL.
+    Return false if s is read-only, see sunshare().
+    Return true on success.
+*/
+bool sltrimchars(string s, const scharset* cs) {
+    if (!s || !cs || sreadonly(s))
+        return false;
+    size_t slen = sgetlen(s);
+    size_t counter = charspan(s, slen, cs, true);
+    if (counter > 0)
+        memmove(s, s + counter, slen - counter);
+    ssetlen(s, slen - counter);
+    s[slen - counter] = 0;
+    return true;
+}
+
+/*
+    Trim the characters in a set from the end of the given string.
+
+    Return false if s or cs is NULL.
+    Return false if s is read-only, see sunshare().
+    Return true on success.
+*/
+bool srtrimchars(string s, const scharset* cs) {
+    if (!s || !cs || sreadonly(s))
+        return false;
+    size_t slen = sgetlen(s);
+    size_t newlen = slen - srcharspan(s, slen, cs);
+    ssetlen(s, newlen);
+    s[newlen] = 0;
+    return true;
+}
+
+/*
+    Trim the characters in a set from both ends of the given string.
+
+    Return false if s or cs is NULL.
+    Return false if s is read-only, see sunshare().
+    Return true on success.
+*/
+bool strimchars(string s, const scharset* cs) {
+    if (!s || !cs || sreadonly(s))
+        return false;
+    size_t slen = sgetlen(s);
+    size_t start = charspan(s, slen, cs, true);
+    size_t newlen = slen - start - srcharspan(s + start, slen - start, cs);
+    if (start > 0)
+        memmove(s, s + start, newlen);
+    ssetlen(s, newlen);
+    s[newlen] = 0;
+    return true;
+}
+
+/*
+    Get the length of the prefix of a view made of characters in the set.
+
+    Return 0 if v.ptr or cs is NULL.
+*/
+size_t sspn_view(sview v, const scharset* cs) {
+    if (v.ptr == NULL || cs == NULL) return 0;
+    return charspan(v.ptr, v.len, cs, true);
+}
+
+/*
+    Get the length of the prefix of a view made of characters not in the set.
+
+    Return 0 if v.ptr or cs is NULL.
+*/
+size_t scspn_view(sview v, const scharset* cs) {
+    if (v.ptr == NULL || cs == NULL) return 0;
+    return charspan(v.ptr, v.len, cs, false);
+}
+
+/*
+    Find the first character of a view that is in the set.
+
+    Return -1 if v.ptr or cs is NULL.
+    Return -1 if no character is in the set.
+    Return the index of the character.
+*/
+ssize_t sfind_any_of_view(sview v, const scharset* cs) {
+    if (v.ptr == NULL || cs == NULL) return -1;
+    size_t i = charspan(v.ptr, v.len, cs, false);
+    return i == v.len ? -1 : (ssize_t)i;
+}
+
+/*
+    Same as strspn() with a character set, for a string.
+    See sspn_view().
+*/
+size_t sspn(const string s, const scharset* cs) {
+    return sspn_view(sview_of(s), cs);
+}
+
+/*
+    Same as strcspn() with a character set, for a string.
+    See scspn_view().
+*/
+size_t scspn(const string s, const scharset* cs) {
+    return scspn_view(sview_of(s), cs);
+}
+
+/*
+    Find the first character of a string that is in the set.
+    See sfind_any_of_view().
+*/
+ssize_t sfind_any_of(const string s, const scharset* cs) {
+    return sfind_any_of_view(sview_of(s), cs);
+}
+
+/*
+    Length of s after replacing count matches of olen bytes
+    with nlen bytes. Return false on size_t overflow.
+*/
+static inline
+bool sreplace_len(size_t slen, size_t count, size_t olen, size_t nlen, size_t* out) {
+    if (nlen <= olen) {
+        *out = slen - count * (olen - nlen);
+        return true;
+    }
+    size_t d = nlen - olen;
+    if (count && d > (SIZE_MAX - 1 - slen) / count)
+        return false;
+    *out = slen + count * d;
+    return true;
+}
+
+/*
+    Create a new string where old pattern is replaced with a new one.
+
+    Return NULL if s, old or new is NULL.
+    Return NULL if olen > len(s) or olen is 0.
+    Return NULL if the result causes size_t overflow.
+    Return NULL if malloc fails.
+
+    Behaviour is undefined if olen != len(old) or nlen != len(new).
+*/
+string sreplace(const string s, size_t olen, const char* old, size_t nlen, const char* new) {
+    if (!s || !old)
+        return NULL;
+    if (olen > sgetlen(s) || olen == 0)
+        return NULL;
+    spattern sp;
+    spinit(&sp, olen, old);
+    return sreplacep(s, &sp, nlen, new);
+}
+
+/*
+    Create a new string where a compiled pattern is replaced with a new one.
+
+    Matches are counted first, so the result is allocated once at its
+    exact size and filled with one copy per segment.
+
+    Return NULL if s, old or new is NULL.
+    Return NULL if len(old) > len(s).
+    Return NULL if the result causes size_t overflow.
+    Return NULL if malloc fails.
+
+    Behaviour is undefined if nlen != len(new).
+*/
+string sreplacep(const string s, const spattern* old, size_t nlen, const char* new) {
+    if (!s || !old || !new)
+        return NULL;
+    size_t slen = sgetlen(s);
+    size_t olen = old->len;
+    if (olen > slen)
+        return NULL;
+    size_t count = spcount_disjoint(old, s, slen);
+    size_t rlen;
+    if (!sreplace_len(slen, count, olen, nlen, &rlen))
+        return NULL;
+    string res = snewlen(NULL, rlen);
+    if (!res)
+        return NULL;
+
+    char* out = res;
+    size_t in = 0;
+    ssize_t idx;
+    for (size_t i = 0; i < count; i++) {
+        idx = spsearch(old, s + in, slen - in);
+        memcpy(out, s + in, idx);
+        out += idx;
+        memcpy(out, new, nlen);
+        out += nlen;
+        in += idx + olen;
+    }
+    memcpy(out, s + in, slen - in);
+    res[rlen] = 0;
+    return res;
+}
+
+/*
+    Replace old pattern with a new one inside s.
+
+    When nlen <= olen the string is compacted in place without
+    allocating. Otherwise it grows once, by the exact amount the
+    replacements need, and is rewritten in place.
+
+    A read-only s is not changed: the result is a new string and
+    s is released as by sfree().
+
+    Return s if olen > len(s), since there is nothing to replace.
+    Return NULL if s is NULL.
+    Return NULL and free s if old or new is NULL, or olen is 0.
+    Return NULL and free s if the result causes size_t overflow.
+    Return NULL and free s if realloc fails.
+
+    Behaviour is undefined if olen != len(old) or nlen != len(new),
+    or if new points into s.
+*/
+string sreplace_inplace(string s, size_t olen, const char* old, size_t nlen, const char* new) {
+    if (!s)
+        return NULL;
+    if (!old || !new || olen == 0) {
+        sfree(s);
+        return NULL;
+    }
+    size_t slen = sgetlen(s);
+    if (olen > slen)
+        return s;
+    spattern sp;
+    spinit(&sp, olen, old);
+    if (sreadonly(s)) {
+        string res = sreplacep(s, &sp, nlen, new);
+        sfree(s);
+        return res;
+    }
+
+    size_t in = 0;
+    size_t out = 0;
+    ssize_t idx;
+    if (nlen <= olen) {
+        while ((idx = spsearch(&sp, s + in, slen - in)) != -1) {
+            memmove(s + out, s + in, idx);
+            out += idx;
+            memcpy(s + out, new, nlen);
+            out += nlen;
+            in += idx + olen;
+        }
+        memmove(s + out, s + in, slen - in);
+        out += slen - in;
+        ssetlen(s, out);
+        s[out] = 0;
+        return s;
+    }
+
+    size_t count = spcount_disjoint(&sp, s, slen);
+    if (count == 0)
+        return s;
+    size_t rlen;
+    if (!sreplace_len(slen, count, olen, nlen, &rlen)) {
+        sfree(s);
+        return NULL;
+    }
+    string grown = smakeroom(s, rlen - slen);
+    if (!grown) {
+        sfree(s);
+        return NULL;
+    }
+    s = grown;
+    /*
+        Move the original bytes to the end of the buffer and rewrite
+        from the front. The write position never passes the read one,
+        because each match can only have grown the output by
+        nlen - olen of the rlen - slen bytes of headroom.
+    */
+    in = rlen - slen;
+    memmove(s + in, s, slen);
+    for (size_t i = 0; i < count; i++) {
+        idx = spsearch(&sp, s + in, rlen - in);
+        memmove(s + out, s + in, idx);
+        out += idx;
+        memcpy(s + out, new, nlen);
+        out += nlen;
+        in += idx + olen;
+    }
+    ssetlen(s, rlen);
+    s[rlen] = 0;
+    return s;
+}
+
+/*
+    Multi-pattern search (Aho-Corasick).
+
+    States are numbered in breadth-first order. The root keeps a dense
+    256 entry transition table, every other state keeps its outgoing
+    edges as a sorted run in one shared array, so the automaton is a
+    handful of flat arrays no matter how many patterns it holds.
+*/
+#define AC_NONE UINT32_MAX
+#define AC_LINEAR_EDGES 8
+
+typedef struct acstate {
+    uint32_t edges;
+    uint32_t nedges;
+    uint32_t fail;
+    uint32_t out;
+    uint32_t dict;
+} acstate;
+
+struct smulti {
+    size_t npatterns;
+    size_t maxlen;
+    size_t* lens;
+    uint32_t* same;
+    acstate* states;
+    uint8_t* edge_bytes;
+    uint32_t* edge_targets;
+    uint32_t root[UCHAR_MAX + 1];
+};
+
+static inline
+uint32_t acedge(const smulti* m, uint32_t st, unsigned char c) {
+    const uint8_t* bytes = m->edge_bytes + m->states[st].edges;
+    const uint32_t* targets = m->edge_targets + m->states[st].edges;
+    size_t n = m->states[st].nedges;
+    if (n <= AC_LINEAR_EDGES) {
+        for (size_t i = 0; i < n && bytes[i] <= c; i++) {
+            if (bytes[i] == c)
+                return targets[i];
+        }
+        return AC_NONE;
+    }
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (bytes[mid] < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < n && bytes[lo] == c ? targets[lo] : AC_NONE;
+}
+
+static inline
+uint32_t acstep(const smulti* m, uint32_t st, unsigned char c) {
+    while (st != 0) {
+        uint32_t next = acedge(m, st, c);
+        if (next != AC_NONE)
+            return next;
+        st = m->states[st].fail;
+    }
+    return m->root[c];
+}
+
+/*
+    Build the automaton: insert all patterns into a temporary
+    first-child/next-sibling trie, lay it out in breadth-first order
+    and compute the failure and dictionary links.
+*/
+static
+bool acbuild(smulti* m, size_t n, const size_t lens[n], const char* patterns[n], size_t total) {
+    bool ok = false;
+    size_t nodes = 1;
+    uint32_t* child = malloc((total + 1) * sizeof(uint32_t));
+    uint32_t* sibling = malloc((total + 1) * sizeof(uint32_t));
+    uint8_t* label = malloc(total + 1);
+    uint32_t* ends = malloc(n * sizeof(uint32_t));
+    uint32_t* order = malloc((total + 1) * sizeof(uint32_t));
+    uint32_t* newid = malloc((total + 1) * sizeof(uint32_t));
+    if (!child || !sibling || !label || !ends || !order || !newid)
+        goto cleanup;
+
+    child[0] = sibling[0] = AC_NONE;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t cur = 0;
+        for (size_t j = 0; j < lens[i]; j++) {
+            uint8_t c = patterns[i][j];
+            uint32_t* link = &child[cur];
+            while (*link != AC_NONE && label[*link] < c)
+                link = &sibling[*link];
+            if (*link == AC_NONE || label[*link] != c) {
+                child[nodes] = AC_NONE;
+                sibling[nodes] = *link;
+                label[nodes] = c;
+                *link = nodes++;
+            }
+            cur = *link;
+        }
+        ends[i] = cur;
+    }
+
+    m->states = malloc(nodes * sizeof(acstate));
+    m->edge_bytes = malloc(nodes);
+    m->edge_targets = malloc(nodes * sizeof(uint32_t));
+    if (!m->states || !m->edge_bytes || !m->edge_targets)
+        goto cleanup;
+
+    /* Breadth-first numbering, children of a state get consecutive ids */
+    size_t head = 0, tail = 1;
+    order[0] = 0;
+    newid[0] = 0;
+    while (head < tail) {
+        uint32_t old = order[head];
+        acstate* st = &m->states[head];
+        st->edges = tail - 1;
+        st->nedges = 0;
+        st->out = AC_NONE;
+        for (uint32_t c = child[old]; c != AC_NONE; c = sibling[c]) {
+            newid[c] = tail;
+            m->edge_bytes[tail - 1] = label[c];
+            m->edge_targets[tail - 1] = tail;
+            order[tail++] = c;
+            st->nedges++;
+        }
+        head++;
+    }
+
+    for (size_t i = 0; i <= UCHAR_MAX; i++)
+        m->root[i] = 0;
+    for (size_t i = 0; i < m->states[0].nedges; i++)
+        m->root[m->edge_bytes[i]] = m->edge_targets[i];
+    m->states[0].nedges = 0;
+
+    for (size_t i = n; i-- > 0;) {
+        uint32_t st = newid[ends[i]];
+        m->same[i] = m->states[st].out;
+        m->states[st].out = i;
+    }
+
+    /* Failure links point to the longest proper suffix that is a state */
+    m->states[0].fail = 0;
+    m->states[0].dict = AC_NONE;
+    for (size_t c = 0; c <= UCHAR_MAX; c++) {
+        uint32_t t = m->root[c];
+        if (t != 0) {
+            m->states[t].fail = 0;
+            m->states[t].dict = AC_NONE;
+        }
+    }
+    for (size_t st = 1; st < nodes; st++) {
+        const acstate* s = &m->states[st];
+        for (uint32_t e = s->edges; e < s->edges + s->nedges; e++) {
+            uint32_t t = m->edge_targets[e];
+            uint32_t f = acstep(m, s->fail, m->edge_bytes[e]);
+            m->states[t].fail = f;
+            m->states[t].dict = m->states[f].out != AC_NONE ? f : m->states[f].dict;
+        }
+    }
+    ok = true;
+
+cleanup:
+    free(child);
+    free(sibling);
+    free(label);
+    free(ends);
+    free(order);
+    free(newid);
+    return ok;
+}
+
+/*
+    Compile n patterns into one automaton for multi-pattern search.
+
+    The patterns are not referenced after the call. Free the result
+    with smfree(). Identical patterns are allowed and are reported
+    separately, in the order they were given.
+
+    Return NULL if patterns or lens is NULL or n is 0.
+    Return NULL if any pattern is NULL or has length 0.
+    Return NULL if the total length does not fit the automaton.
+    Return NULL if any allocation fails.
+*/
+smulti* smcompile(size_t n, const size_t lens[n], const char* patterns[n]) {
+    if (!patterns || !lens || n == 0)
+        return NULL;
+    size_t total = 0;
+    size_t maxlen = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!patterns[i] || lens[i] == 0)
+            return NULL;
+        if (total + lens[i] < total)
+            return NULL;
+        total += lens[i];
+        if (lens[i] > maxlen)
+            maxlen = lens[i];
+    }
+    if (total >= AC_NONE || n >= AC_NONE)
+        return NULL;
+
+    smulti* m = calloc(1, sizeof(smulti));
+    if (!m)
+        return NULL;
+    m->npatterns = n;
+    m->maxlen = maxlen;
+    m->lens = malloc(n * sizeof(size_t));
+    m->same = malloc(n * sizeof(uint32_t));
+    if (!m->lens || !m->same || !acbuild(m, n, lens, patterns, total)) {
+        smfree(m);
+        return NULL;
+    }
+    memcpy(m->lens, lens, n * sizeof(size_t));
+    return m;
+}
+
+/*
+    Free an automaton created by smcompile.
+
+    If input is NULL, do nothing.
+*/
+void smfree(smulti* m) {
+    if (!m) return;
+    free(m->lens);
+    free(m->same);
+    free(m->states);
+    free(m->edge_bytes);
+    free(m->edge_targets);
+    free(m);
+}
+
+/*
+    Find the leftmost match of any pattern.
+
+    If which is not NULL, the index of the matching pattern is stored there.
+    When several patterns start at the same index, the one given first
+    to smcompile wins.
+
+    Return -1 if s or m is NULL.
+    Return -1 if no pattern is found.
+*/
+ssize_t smfind(string s, const smulti* m, size_t* which) {
+    if (!s || !m)
+        return -1;
+    size_t n = sgetlen(s);
+    size_t best = SIZE_MAX;
+    size_t best_pattern = 0;
+    uint32_t st = 0;
+    for (size_t i = 0; i < n; i++) {
+        /* Nothing ending here or later can start before best */
+        if (best != SIZE_MAX && i - best >= m->maxlen)
+            break;
+        st = acstep(m, st, s[i]);
+        uint32_t o = m->states[st].out != AC_NONE ? st : m->states[st].dict;
+        for (; o != AC_NONE; o = m->states[o].dict) {
+            for (uint32_t p = m->states[o].out; p != AC_NONE; p = m->same[p]) {
+                size_t start = i + 1 - m->lens[p];
+                if (start < best || (start == best && p < best_pattern)) {
+                    best = start;
+                    best_pattern = p;
+                }
+            }
+        }
+    }
+    if (best == SIZE_MAX)
+        return -1;
+    if (which)
+        *which = best_pattern;
+    return best;
+}
+
+/*
+    Find every match of every pattern, overlapping ones included.
+
+    Up to cap matches are stored in out, ordered by the index where they
+    end and then by pattern. The total is returned even if it exceeds
+    cap, so calling with cap 0 counts the matches.
+
+    Return -1 if s or m is NULL.
+    Return -1 if out is NULL and cap > 0.
+*/
+ssize_t smfindall(string s, const smulti* m, smatch* out, size_t cap) {
+    if (!s || !m || (!out && cap))
+        return -1;
+    size_t n = sgetlen(s);
+    size_t found = 0;
+    uint32_t st = 0;
+    for (size_t i = 0; i < n; i++) {
+        st = acstep(m, st, s[i]);
+        uint32_t o = m->states[st].out != AC_NONE ? st : m->states[st].dict;
+        for (; o != AC_NONE; o = m->states[o].dict) {
+            for (uint32_t p = m->states[o].out; p != AC_NONE; p = m->same[p]) {
+                if (found < cap) {
+                    out[found].pos = i + 1 - m->lens[p];
+                    out[found].pattern = p;
+                }
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+/*
+    Count the matches of every pattern, overlapping ones included.
+
+    counts must have room for one entry per pattern; counts[i] receives
+    the same value scount() would return for pattern i.
+
+    Return -1 if s, m or counts is NULL.
+    Return the total amount of matches.
+*/
+ssize_t smcount(string s, const smulti* m, size_t* counts) {
+    if (!s || !m || !counts)
+        return -1;
+    size_t n = sgetlen(s);
+    size_t total = 0;
+    uint32_t st = 0;
+    memset(counts, 0, m->npatterns * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        st = acstep(m, st, s[i]);
+        uint32_t o = m->states[st].out != AC_NONE ? st : m->states[st].dict;
+        for (; o != AC_NONE; o = m->states[o].dict) {
+            for (uint32_t p = m->states[o].out; p != AC_NONE; p = m->same[p]) {
+                counts[p]++;
+                total++;
+            }
+        }
+    }
+    return total;
+}
+
+/*
+    Create an arena for strings.
+
+    Strings are bump-allocated from blocks of blocksize bytes
+    (a default is used if blocksize is 0) and are all released
+    together by sareset() or safree().
+
+    Return NULL if malloc fails.
+*/
+sarena* sacreate(size_t blocksize) {
+    sarena* a = malloc(sizeof(sarena));
+    if (a == NULL)
+        return NULL;
+    a->head = NULL;
+    a->blocksize = blocksize ? blocksize : SARENA_BLOCK;
+    return a;
+}
+
+/*
+    Release every string of the arena but keep one block for reuse.
+
+    If input is NULL, do nothing.
+*/
+void sareset(sarena* a) {
+    if (a == NULL) return;
+    sablock* keep = NULL;
+    sablock* b = a->head;
+    while (b != NULL) {
+        sablock* next = b->next;
+        if (keep == NULL && b->size == a->blocksize) {
+            keep = b;
+            keep->used = 0;
+            keep->next = NULL;
+        } else {
+            free(b);
+        }
+        b = next;
+    }
+    a->head = keep;
+}
+
+/*
+    Free the arena together with every string created in it.
+
+    If input is NULL, do nothing.
+*/
+void safree(sarena* a) {
+    if (a == NULL) return;
+    sablock* b = a->head;
+    while (b != NULL) {
+        sablock* next = b->next;
+        free(b);
+        b = next;
+    }
+    free(a);
+}
+
+/*
+    Create a new string with length ilen in the arena.
+
+    Same contract as snewlen(). sfree() on the result does nothing;
+    appending to it moves it to the heap, after which it must be
+    freed with sfree() as usual.
+
+    Return NULL if a is NULL.
+*/
+string sanewlen(sarena* a, const void* input, size_t ilen) {
+    if (a == NULL) return NULL;
+    return snewlen_in(a, input, ilen, 0);
+}
+
+/*
+    Create a new string from a null-terminated input in the arena.
+
+    Return NULL if a or input is NULL.
+
+    This function is not binary safe.
+*/
+string sanew(sarena* a, const void* input) {
+    if (a == NULL || input == NULL) return NULL;
+    return snewlen_in(a, input, strlen(input), 0);
+}
+
+/*
+    Create a duplicate of the given string in the arena.
+
+    Return NULL if a or s is NULL.
+*/
+string sadup(sarena* a, const string s) {
+    if (a == NULL || s == NULL) return NULL;
+    return snewlen_in(a, s, sgetlen(s), 0);
+}
+
+/*
+    Create a slice [start, end) of s in the arena.
+
+    Return NULL if a or s is NULL.
+    Return NULL if start >= end.
+*/
+string saslice(sarena* a, string s, size_t start, size_t end) {
+    if (a == NULL || s == NULL) return NULL;
+    if (start >= end) return NULL;
+    return snewlen_in(a, s + start, end - start, 0);
+}
+
+/*
+    Split a string like ssplit(), placing the pieces and the array in the arena.
+
+    The array must not be passed to sfreearr(); it is released with the arena.
+
+    Return NULL if a, s, sep or n is NULL.
+    Return NULL if seplen > len(s) or seplen is 0.
+    Return NULL if any allocation fails.
+*/
+string* sasplit(sarena* a, const string s, size_t seplen, const char* sep, size_t* n) {
+    if (!a || !s || !sep || !n)
+        return NULL;
+    if (seplen > sgetlen(s) || seplen == 0)
+        return NULL;
+    spattern sp;
+    spinit(&sp, seplen, sep);
+    return ssplit_in(a, s, &sp, n);
+}
+
+/*
+    Create a view of the whole string.
+
+    The view does not own the bytes and is valid as long as s is
+    not freed or modified. If s is NULL, the view is empty and its
+    ptr is NULL, which view functions treat like a NULL string.
+*/
+sview sview_of(const string s) {
+    sview v = {s, sgetlen(s)};
+    return v;
+}
+
+/*
+    Create a view of the slice [start, end) without copying.
+
+    Return an empty view with a NULL ptr if s.ptr is NULL.
+    Return an empty view with a NULL ptr if start >= end or end > len(s).
+*/
+sview sslice_view(sview s, size_t start, size_t end) {
+    sview v = {NULL, 0};
+    if (s.ptr == NULL || start >= end || end > s.len)
+        return v;
+    v.ptr = s.ptr + start;
+    v.len = end - start;
+    return v;
+}
+
+/*
+    Bite a view: return the part before the first 'pattern' and
+    advance *s past the pattern. Nothing is copied or moved.
+
+    Example:
+        sview v = sview_of(snew("some;;;thing"));
+        sview head = sbite_view(&v, 3, ";;;");
+        -> head == "some" && v == "thing"
+
+    Return an empty view with a NULL ptr and leave *s unchanged
+    if s or pattern is NULL, if plen > len(s) or plen is 0,
+    or if pattern is not found.
+*/
+sview sbite_view(sview* s, size_t plen, const char* pattern) {
+    sview head = {NULL, 0};
+    if (s == NULL)
+        return head;
+    ssize_t idx = sfind_view(*s, plen, pattern);
+    if (idx == -1)
+        return head;
+    head.ptr = s->ptr;
+    head.len = idx;
+    s->ptr += idx + plen;
+    s->len -= idx + plen;
+    return head;
+}
+
+/*
+    Start walking the tokens of a view separated by sep.
+
+    The cursor lives wherever the caller puts it and only points into v,
+    so tokenizing allocates and copies nothing. v must outlive it.
+    Tokens are found with the same search as sfind().
+
+    A NULL view or separator, or seplen 0, gives a cursor without tokens.
+    If t is NULL, do nothing.
+*/
+void stok_init_view(stok* t, sview v, size_t seplen, const char* sep) {
+    if (t == NULL) return;
+    t->rest = v;
+    t->sep = sep;
+    t->seplen = seplen;
+    t->sp = NULL;
+    t->done = v.ptr == NULL || sep == NULL || seplen == 0;
+}
+
+/*
+    Start walking the tokens of a string separated by sep.
+    See stok_init_view().
+
+    Example:
+        stok t;
+        sview line;
+        stok_init(&t, s, 2, "\r\n");
+        while (stok_next(&t, &line))
+            handle(line);
+*/
+void stok_init(stok* t, const string s, size_t seplen, const char* sep) {
+    stok_init_view(t, sview_of(s), seplen, sep);
+}
+
+/*
+    Start walking the tokens of a view separated by a compiled pattern.
+    See stok_init_view(). sp must outlive the cursor.
+*/
+void stok_initp(stok* t, sview v, const spattern* sp) {
+    if (t == NULL) return;
+    stok_init_view(t, v, sp ? sp->len : 0, sp ? sp->bytes : NULL);
+    t->sp = sp;
+}
+
+/*
+    Get the next token.
+
+    The tokens are the pieces between separators, empty ones included,
+    followed by whatever comes after the last separator, as with
+    ssplit(). So "a,,b," yields "a", "", "b" and "".
+
+    Return false if t or out is NULL, or all tokens have been taken.
+    Return true and store the token in *out otherwise.
+*/
+bool stok_next(stok* t, sview* out) {
+    if (t == NULL || out == NULL || t->done) return false;
+    ssize_t idx;
+    if (t->sp)
+        idx = spsearch(t->sp, t->rest.ptr, t->rest.len);
+    else
+        idx = sfind_view(t->rest, t->seplen, t->sep);
+    if (idx == -1) {
+        *out = t->rest;
+        t->rest.ptr += t->rest.len;
+        t->rest.len = 0;
+        t->done = true;
+        return true;
+    }
+    out->ptr = t->rest.ptr;
+    out->len = idx;
+    t->rest.ptr += idx + t->seplen;
+    t->rest.len -= idx + t->seplen;
+    return true;
+}
+
+/*
+    Get the bytes that no token has covered yet.
+
+    Useful to hand the rest of a buffer, such as a message body after
+    its header lines, to another parser.
+    If t is NULL, return an empty view with a NULL ptr.
+*/
+sview stok_rest(const stok* t) {
+    sview v = {NULL, 0};
+    if (t == NULL) return v;
+    return t->rest;
+}
+
+/*
+    Split a view by sep into views of the pieces.
+
+    Up to cap views are stored in out. The total amount of pieces
+    is returned even if it exceeds cap, so calling with cap 0
+    sizes the array. No memory is allocated.
+
+    Return -1 if s.ptr or sep is NULL.
+    Return -1 if seplen > len(s) or seplen is 0.
+    Return -1 if out is NULL and cap > 0.
+*/
+ssize_t ssplit_views(sview s, size_t seplen, const char* sep, sview* out, size_t cap) {
+    if (!s.ptr || !sep || (!out && cap))
+        return -1;
+    if (seplen > s.len || seplen == 0)
+        return -1;
+    spattern sp;
+    spinit(&sp, seplen, sep);
+    size_t elem = 0;
+    size_t start = 0;
+    ssize_t idx;
+    while ((idx = spsearch(&sp, s.ptr + start, s.len - start)) != -1) {
+        if (elem < cap) {
+            out[elem].ptr = s.ptr + start;
+            out[elem].len = idx;
+        }
+        elem++;
+        start += idx + seplen;
+    }
+    if (elem < cap) {
+        out[elem].ptr = s.ptr + start;
+        out[elem].len = s.len - start;
+    }
+    return elem + 1;
+}
+
+/*
+    Split a view by sep into an array of n views allocated in the arena.
+
+    Return NULL if a, s.ptr, sep or n is NULL.
+    Return NULL if seplen > len(s) or seplen is 0.
+    Return NULL if the allocation fails.
+*/
+sview* sasplit_views(sarena* a, sview s, size_t seplen, const char* sep, size_t* n) {
+    if (!a || !n)
+        return NULL;
+    ssize_t count = ssplit_views(s, seplen, sep, NULL, 0);
+    if (count == -1)
+        return NULL;
+    if ((size_t)count > SIZE_MAX / sizeof(sview))
+        return NULL;
+    sview* arr = saalloc(a, count * sizeof(sview));
+    if (!arr)
+        return NULL;
+    *n = ssplit_views(s, seplen, sep, arr, count);
+    return arr;
+}
+
+/*
+    Find the first 'pattern' in a view. Same contract as sfind().
+*/
+ssize_t sfind_view(sview s, size_t plen, const char* pattern) {
+    if (s.ptr == NULL || pattern == NULL)
+        return -1;
+    if (plen > s.len || plen == 0)
+        return -1;
+    spattern sp;
+    spinit(&sp, plen, pattern);
+    return spsearch(&sp, s.ptr, s.len);
+}
+
+/*
+    Find the last 'pattern' in a view. Same contract as srfind().
+*/
+ssize_t srfind_view(sview s, size_t plen, const char* pattern) {
+    if (s.ptr == NULL || pattern == NULL)
+        return -1;
+    if (plen > s.len || plen == 0)
+        return -1;
+    return kernels->rfind(s.ptr, s.len, pattern, plen);
+}
+
+/*
+    Count 'pattern' in a view. Same contract as scount().
+*/
+ssize_t scount_view(sview s, size_t plen, const char* pattern) {
+    if (s.ptr == NULL || pattern == NULL)
+        return -1;
+    if (plen > s.len || plen == 0)
+        return -1;
+    return kernels->count(s.ptr, s.len, pattern, plen);
+}
+
+/*
+    Find the first match of a compiled pattern in a view. Same contract as sfindp().
+*/
+ssize_t sfindp_view(sview s, const spattern* sp) {
+    if (s.ptr == NULL || sp == NULL)
+        return -1;
+    return spsearch(sp, s.ptr, s.len);
+}
+
+/*
+    Count a compiled pattern in a view. Same contract as scountp().
+*/
+ssize_t scountp_view(sview s, const spattern* sp) {
+    if (s.ptr == NULL || sp == NULL)
+        return -1;
+    if (sp->len > s.len)
+        return -1;
+    return spcount(sp, s.ptr, s.len);
+}
+
+/*
+    Check if a view starts with 'pattern'. Same contract as sstartswith().
+*/
+bool sstartswith_view(sview s, size_t plen, const char* pattern) {
+    if (s.ptr == NULL || pattern == NULL)
+        return false;
+    if (plen > s.len || plen == 0)
+        return false;
+    return memcmp(s.ptr, pattern, plen) == 0;
+}
+
+/*
+    Check if a view ends with 'pattern'. Same contract as sendswith().
+*/
+bool sendswith_view(sview s, size_t plen, const char* pattern) {
+    if (s.ptr == NULL || pattern == NULL)
+        return false;
+    if (plen > s.len || plen == 0)
+        return false;
+    return memcmp(s.ptr + s.len - plen, pattern, plen) == 0;
+}
+
+/*
+    Contiguous string array.
+
+    All elements live back to back in one byte blob, each followed by
+    a terminating zero, and an offsets array holds where every element
+    starts. Element i spans [offsets[i], offsets[i + 1] - 1).
+*/
+struct sarray {
+    char* data;
+    size_t* offsets;
+    size_t n;
+    size_t cap_items;
+    size_t cap_bytes;
+};
+
+static
+bool sarrgrow(sarray* a, size_t items, size_t bytes) {
+    if (a->n + items + 1 > a->cap_items) {
+        size_t cap = a->cap_items * 2;
+        if (cap < a->n + items + 1)
+            cap = a->n + items + 1;
+        if (cap > SIZE_MAX / sizeof(size_t))
+            return false;
+        size_t* offsets = realloc(a->offsets, cap * sizeof(size_t));
+        if (!offsets)
+            return false;
+        a->offsets = offsets;
+        a->cap_items = cap;
+    }
+    size_t used = a->offsets[a->n];
+    if (used + bytes < used)
+        return false;
+    if (used + bytes > a->cap_bytes) {
+        size_t cap = a->cap_bytes * 2;
+        if (cap < used + bytes)
+            cap = used + bytes;
+        char* data = realloc(a->data, cap);
+        if (!data)
+            return false;
+        a->data = data;
+        a->cap_bytes = cap;
+    }
+    return true;
+}
+
+/*
+    Create an empty string array.
+
+    nitems and nbytes are capacity hints for the amount of elements and
+    their total length; 0 is fine for both.
+    Return NULL if malloc fails.
+*/
+sarray* sarrnew(size_t nitems, size_t nbytes) {
+    sarray* a = calloc(1, sizeof(sarray));
+    if (!a)
+        return NULL;
+    a->offsets = malloc(sizeof(size_t));
+    if (!a->offsets) {
+        free(a);
+        return NULL;
+    }
+    a->offsets[0] = 0;
+    a->cap_items = 1;
+    /* Every element also takes a terminator in the blob */
+    if (nbytes + nitems < nbytes || !sarrgrow(a, nitems, nbytes + nitems)) {
+        sarrfree(a);
+        return NULL;
+    }
+    return a;
+}
+
+/*
+    Free a string array and all its elements.
+
+    If input is NULL, do nothing.
+*/
+void sarrfree(sarray* a) {
+    if (!a) return;
+    free(a->data);
+    free(a->offsets);
+    free(a);
+}
+
+/*
+    Append len bytes as a new element.
+
+    Return false if a is NULL, or ptr is NULL and len > 0.
+    Return false if an allocation fails; a is unchanged in that case.
+*/
+bool sarrpush(sarray* a, const char* ptr, size_t len) {
+    if (!a || (!ptr && len))
+        return false;
+    if (len + 1 == 0 || !sarrgrow(a, 1, len + 1))
+        return false;
+    size_t off = a->offsets[a->n];
+    if (len)
+        memcpy(a->data + off, ptr, len);
+    a->data[off + len] = 0;
+    a->offsets[++a->n] = off + len + 1;
+    return true;
+}
+
+/*
+    Get the amount of elements.
+
+    If input is NULL, return 0.
+*/
+size_t sarrlen(const sarray* a) {
+    if (!a) return 0;
+    return a->n;
+}
+
+/*
+    Get element i as a view. The bytes are followed by a zero,
+    so ptr can also be used as a C string.
+
+    Return an empty view with a NULL ptr if a is NULL or i is out of range.
+*/
+sview sarrget(const sarray* a, size_t i) {
+    sview v = {NULL, 0};
+    if (!a || i >= a->n)
+        return v;
+    v.ptr = a->data + a->offsets[i];
+    v.len = a->offsets[i + 1] - a->offsets[i] - 1;
+    return v;
+}
+
+/*
+    Iterate over the elements.
+
+    Start with *i = 0; every call stores element *i in *out,
+    advances *i and returns true until the array is exhausted.
+
+    Example:
+        size_t i = 0;
+        sview v;
+        while (sarrnext(a, &i, &v))
+            use(v);
+*/
+bool sarrnext(const sarray* a, size_t* i, sview* out) {
+    if (!a || !i || !out || *i >= a->n)
+        return false;
+    *out = sarrget(a, *i);
+    (*i)++;
+    return true;
+}
+
+/*
+    Split s at every match of sep into a new string array.
+
+    The pieces are counted first, so the blob and the offsets are
+    allocated exactly once.
+    Return NULL if s or sep is NULL.
+    Return NULL if len(sep) > len(s).
+    Return NULL if any allocation fails.
+*/
+static
+sarray* ssplit_array_in(const string s, const spattern* sep) {
+    size_t slen = sgetlen(s);
+    if (sep->len > slen)
+        return NULL;
+    size_t count = spcount_disjoint(sep, s, slen);
+    /* Every separator is replaced by one terminator, plus the final one */
+    sarray* a = sarrnew(count + 1, slen - count * sep->len);
+    if (!a)
+        return NULL;
+    size_t start = 0;
+    ssize_t idx;
+    while ((idx = spsearch(sep, s + start, slen - start)) != -1) {
+        sarrpush(a, s + start, idx);
+        start += idx + sep->len;
+    }
+    sarrpush(a, s + start, slen - start);
+    return a;
+}
+
+/*
+    Split a string using the given separator into a string array.
+
+    Return NULL if s or sep is NULL.
+    Return NULL if seplen > len(s) or seplen is 0.
+    Return NULL if any allocation fails.
+*/
+sarray* ssplit_array(const string s, size_t seplen, const char* sep) {
+    if (!s || !sep)
+        return NULL;
+    if (seplen > sgetlen(s) || seplen == 0)
+        return NULL;
+    spattern sp;
+    spinit(&sp, seplen, sep);
+    return ssplit_array_in(s, &sp);
+}
+
+/*
+    Join the elements of a string array with separators of length seplen.
+
+    Return NULL if a or sep is NULL.
+    Return NULL if a is empty.
+    Return NULL if the result causes size_t overflow.
+    Return NULL if malloc fails.
+*/
+string sjoin_array(const sarray* a, size_t seplen, const char* sep) {
+    if (!a || !sep || a->n == 0)
+        return NULL;
+    /* The blob holds one terminator per element, which stand in for separators */
+    size_t bytes = a->offsets[a->n] - a->n;
+    if (seplen && a->n - 1 > (SIZE_MAX - bytes) / seplen)
+        return NULL;
+    size_t slen = bytes + (a->n - 1) * seplen;
+    string s = snewlen(NULL, slen);
+    if (!s)
+        return NULL;
+    char* p = s;
+    for (size_t i = 0; i < a->n; i++) {
+        size_t len = a->offsets[i + 1] - a->offsets[i] - 1;
+        memcpy(p, a->data + a->offsets[i], len);
+        p += len;
+        if (i < a->n - 1) {
+            memcpy(p, sep, seplen);
+            p += seplen;
+        }
+    }
+    s[slen] = 0;
+    return s;
+}
+
+/*
+    Hashing.
+
+    The hash is wyhash (final version 4, public domain by Wang Yi),
+    with a fixed seed. It reads the bytes in native byte order, so values
+    differ between little and big endian machines and should not be stored.
+*/
+static const uint64_t wysecret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+static inline
+void wymum(uint64_t* a, uint64_t* b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    u128 r = (u128)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl, lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline
+uint64_t wymix(uint64_t a, uint64_t b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline
+uint64_t wyr8(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline
+uint64_t wyr4(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline
+uint64_t wyr3(const uint8_t* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static
+uint64_t wyhash(const void* key, size_t len) {
+    const uint8_t* p = key;
+    const uint64_t* secret = wysecret;
+    uint64_t seed = wymix(secret[0], secret[1]);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ secret[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ secret[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ secret[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ secret[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+/*
+    Hash the bytes of a view.
+
+    Equal bytes give equal hashes, whether they come from a view
+    or a string. If v.ptr is NULL, return 0.
+*/
+uint64_t shash_view(sview v) {
+    if (v.ptr == NULL) return 0;
+    return wyhash(v.ptr, v.len);
+}
+
+/*
+    Hash a string.
+
+    Strings with a hash slot, see shashed(), cache the result and
+    reuse it until the string is changed by a function of this library.
+    The slot is atomic, so shared strings may be hashed from many
+    threads at once. Other strings are hashed on every call.
+    If the bytes are changed by hand, call supdatelen() afterwards,
+    which also drops the cached hash.
+
+    If input is NULL, return 0.
+*/
+uint64_t shash(const string s) {
+    if (s == NULL) return 0;
+    atomic_uint_least64_t* slot = shashslot(s);
+    if (slot) {
+        uint64_t h = atomic_load_explicit(slot, memory_order_relaxed);
+        if (h)
+            return h;
+    }
+    uint64_t h = wyhash(s, sgetlen(s));
+    /* 0 marks an empty slot, such a hash is just not cached */
+    if (slot)
+        atomic_store_explicit(slot, h, memory_order_relaxed);
+    return h;
+}
+
+/*
+    Give s a slot in front of its header that caches its hash.
+
+    Strings are created without one, so only those that are hashed
+    over and over, like keys, pay the 8 bytes. Interned strings and
+    file mappings always have a slot. The slot stays with the string
+    when it grows, shrinks or gets shared.
+
+    Return NULL if s is NULL.
+    Return NULL if malloc fails; s is left untouched in that case.
+    Return the string, which may have moved.
+*/
+string shashed(string s) {
+    if (s == NULL) return NULL;
+    if (shashslot(s) != NULL) return s;
+    return smove(s, sgetalloc(s), H_HASHED | (getFlags(s[-1]) & H_REFCOUNT));
+}
+
+/*
+    Check if two strings hold the same bytes.
+
+    Strings of different length, or with different cached hashes,
+    are rejected without looking at the bytes.
+    Return false if a or b is NULL.
+*/
+bool sequal(const string a, const string b) {
+    if (a == NULL || b == NULL)
+        return false;
+    if (a == b)
+        return true;
+    size_t len = sgetlen(a);
+    if (len != sgetlen(b))
+        return false;
+    atomic_uint_least64_t* sa = shashslot(a);
+    atomic_uint_least64_t* sb = shashslot(b);
+    if (sa && sb) {
+        uint64_t ha = atomic_load_explicit(sa, memory_order_relaxed);
+        uint64_t hb = atomic_load_explicit(sb, memory_order_relaxed);
+        if (ha && hb && ha != hb)
+            return false;
+    }
+    return memcmp(a, b, len) == 0;
+}
+
+/*
+    String interning.
+
+    The set is an open-addressing table of string pointers with linear
+    probing. Lookups are lock-free: they load the current table and
+    probe it with acquire loads. Inserts take the lock of the shard the
+    hash falls into, probe again and claim an empty slot with a CAS,
+    so two shards never fight over the same key. Growing takes the
+    resize lock exclusively, rehashes into a new table and publishes it;
+    old tables stay allocated until sifree() because lookups may still
+    be reading them.
+
+    Canonical strings live in the arena of their shard and carry their
+    hash in the header, so they are never freed one by one.
+*/
+#define SINTERN_SHARDS 16
+#define SINTERN_MIN_CAP 64
+
+typedef struct sitable {
+    struct sitable* retired;
+    size_t cap;
+    _Atomic(string) slots[];
+} sitable;
+
+typedef struct sishard {
+    pthread_mutex_t lock;
+    sarena* arena;
+} sishard;
+
+struct sintab {
+    _Atomic(sitable*) table;
+    atomic_size_t count;
+    pthread_rwlock_t resize;
+    sishard shards[SINTERN_SHARDS];
+};
+
+static
+sitable* sitable_new(size_t cap) {
+    if (cap > (SIZE_MAX - sizeof(sitable)) / sizeof(_Atomic(string)))
+        return NULL;
+    sitable* t = malloc(sizeof(sitable) + cap * sizeof(_Atomic(string)));
+    if (t == NULL)
+        return NULL;
+    t->retired = NULL;
+    t->cap = cap;
+    for (size_t i = 0; i < cap; i++)
+        atomic_init(&t->slots[i], NULL);
+    return t;
+}
+
+/* Probe t for the bytes of v. Return NULL if they are not there */
+static
+string sitable_find(sitable* t, sview v, uint64_t h, size_t* empty) {
+    size_t mask = t->cap - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        string s = atomic_load_explicit(&t->slots[i], memory_order_acquire);
+        if (s == NULL) {
+            if (empty)
+                *empty = i;
+            return NULL;
+        }
+        if (atomic_load_explicit(shashslot(s), memory_order_relaxed) == h && sgetlen(s) == v.len && memcmp(s, v.ptr, v.len) == 0)
+            return s;
+    }
+}
+
+/* Rehash everything into a table twice as big. Needs the resize lock */
+static
+bool sintab_grow(sintab* it) {
+    sitable* old = atomic_load_explicit(&it->table, memory_order_relaxed);
+    if (atomic_load(&it->count) * 2 < old->cap)
+        return true;
+    if (old->cap > SIZE_MAX / 2)
+        return false;
+    sitable* t = sitable_new(old->cap * 2);
+    if (t == NULL)
+        return false;
+    size_t mask = t->cap - 1;
+    for (size_t i = 0; i < old->cap; i++) {
+        string s = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+        if (s == NULL)
+            continue;
+        size_t j = atomic_load_explicit(shashslot(s), memory_order_relaxed) & mask;
+        while (atomic_load_explicit(&t->slots[j], memory_order_relaxed) != NULL)
+            j = (j + 1) & mask;
+        atomic_store_explicit(&t->slots[j], s, memory_order_relaxed);
+    }
+    t->retired = old;
+    atomic_store_explicit(&it->table, t, memory_order_release);
+    return true;
+}
+
+/*
+    Create an interning table.
+
+    hint is the expected amount of distinct strings; 0 is fine.
+    All functions on the table may be called from many threads at once,
+    except sifree().
+    Return NULL if malloc fails.
+*/
+sintab* sicreate(size_t hint) {
+    size_t cap = SINTERN_MIN_CAP;
+    while (cap / 2 < hint && cap <= SIZE_MAX / 4)
+        cap *= 2;
+    sintab* it = malloc(sizeof(sintab));
+    if (it == NULL)
+        return NULL;
+    sitable* t = sitable_new(cap);
+    if (t == NULL) {
+        free(it);
+        return NULL;
+    }
+    size_t i = 0;
+    for (; i < SINTERN_SHARDS; i++) {
+        it->shards[i].arena = sacreate(0);
+        if (it->shards[i].arena == NULL)
+            break;
+        pthread_mutex_init(&it->shards[i].lock, NULL);
+    }
+    if (i < SINTERN_SHARDS) {
+        while (i-- > 0) {
+            safree(it->shards[i].arena);
+            pthread_mutex_destroy(&it->shards[i].lock);
+        }
+        free(t);
+        free(it);
+        return NULL;
+    }
+    atomic_init(&it->table, t);
+    atomic_init(&it->count, 0);
+    pthread_rwlock_init(&it->resize, NULL);
+    return it;
+}
+
+/*
+    Free the table and every canonical string in it.
+
+    If input is NULL, do nothing.
+*/
+void sifree(sintab* it) {
+    if (it == NULL) return;
+    sitable* t = atomic_load(&it->table);
+    while (t != NULL) {
+        sitable* next = t->retired;
+        free(t);
+        t = next;
+    }
+    for (size_t i = 0; i < SINTERN_SHARDS; i++) {
+        safree(it->shards[i].arena);
+        pthread_mutex_destroy(&it->shards[i].lock);
+    }
+    pthread_rwlock_destroy(&it->resize);
+    free(it);
+}
+
+/*
+    Get the amount of distinct strings in the table.
+
+    If input is NULL, return 0.
+*/
+size_t sicount(sintab* it) {
+    if (it == NULL) return 0;
+    return atomic_load(&it->count);
+}
+
+/*
+    Get the canonical string for the bytes of a view.
+
+    The first call for some bytes copies them into the table, later
+    calls return the same pointer, so interned strings can be compared
+    by address. Canonical strings belong to the table: they stay valid
+    until sifree() and must not be changed or freed. sfree() on them
+    does nothing.
+
+    Return NULL if it or v.ptr is NULL.
+    Return NULL if an allocation fails.
+*/
+string sintern_view(sintab* it, sview v) {
+    if (it == NULL || v.ptr == NULL)
+        return NULL;
+    uint64_t h = shash_view(v);
+    string s = sitable_find(atomic_load_explicit(&it->table, memory_order_acquire), v, h, NULL);
+    if (s != NULL)
+        return s;
+
+    sishard* shard = &it->shards[h >> 60];
+    for (;;) {
+        pthread_rwlock_rdlock(&it->resize);
+        pthread_mutex_lock(&shard->lock);
+        sitable* t = atomic_load_explicit(&it->table, memory_order_acquire);
+        if (atomic_load(&it->count) * 2 < t->cap) {
+            size_t i;
+            s = sitable_find(t, v, h, &i);
+            if (s == NULL && (s = snewlen_in(shard->arena, v.ptr, v.len, H_HASHED)) != NULL) {
+                atomic_store_explicit(shashslot(s), h, memory_order_relaxed);
+                /*
+                    Only this shard inserts these bytes, but other shards may
+                    have claimed slot i meanwhile; take the next free one then.
+                */
+                string expected = NULL;
+                while (!atomic_compare_exchange_strong_explicit(&t->slots[i], &expected, s,
+                                                                memory_order_release,
+                                                                memory_order_relaxed)) {
+                    i = (i + 1) & (t->cap - 1);
+                    expected = NULL;
+                }
+                atomic_fetch_add(&it->count, 1);
+            }
+            pthread_mutex_unlock(&shard->lock);
+            pthread_rwlock_unlock(&it->resize);
+            return s;
+        }
+        pthread_mutex_unlock(&shard->lock);
+        pthread_rwlock_unlock(&it->resize);
+
+        pthread_rwlock_wrlock(&it->resize);
+        bool grown = sintab_grow(it);
+        pthread_rwlock_unlock(&it->resize);
+        if (!grown)
+            return NULL;
+    }
+}
+
+/*
+    Get the canonical string with the same bytes as s.
+
+    See sintern_view().
+    Return NULL if it or s is NULL.
+*/
+string sintern(sintab* it, const string s) {
+    if (it == NULL || s == NULL)
+        return NULL;
+    return sintern_view(it, sview_of(s));
+}
+
+/*
+    Parallel search.
+
+    The haystack is cut into SPAR_CHUNK sized ranges of start positions;
+    each range is searched in a window that reaches plen - 1 bytes into
+    the next one, so every match belongs to exactly one chunk. The calling
+    thread and a small pool of workers pull chunk numbers from a shared
+    counter in increasing order. Only one search uses the pool at a time,
+    a second caller searches on its own thread instead.
+*/
+#define SPAR_MIN_LEN (4u << 20)
+#define SPAR_CHUNK (1u << 20)
+#define SPAR_MAX_THREADS 8
+
+typedef struct spjob {
+    void (*run)(struct spjob* job, size_t start, size_t end);
+    const char* s;
+    size_t n;
+    const spattern* sp;
+    size_t end;             /* chunks cover [0, end) */
+    size_t nchunks;
+    atomic_size_t next;
+    atomic_size_t best;
+    atomic_size_t count;
+} spjob;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    pthread_mutex_t busy;
+    spjob* job;
+    unsigned long gen;
+    size_t active;
+    size_t nworkers;
+} spool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0
+};
+
+static pthread_once_t spool_once = PTHREAD_ONCE_INIT;
+
+static
+void spjob_work(spjob* job) {
+    size_t c;
+    while ((c = atomic_fetch_add(&job->next, 1)) < job->nchunks) {
+        size_t start = c * SPAR_CHUNK;
+        size_t end = start + SPAR_CHUNK < job->end ? start + SPAR_CHUNK : job->end;
+        job->run(job, start, end);
+    }
+}
+
+static
+void* spool_worker(void* arg) {
+    unsigned long seen = 0;
+    (void)arg;
+    pthread_mutex_lock(&spool.lock);
+    for (;;) {
+        while (spool.gen == seen || spool.job == NULL)
+            pthread_cond_wait(&spool.wake, &spool.lock);
+        seen = spool.gen;
+        spjob* job = spool.job;
+        spool.active++;
+        pthread_mutex_unlock(&spool.lock);
+        spjob_work(job);
+        pthread_mutex_lock(&spool.lock);
+        if (--spool.active == 0)
+            pthread_cond_signal(&spool.idle);
+    }
+    return NULL;
+}
+
+static
+void spool_init(void) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > SPAR_MAX_THREADS)
+        ncpu = SPAR_MAX_THREADS;
+    for (long i = 1; i < ncpu; i++) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, spool_worker, NULL) != 0)
+            break;
+        pthread_detach(t);
+        spool.nworkers++;
+    }
+}
+
+static
+size_t spool_workers(void) {
+    pthread_once(&spool_once, spool_init);
+    return spool.nworkers;
+}
+
+/* Run job on the pool and the calling thread */
+static
+void spool_run(spjob* job) {
+    if (spool_workers() == 0 || pthread_mutex_trylock(&spool.busy) != 0) {
+        spjob_work(job);
+        return;
+    }
+    pthread_mutex_lock(&spool.lock);
+    spool.job = job;
+    spool.gen++;
+    pthread_cond_broadcast(&spool.wake);
+    pthread_mutex_unlock(&spool.lock);
+
+    spjob_work(job);
+
+    /* Workers that picked the job up may still be finishing a chunk */
+    pthread_mutex_lock(&spool.lock);
+    spool.job = NULL;
+    while (spool.active > 0)
+        pthread_cond_wait(&spool.idle, &spool.lock);
+    pthread_mutex_unlock(&spool.lock);
+    pthread_mutex_unlock(&spool.busy);
+}
+
+static
+void spjob_find(spjob* job, size_t start, size_t end) {
+    /* A match in an earlier chunk is already known, this one cannot win */
+    if (start >= atomic_load_explicit(&job->best, memory_order_relaxed))
+        return;
+    ssize_t idx = spsearch(job->sp, job->s + start, end - start + job->sp->len - 1);
+    if (idx == -1)
+        return;
+    size_t pos = start + idx;
+    size_t best = atomic_load(&job->best);
+    while (pos < best && !atomic_compare_exchange_weak(&job->best, &best, pos))
+        ;
+}
+
+static
+void spjob_count(spjob* job, size_t start, size_t end) {
+    size_t n = kernels->count(job->s + start, end - start + job->sp->len - 1,
+                              job->sp->bytes, job->sp->len);
+    atomic_fetch_add_explicit(&job->count, n, memory_order_relaxed);
+}
+
+static
+void spjob_init(spjob* job, const spattern* sp, sview s) {
+    job->sp = sp;
+    job->s = s.ptr;
+    job->n = s.len;
+    job->end = s.len - sp->len + 1;
+    job->nchunks = (job->end - 1) / SPAR_CHUNK + 1;
+    atomic_init(&job->next, 0);
+    atomic_init(&job->best, SIZE_MAX);
+    atomic_init(&job->count, 0);
+}
+
+/*
+    Find the starting index of the first 'pattern' using several threads.
+
+    Same contract as sfind(). Strings shorter than a few megabytes are
+    searched on the calling thread. Chunks after the first match found
+    so far are skipped, so an early match ends the search early.
+*/
+ssize_t sfind_parallel(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return -1;
+    sview v = sview_of(s);
+    if (plen > v.len || plen == 0)
+        return -1;
+    if (v.len < SPAR_MIN_LEN)
+        return sfind_view(v, plen, pattern);
+    spattern sp;
+    spinit(&sp, plen, pattern);
+    spjob job;
+    spjob_init(&job, &sp, v);
+    job.run = spjob_find;
+    spool_run(&job);
+    size_t best = atomic_load(&job.best);
+    return best == SIZE_MAX ? -1 : (ssize_t)best;
+}
+
+/*
+    Count the amount of 'pattern' in a string using several threads.
+
+    Same contract as scount(), so overlapping matches are counted too.
+    Each match is counted by the chunk it starts in. Strings shorter
+    than a few megabytes are searched on the calling thread.
+*/
+ssize_t scount_parallel(string s, size_t plen, const char* pattern) {
+    if (s == NULL || pattern == NULL)
+        return -1;
+    sview v = sview_of(s);
+    if (plen > v.len || plen == 0)
+        return -1;
+    if (v.len < SPAR_MIN_LEN)
+        return scount_view(v, plen, pattern);
+    spattern sp;
+    spinit(&sp, plen, pattern);
+    spjob job;
+    spjob_init(&job, &sp, v);
+    job.run = spjob_count;
+    spool_run(&job);
+    return atomic_load(&job.count);
+}
+
+/*
+    A join job copies output bytes [start, end) of every chunk. pos[i] is
+    where part i starts in the output; it is followed by the separator,
+    so the part holding a chunk's first byte is found by binary search.
+*/
+typedef struct sjoinjob {
+    spjob job;
+    char* out;
+    const sview* parts;
+    const size_t* pos;
+    size_t n;
+    const char* sep;
+    size_t seplen;
+} sjoinjob;
+
+static
+void sjoinjob_copy(spjob* job, size_t start, size_t end) {
+    sjoinjob* j = (sjoinjob*)job;
+    size_t lo = 0, hi = j->n;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (j->pos[mid] <= start)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    size_t at = start;
+    for (size_t i = lo; at < end; i++) {
+        size_t off = at - j->pos[i];
+        size_t len = j->parts[i].len;
+        if (off < len) {
+            size_t k = len - off < end - at ? len - off : end - at;
+            memcpy(j->out + at, j->parts[i].ptr + off, k);
+            at += k;
+            off += k;
+        }
+        if (at < end && j->seplen) {
+            size_t k = j->seplen - (off - len);
+            if (k > end - at)
+                k = end - at;
+            memcpy(j->out + at, j->sep + (off - len), k);
+            at += k;
+        }
+    }
+}
+
+/* Copy the joined parts with the pool; return false if malloc fails */
+static
+bool sjoinv_parallel(char* out, size_t total, size_t n, const sview parts[n],
+                     size_t seplen, const char* sep) {
+    size_t* pos = malloc((n + 1) * sizeof(size_t));
+    if (pos == NULL)
+        return false;
+    pos[0] = 0;
+    for (size_t i = 0; i < n; i++)
+        pos[i + 1] = pos[i] + parts[i].len + seplen;
+    sjoinjob j = {.out = out, .parts = parts, .pos = pos, .n = n, .sep = sep, .seplen = seplen};
+    j.job.run = sjoinjob_copy;
+    j.job.end = total;
+    j.job.nchunks = (total + SPAR_CHUNK - 1) / SPAR_CHUNK;
+    atomic_init(&j.job.next, 0);
+    atomic_init(&j.job.best, SIZE_MAX);
+    atomic_init(&j.job.count, 0);
+    spool_run(&j.job);
+    free(pos);
+    return true;
+}
+
+/*
+    Join n views with separators of length seplen, appending them to dst.
+
+    If dst is NULL, a new string is created instead. Lengths are taken
+    from the views, so parts may hold any bytes and are read only once.
+    The result is sized in one pass and dst grows at most once. Joins of
+    several megabytes are copied by the thread pool of sfind_parallel().
+
+    Return NULL if parts is NULL and n > 0.
+    Return NULL if a part is NULL and not empty.
+    Return NULL if sep is NULL and seplen > 0.
+    Return NULL if the length causes overflow.
+    Return NULL if malloc/realloc fails.
+    dst is freed whenever NULL is returned.
+    Return dst, or an empty string if dst is NULL, if n is 0.
+
+    Example:
+        sview cols[] = {{"id", 2}, {"name", 4}};
+        s = sjoinv(s, 2, cols, 1, ",");
+*/
+string sjoinv(string dst, size_t n, const sview parts[n], size_t seplen, const char* sep) {
+    if ((parts == NULL && n) || (sep == NULL && seplen)) {
+        sfree(dst);
+        return NULL;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((parts[i].ptr == NULL && parts[i].len) || total + parts[i].len < total) {
+            sfree(dst);
+            return NULL;
+        }
+        total += parts[i].len;
+    }
+    if (n > 1 && seplen) {
+        if (n - 1 > (SIZE_MAX - total) / seplen) {
+            sfree(dst);
+            return NULL;
+        }
+        total += (n - 1) * seplen;
+    }
+
+    size_t len = 0;
+    string s;
+    if (dst == NULL) {
+        s = snewlen(NULL, total);
+    } else {
+        len = sgetlen(dst);
+        s = smakeroom(dst, total);
+        if (s == NULL)
+            sfree(dst);
+    }
+    if (s == NULL)
+        return NULL;
+
+    char* p = s + len;
+    if (total < SPAR_MIN_LEN || n < 2 || spool_workers() == 0 ||
+        !sjoinv_parallel(p, total, n, parts, seplen, sep)) {
+        for (size_t i = 0; i < n; i++) {
+            if (parts[i].len) {
+                memcpy(p, parts[i].ptr, parts[i].len);
+                p += parts[i].len;
+            }
+            if (i < n - 1 && seplen) {
+                memcpy(p, sep, seplen);
+                p += seplen;
+            }
+        }
+    }
+    ssetlen(s, len + total);
+    s[len + total] = 0;
+    return s;
+}
+
+/*
+    Memory-mapped files.
+
+    The mapping reserves one anonymous page in front of the file and
+    enough anonymous pages behind it for the terminating zero. The header
+    and the hash slot sit at the end of the first page, the file is mapped
+    read-only right after it, so the string looks like any other one.
+*/
+static
+size_t smapsize(size_t len, size_t page) {
+    return page + (len / page + 1) * page;
+}
+
+static
+void sunmap(const string s) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    /* The capacity of a mapping never changes, unlike its length */
+    munmap(s - page, smapsize(sgetalloc(s), page));
+}
+
+/*
+    Give the kernel a hint about how a mapped string will be read.
+
+    hints is a combination of SMAP_SEQUENTIAL, SMAP_RANDOM and
+    SMAP_WILLNEED; 0 restores the default behaviour.
+    Return false if s is NULL or not mapped from a file.
+    Return false if madvise fails.
+*/
+bool smadvise(const string s, int hints) {
+    if (s == NULL || !(getFlags(s[-1]) & H_MAPPED))
+        return false;
+    size_t len = sgetlen(s);
+    if (len == 0)
+        return true;
+    bool ok = true;
+    if (hints == 0)
+        ok = madvise(s, len, MADV_NORMAL) == 0;
+    if (hints & SMAP_SEQUENTIAL)
+        ok = madvise(s, len, MADV_SEQUENTIAL) == 0 && ok;
+    if (hints & SMAP_RANDOM)
+        ok = madvise(s, len, MADV_RANDOM) == 0 && ok;
+    if (hints & SMAP_WILLNEED)
+        ok = madvise(s, len, MADV_WILLNEED) == 0 && ok;
+    return ok;
+}
+
+/*
+    Map a file into a read-only string without copying it.
+
+    The string can be searched, split and viewed like any other one.
+    Functions that change strings in place fail on it, and functions
+    that return a new string copy it to the heap and unmap it.
+    sfree() unmaps it. hints are passed to smadvise(); 0 is fine.
+    Changes to the file while it is mapped may show up in the string.
+
+    Return NULL if path is NULL.
+    Return NULL if the file cannot be opened, is not a regular file
+    or cannot be mapped.
+*/
+string smapfile(const char* path, int hints) {
+    if (path == NULL)
+        return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uintmax_t)st.st_size >= SIZE_MAX / 2) {
+        close(fd);
+        return NULL;
+    }
+    size_t len = st.st_size;
+    size_t page = sysconf(_SC_PAGESIZE);
+    uint8_t type = getReqType(len);
+
+    char* base = mmap(NULL, smapsize(len, page), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    string s = base + page;
+    if (len > 0 && mmap(s, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, smapsize(len, page));
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    /* The zero after the file bytes comes from the page tail or the anonymous pages */
+    s[-1] = (char)(type | H_HASHED | H_MAPPED);
+    atomic_init(shashslot(s), 0);
+    ssetlen(s, len);
+    ssetalloc(s, len);
+    if (hints)
+        smadvise(s, hints);
+    return s;
+}
+
+/*
+    Streaming search.
+
+    A stream keeps the last plen - 1 bytes it was fed. When a chunk
+    arrives, matches that start in those kept bytes are searched in the
+    kept bytes followed by the first plen - 1 bytes of the chunk; all
+    other matches lie inside the chunk and are searched there directly.
+    Memory use is therefore about twice the pattern, however long the
+    stream gets.
+*/
+#define SSTREAM_READ (64 * 1024)
+
+struct sstream {
+    spattern* sp;
+    size_t offset;
+    size_t tlen;
+    char buf[];
+};
+
+/*
+    Create a stream matcher for a pattern.
+
+    Feed it with ssfeed(); it reports the offsets of all matches,
+    overlapping ones included, counted from the start of the stream.
+    Return NULL if pattern is NULL or plen is 0.
+    Return NULL if malloc fails.
+*/
+sstream* sscreate(size_t plen, const char* pattern) {
+    spattern* sp = spcompile(plen, pattern);
+    if (sp == NULL)
+        return NULL;
+    if (plen > (SIZE_MAX - sizeof(sstream)) / 2) {
+        spfree(sp);
+        return NULL;
+    }
+    sstream* ss = malloc(sizeof(sstream) + 2 * plen);
+    if (ss == NULL) {
+        spfree(sp);
+        return NULL;
+    }
+    ss->sp = sp;
+    ss->offset = 0;
+    ss->tlen = 0;
+    return ss;
+}
+
+/*
+    Free a stream matcher.
+
+    If input is NULL, do nothing.
+*/
+void ssfree(sstream* ss) {
+    if (ss == NULL) return;
+    spfree(ss->sp);
+    free(ss);
+}
+
+/*
+    Start a new stream with the same pattern.
+
+    If input is NULL, do nothing.
+*/
+void ssreset(sstream* ss) {
+    if (ss == NULL) return;
+    ss->offset = 0;
+    ss->tlen = 0;
+}
+
+/*
+    Get the amount of bytes fed so far.
+
+    If input is NULL, return 0.
+*/
+size_t sspos(const sstream* ss) {
+    if (ss == NULL) return 0;
+    return ss->offset;
+}
+
+/*
+    Feed the next n bytes of the stream.
+
+    The stream offsets of the matches that end in this chunk are
+    written to out in increasing order, at most cap of them.
+
+    Return -1 if ss is NULL, or chunk is NULL and n > 0.
+    Return -1 if out is NULL and cap > 0.
+    Return the amount of matches that end in this chunk,
+    which may be bigger than cap.
+*/
+ssize_t ssfeed(sstream* ss, const char* chunk, size_t n, size_t* out, size_t cap) {
+    if (ss == NULL || (chunk == NULL && n) || (out == NULL && cap))
+        return -1;
+    if (n == 0)
+        return 0;
+    const spattern* sp = ss->sp;
+    size_t keep = sp->len - 1;
+    size_t found = 0;
+    ssize_t idx;
+
+    if (ss->tlen > 0) {
+        size_t head = n < keep ? n : keep;
+        size_t m = ss->tlen + head;
+        size_t i = 0;
+        memcpy(ss->buf + ss->tlen, chunk, head);
+        while ((idx = spsearch(sp, ss->buf + i, m - i)) != -1 && i + idx < ss->tlen) {
+            if (found < cap)
+                out[found] = ss->offset - ss->tlen + i + idx;
+            found++;
+            i += idx + 1;
+        }
+    }
+    size_t i = 0;
+    while (i < n && (idx = spsearch(sp, chunk + i, n - i)) != -1) {
+        if (found < cap)
+            out[found] = ss->offset + i + idx;
+        found++;
+        i += idx + 1;
+    }
+
+    if (n >= keep) {
+        memcpy(ss->buf, chunk + n - keep, keep);
+        ss->tlen = keep;
+    } else {
+        size_t old = ss->tlen < keep - n ? ss->tlen : keep - n;
+        memmove(ss->buf, ss->buf + ss->tlen - old, old);
+        memcpy(ss->buf + old, chunk, n);
+        ss->tlen = old + n;
+    }
+    ss->offset += n;
+    return found;
+}
+
+/*
+    Feed a whole file to the stream, reading it in fixed-size chunks.
+
+    The offsets of the first cap matches are written to out.
+    Return -1 if ss or f is NULL, or out is NULL and cap > 0.
+    Return -1 if reading fails or malloc fails.
+    Return the amount of matches in the file.
+*/
+ssize_t ssfeed_file(sstream* ss, FILE* f, size_t* out, size_t cap) {
+    if (ss == NULL || f == NULL || (out == NULL && cap))
+        return -1;
+    char* chunk = malloc(SSTREAM_READ);
+    if (chunk == NULL)
+        return -1;
+    size_t total = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, SSTREAM_READ, f)) > 0) {
+        size_t found = ssfeed(ss, chunk, n, total < cap ? out + total : NULL,
+                              total < cap ? cap - total : 0);
+        total += found;
+    }
+    free(chunk);
+    if (ferror(f))
+        return -1;
+    return total;
+}
+
+/*
+    Feed everything that can be read from a file descriptor to the stream.
+
+    Same as ssfeed_file(), for sockets, pipes and files opened with open().
+*/
+ssize_t ssfeed_fd(sstream* ss, int fd, size_t* out, size_t cap) {
+    if (ss == NULL || fd < 0 || (out == NULL && cap))
+        return -1;
+    char* chunk = malloc(SSTREAM_READ);
+    if (chunk == NULL)
+        return -1;
+    size_t total = 0;
+    for (;;) {
+        ssize_t n = read(fd, chunk, SSTREAM_READ);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            free(chunk);
+            return n < 0 ? -1 : (ssize_t)total;
+        }
+        size_t found = ssfeed(ss, chunk, n, total < cap ? out + total : NULL,
+                              total < cap ? cap - total : 0);
+        total += found;
+    }
+}
+
+/*
+    Ropes.
+
+    A rope is a height-balanced (AVL) binary tree whose leaves hold up
+    to SROPE_LEAF bytes each. Nodes are immutable and reference counted,
+    so concatenating, slicing and inserting build O(log n) new nodes and
+    share everything else with the ropes they came from. A flat string
+    is only made when sroflatten() asks for one.
+
+    Every internal function takes ownership of the nodes it is given
+    and releases them on every path, including when malloc fails, in
+    which case NULL is returned and propagated upwards.
+*/
+#define SROPE_LEAF 4096
+
+struct srope {
+    atomic_size_t refs;
+    size_t len;
+    struct srope* left;
+    struct srope* right;
+    unsigned height;
+    char data[];
+};
+
+static
+srope* sroleaf(size_t len, const char* bytes) {
+    srope* r = malloc(sizeof(srope) + len);
+    if (r == NULL) return NULL;
+    atomic_init(&r->refs, 1);
+    r->len = len;
+    r->left = r->right = NULL;
+    r->height = 0;
+    if (len)
+        memcpy(r->data, bytes, len);
+    return r;
+}
+
+static
+srope* sroretain(srope* r) {
+    atomic_fetch_add_explicit(&r->refs, 1, memory_order_relaxed);
+    return r;
+}
+
+static
+void srorelease(srope* r) {
+    while (r != NULL && atomic_fetch_sub_explicit(&r->refs, 1, memory_order_acq_rel) == 1) {
+        srope* right = r->right;
+        srorelease(r->left);
+        free(r);
+        r = right;
+    }
+}
+
+static
+unsigned sroheight(const srope* r) {
+    return r->height;
+}
+
+static
+srope* sronode(srope* l, srope* r) {
+    if (l == NULL || r == NULL) {
+        srorelease(l);
+        srorelease(r);
+        return NULL;
+    }
+    if (l->len == 0) {
+        srorelease(l);
+        return r;
+    }
+    if (r->len == 0) {
+        srorelease(r);
+        return l;
+    }
+    srope* n = malloc(sizeof(srope));
+    if (n == NULL) {
+        srorelease(l);
+        srorelease(r);
+        return NULL;
+    }
+    atomic_init(&n->refs, 1);
+    n->len = l->len + r->len;
+    n->left = l;
+    n->right = r;
+    n->height = 1 + (l->height > r->height ? l->height : r->height);
+    return n;
+}
+
+/* Join two subtrees whose heights differ by at most two */
+static
+srope* srobalance(srope* l, srope* r) {
+    if (l == NULL || r == NULL)
+        return sronode(l, r);
+    if (sroheight(r) > sroheight(l) + 1) {
+        srope* rl = sroretain(r->left);
+        srope* rr = sroretain(r->right);
+        srorelease(r);
+        if (sroheight(rl) > sroheight(rr)) {
+            srope* a = sroretain(rl->left);
+            srope* b = sroretain(rl->right);
+            srorelease(rl);
+            return sronode(sronode(l, a), sronode(b, rr));
+        }
+        return sronode(sronode(l, rl), rr);
+    }
+    if (sroheight(l) > sroheight(r) + 1) {
+        srope* ll = sroretain(l->left);
+        srope* lr = sroretain(l->right);
+        srorelease(l);
+        if (sroheight(lr) > sroheight(ll)) {
+            srope* a = sroretain(lr->left);
+            srope* b = sroretain(lr->right);
+            srorelease(lr);
+            return sronode(sronode(ll, a), sronode(b, r));
+        }
+        return sronode(ll, sronode(lr, r));
+    }
+    return sronode(l, r);
+}
+
+/* Concatenate, descending the spine of the taller tree: O(height difference) */
+static
+srope* srojoin(srope* l, srope* r) {
+    if (l == NULL || r == NULL || l->len == 0 || r->len == 0)
+        return sronode(l, r);
+    if (l->height == 0 && r->height == 0 && l->len + r->len <= SROPE_LEAF) {
+        srope* n = malloc(sizeof(srope) + l->len + r->len);
+        if (n != NULL) {
+            atomic_init(&n->refs, 1);
+            n->len = l->len + r->len;
+            n->left = n->right = NULL;
+            n->height = 0;
+            memcpy(n->data, l->data, l->len);
+            memcpy(n->data + l->len, r->data, r->len);
+        }
+        srorelease(l);
+        srorelease(r);
+        return n;
+    }
+    if (sroheight(l) > sroheight(r) + 1) {
+        srope* a = sroretain(l->left);
+        srope* b = sroretain(l->right);
+        srorelease(l);
+        return srobalance(a, srojoin(b, r));
+    }
+    if (sroheight(r) > sroheight(l) + 1) {
+        srope* a = sroretain(r->left);
+        srope* b = sroretain(r->right);
+        srorelease(r);
+        return srobalance(srojoin(l, a), b);
+    }
+    return sronode(l, r);
+}
+
+/* Split r into [0, pos) and [pos, len); on failure both are NULL */
+static
+void srosplit(srope* r, size_t pos, srope** left, srope** right) {
+    srope* a;
+    srope* b;
+    if (pos == 0) {
+        a = sroleaf(0, NULL);
+        b = r;
+    } else if (pos >= r->len) {
+        a = r;
+        b = sroleaf(0, NULL);
+    } else if (r->height == 0) {
+        a = sroleaf(pos, r->data);
+        b = sroleaf(r->len - pos, r->data + pos);
+        srorelease(r);
+    } else {
+        srope* l = sroretain(r->left);
+        srope* rr = sroretain(r->right);
+        srorelease(r);
+        if (pos <= l->len) {
+            srosplit(l, pos, &a, &b);
+            b = srojoin(b, rr);
+        } else {
+            srosplit(rr, pos - l->len, &a, &b);
+            a = srojoin(l, a);
+        }
+    }
+    if (a == NULL || b == NULL) {
+        srorelease(a);
+        srorelease(b);
+        a = b = NULL;
+    }
+    *left = a;
+    *right = b;
+}
+
+static
+srope* srobuild(size_t len, const char* bytes) {
+    if (len <= SROPE_LEAF)
+        return sroleaf(len, bytes);
+    size_t half = (len / SROPE_LEAF + 1) / 2 * SROPE_LEAF;
+    return sronode(srobuild(half, bytes), srobuild(len - half, bytes + half));
+}
+
+/*
+    Create a rope holding a copy of len bytes.
+
+    Return NULL if bytes is NULL and len > 0.
+    Return NULL if malloc fails.
+*/
+srope* sronew(size_t len, const char* bytes) {
+    if (bytes == NULL && len) return NULL;
+    return srobuild(len, bytes);
+}
+
+/*
+    Take another reference to a rope in O(1).
+
+    Ropes are immutable: functions that "change" a rope consume it and
+    return a new one, so a duplicate keeps the old contents alive.
+    Return NULL if r is NULL.
+*/
+srope* srodup(srope* r) {
+    if (r == NULL) return NULL;
+    return sroretain(r);
+}
+
+/*
+    Free a rope.
+
+    If input is NULL, do nothing.
+*/
+void srofree(srope* r) {
+    srorelease(r);
+}
+
+/*
+    Get the length of a rope.
+
+    If input is NULL, return 0.
+*/
+size_t srolen(const srope* r) {
+    if (r == NULL) return 0;
+    return r->len;
+}
+
+/*
+    Concatenate two ropes in O(log n). Both are consumed.
+
+    Return NULL if a or b is NULL; the other one is freed.
+    Return NULL if malloc fails.
+*/
+srope* srocat(srope* a, srope* b) {
+    if (a == NULL || b == NULL) {
+        srorelease(a);
+        srorelease(b);
+        return NULL;
+    }
+    return srojoin(a, b);
+}
+
+/*
+    Insert a copy of len bytes at position pos in O(log n + len).
+    The rope is consumed.
+
+    Return NULL if r is NULL.
+    Return NULL and free r if bytes is NULL and len > 0, or pos > length.
+    Return NULL if malloc fails.
+*/
+srope* sroinsert(srope* r, size_t pos, size_t len, const char* bytes) {
+    if (r == NULL) return NULL;
+    if ((bytes == NULL && len) || pos > r->len) {
+        srorelease(r);
+        return NULL;
+    }
+    srope* a;
+    srope* b;
+    srosplit(r, pos, &a, &b);
+    if (a == NULL) return NULL;
+    return srojoin(srojoin(a, srobuild(len, bytes)), b);
+}
+
+/*
+    Create a rope that is a slice [start, end) of another in O(log n).
+    The rope is not consumed; the slice shares its nodes.
+
+    Return NULL if r is NULL.
+    Return NULL if start > end or end > length.
+    Return NULL if malloc fails.
+*/
+srope* sroslice(const srope* r, size_t start, size_t end) {
+    if (r == NULL) return NULL;
+    if (start > end || end > r->len) return NULL;
+    srope* a;
+    srope* b;
+    srosplit(sroretain((srope*)r), end, &a, &b);
+    srorelease(b);
+    if (a == NULL) return NULL;
+    srosplit(a, start, &a, &b);
+    srorelease(a);
+    return b;
+}
+
+/*
+    Remove the bytes [start, end) in O(log n). The rope is consumed.
+
+    Return NULL if r is NULL.
+    Return NULL and free r if start > end or end > length.
+    Return NULL if malloc fails.
+*/
+srope* sroerase(srope* r, size_t start, size_t end) {
+    if (r == NULL) return NULL;
+    if (start > end || end > r->len) {
+        srorelease(r);
+        return NULL;
+    }
+    srope* a;
+    srope* b;
+    srope* c;
+    srosplit(r, end, &b, &c);
+    if (b == NULL) return NULL;
+    srosplit(b, start, &a, &b);
+    srorelease(b);
+    if (a == NULL) {
+        srorelease(c);
+        return NULL;
+    }
+    return srojoin(a, c);
+}
+
+/*
+    Iterate over the chunks of a rope.
+
+    Start with *pos = 0; every call stores the bytes from *pos to the
+    end of the leaf holding it in *out, advances *pos past them and
+    returns true until the rope is exhausted. Each call is O(log n).
+
+    Example:
+        size_t pos = 0;
+        sview v;
+        while (sronext(r, &pos, &v))
+            fwrite(v.ptr, 1, v.len, f);
+*/
+bool sronext(const srope* r, size_t* pos, sview* out) {
+    if (r == NULL || pos == NULL || out == NULL) return false;
+    if (*pos >= r->len) return false;
+    size_t at = *pos;
+    while (r->height > 0) {
+        if (at < r->left->len) {
+            r = r->left;
+        } else {
+            at -= r->left->len;
+            r = r->right;
+        }
+    }
+    out->ptr = r->data + at;
+    out->len = r->len - at;
+    *pos += out->len;
+    return true;
+}
+
+/*
+    Copy the rope into a new flat string.
+
+    Return NULL if r is NULL.
+    Return NULL if malloc fails.
+*/
+string sroflatten(const srope* r) {
+    if (r == NULL) return NULL;
+    string s = snewlen(NULL, r->len);
+    if (s == NULL) return NULL;
+    size_t pos = 0;
+    sview v;
+    char* p = s;
+    while (sronext(r, &pos, &v)) {
+        memcpy(p, v.ptr, v.len);
+        p += v.len;
+    }
+    return s;
+}
+
+static
+ssize_t srosearch(const srope* r, size_t plen, const char* pattern, bool all) {
+    if (r == NULL) return -1;
+    sstream* ss = sscreate(plen, pattern);
+    if (ss == NULL) return -1;
+    size_t pos = 0;
+    size_t first;
+    ssize_t total = 0;
+    sview v;
+    while (sronext(r, &pos, &v)) {
+        ssize_t n = ssfeed(ss, v.ptr, v.len, &first, all ? 0 : 1);
+        if (n > 0 && !all) {
+            ssfree(ss);
+            return first;
         }
-        free(table);
+        total += n;
     }
-    return -1;
+    ssfree(ss);
+    return all ? total : -1;
 }
 
 /*
-    Find the starting index of the first substring matching the 'pattern'.
-
-    Return -1 if s or pattern is NULL.
-    Return -1 if plen > len(s).
-    Return -1 if plen == 0.
-    Return -1 if pattern is not found.
+    Find the first occurrence of a pattern in a rope,
+    searching it chunk by chunk without flattening it.
 
-    Behaviour is undefined if plen != len(pattern).
+    Return -1 if r or pattern is NULL, plen is 0, or malloc fails.
+    Return -1 if the pattern is not found.
+    Return the index of the first match.
 */
-ssize_t sfind(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return -1;
-    size_t n = sgetlen(s);
-    if (plen > n || plen == 0)
-        return -1;
-    if (plen == 1) {
-        for (size_t idx = 0; idx <= n - plen; idx++) {
-            if (s[idx] == pattern[0])
-                return idx;
-        }
-    } else {
-        for (size_t idx = 0; idx <= n - plen; idx++) {
-            if (s[idx] == pattern[0] && memcmp(s + idx, pattern, plen) == 0)
-                return idx;
-        }
-    } 
-    return -1;
+ssize_t srofind(const srope* r, size_t plen, const char* pattern) {
+    return srosearch(r, plen, pattern, false);
 }
 
 /*
-    Find the starting index of the last (right) substring matching the 'pattern'.
+    Count the occurrences of a pattern in a rope, overlapping ones included,
+    searching it chunk by chunk without flattening it.
 
-    Return -1 if s or pattern is NULL.
-    Return -1 if plen > len(s).
-    Return -1 if plen == 0.
+    Return -1 if r or pattern is NULL, plen is 0, or malloc fails.
+    Return the amount of matches.
+*/
+ssize_t srocount(const srope* r, size_t plen, const char* pattern) {
+    return srosearch(r, plen, pattern, true);
+}
 
-    Behaviour is undefined if plen != len(pattern).
+/*
+    Number parsing.
+
+    The parsers accept what a CSV or log field usually holds and stop
+    at the end of the view: no leading whitespace, no base prefixes,
+    and '.' as the decimal point whatever the locale. Runs of eight
+    digits are converted at once with SWAR arithmetic on a 64-bit word.
+    Doubles with at most 19 significant digits are rounded exactly by
+    Clinger's fast path or the Eisel-Lemire algorithm; the rare inputs
+    those cannot decide go through strtod().
 */
-ssize_t srfind(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return -1;
-    if (plen > sgetlen(s) || plen == 0)
-        return -1;
-    for (ssize_t idx = sgetlen(s) - plen; idx >= 0; idx--) {
-        if (s[idx] == pattern[0] && memcmp(s + idx, pattern, plen) == 0)
-            return idx;
+
+/* Load 8 bytes so that p[0] is the least significant one */
+static inline
+uint64_t sload8(const char* p) {
+    const unsigned char* b = (const unsigned char*)p;
+    return (uint64_t)b[0] | (uint64_t)b[1] << 8 | (uint64_t)b[2] << 16 | (uint64_t)b[3] << 24 |
+           (uint64_t)b[4] << 32 | (uint64_t)b[5] << 40 | (uint64_t)b[6] << 48 | (uint64_t)b[7] << 56;
+}
+
+static inline
+bool seightdigits(uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) |
+            (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+/* Combine digit pairs, then quads, then the two halves */
+static inline
+uint64_t seightvalue(uint64_t v) {
+    v = (v & 0x0F0F0F0F0F0F0F0Full) * 2561 >> 8;
+    v = (v & 0x00FF00FF00FF00FFull) * 6553601 >> 16;
+    return (v & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32;
+}
+
+/* Accumulate the digits from p[*i] into *w, wrapping on overflow */
+static
+size_t sdigits(const char* p, size_t n, size_t* i, uint64_t* w) {
+    size_t start = *i;
+    uint64_t v = *w;
+    while (n - *i >= 8) {
+        uint64_t chunk = sload8(p + *i);
+        if (!seightdigits(chunk)) break;
+        v = v * 100000000 + seightvalue(chunk);
+        *i += 8;
     }
-    return -1;
+    while (*i < n && (unsigned char)(p[*i] - '0') < 10) {
+        v = v * 10 + (p[*i] - '0');
+        (*i)++;
+    }
+    *w = v;
+    return *i - start;
+}
+
+/* Parse unsigned digits; return how many bytes were consumed */
+static
+size_t sparse_u64(const char* p, size_t n, uint64_t* out, bool* overflow) {
+    size_t i = 0;
+    while (i < n && p[i] == '0')
+        i++;
+    size_t first = i;
+    uint64_t w = 0;
+    size_t digits = sdigits(p, n, &i, &w);
+    /* A 20 digit value fits only if it starts with 1 and did not wrap */
+    *overflow = digits > 20 ||
+                (digits == 20 && (p[first] != '1' || w < 10000000000000000000ull));
+    *out = *overflow ? UINT64_MAX : w;
+    return i;
 }
 
 /*
-    Count the amount of substrings matching 'pattern'.
+    Parse an unsigned decimal integer at the start of a view.
 
-    Return -1 if s or pattern is NULL.
-    Return -1 if plen > len(s).
-    Return -1 if plen == 0.
+    An optional '+' may precede the digits.
+    If the value does not fit, *out is UINT64_MAX and *overflow is set.
+    overflow may be NULL.
 
-    Behaviour is undefined if plen != len(pattern).
+    Return 0 if v holds no number or out is NULL; *out is left untouched.
+    Return the amount of bytes consumed.
 */
-ssize_t scount(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return -1;
-    if (plen > sgetlen(s) || plen == 0)
-        return -1;
-    size_t count = 0;
-    if (plen == 1) {
-        for (size_t idx = 0; idx <= sgetlen(s) - plen; idx++) {
-            if (s[idx] == pattern[0])
-                count++;
-        }
-    } else {
-        for (size_t idx = 0; idx <= sgetlen(s) - plen; idx++) {
-            if (s[idx] == pattern[0] && memcmp(s + idx, pattern, plen) == 0)
-                count++;
-        }
-    }
-    return count;
+size_t stou64_view(sview v, uint64_t* out, bool* overflow) {
+    if (overflow) *overflow = false;
+    if (v.ptr == NULL || out == NULL) return 0;
+    size_t i = v.len > 0 && v.ptr[0] == '+';
+    uint64_t w;
+    bool ovf;
+    size_t n = sparse_u64(v.ptr + i, v.len - i, &w, &ovf);
+    if (n == 0) return 0;
+    *out = w;
+    if (overflow) *overflow = ovf;
+    return i + n;
 }
 
 /*
-    Remove the given pattern from the beginning and the end of the string.
+    Parse an unsigned decimal integer at the start of a string.
+    See stou64_view().
+*/
+size_t stou64(const string s, uint64_t* out, bool* overflow) {
+    return stou64_view(sview_of(s), out, overflow);
+}
 
-    Return false if s or pattern is NULL.
-    Return false if plen > len(s) or plen is 0.
-    Return true on success.
+/*
+    Parse a signed decimal integer at the start of a view.
 
-    Behaviour is undefined if plen != len(pattern).
+    An optional '+' or '-' may precede the digits.
+    If the value does not fit, *out is INT64_MAX or INT64_MIN
+    and *overflow is set. overflow may be NULL.
+
+    Return 0 if v holds no number or out is NULL; *out is left untouched.
+    Return the amount of bytes consumed.
 */
-bool strim(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
-        return false;
-    size_t len = sgetlen(s);
-    if (plen > len || plen == 0)
-        return false;
-    size_t newstart = 0;
-    while (newstart + plen <= len && memcmp(s + newstart, pattern, plen) == 0)
-        newstart += plen;
-    size_t rm_end = 1;
-    while (newstart < len - rm_end * plen && 
-           memcmp(s + len - rm_end * plen, pattern, plen) == 0)
-        rm_end++;
-    size_t newlen = len - newstart - (rm_end - 1) * plen;
-    if (newstart > 0)
-        memmove(s, s + newstart, newlen);
-    s[newlen] = 0;
-    ssetlen(s, newlen);
-    return true;
+size_t stoi64_view(sview v, int64_t* out, bool* overflow) {
+    if (overflow) *overflow = false;
+    if (v.ptr == NULL || out == NULL) return 0;
+    bool neg = v.len > 0 && v.ptr[0] == '-';
+    size_t i = v.len > 0 && (neg || v.ptr[0] == '+');
+    uint64_t w;
+    bool ovf;
+    size_t n = sparse_u64(v.ptr + i, v.len - i, &w, &ovf);
+    if (n == 0) return 0;
+    uint64_t limit = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    if (ovf || w > limit) {
+        ovf = true;
+        w = limit;
+    }
+    if (neg)
+        *out = w == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)w;
+    else
+        *out = w;
+    if (overflow) *overflow = ovf;
+    return i + n;
 }
 
 /*
-    Remove the given pattern from the string.
+    Parse a signed decimal integer at the start of a string.
+    See stoi64_view().
+*/
+size_t stoi64(const string s, int64_t* out, bool* overflow) {
+    return stoi64_view(sview_of(s), out, overflow);
+}
 
-    Return false if s or pattern is NULL.
-    Return false if plen > len(s) or plen is 0.
-    Return true on success.
+/* Exactly representable powers of ten for Clinger's fast path */
+static const double spow10d[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
 
-    Behaviour is undefined if plen != len(pattern).
+#define SPOW5_MIN -342
+#define SPOW5_MAX 308
+/*
+    The 128 most significant bits of 5^q for q from SPOW5_MIN to SPOW5_MAX,
+    which are also those of 10^q. Positive powers are truncated, negative
+    ones are rounded up, as the Eisel-Lemire algorithm expects.
 */
-bool sremove(string s, size_t plen, const char* pattern) {
-    if (s == NULL || pattern == NULL)
+static const uint64_t spow5[][2] = {
+    {0xeef453d6923bd65aull, 0x113faa2906a13b3full}, {0x9558b4661b6565f8ull, 0x4ac7ca59a424c507ull},
+    {0xbaaee17fa23ebf76ull, 0x5d79bcf00d2df649ull}, {0xe95a99df8ace6f53ull, 0xf4d82c2c107973dcull},
+    {0x91d8a02bb6c10594ull, 0x79071b9b8a4be869ull}, {0xb64ec836a47146f9ull, 0x9748e2826cdee284ull},
+    {0xe3e27a444d8d98b7ull, 0xfd1b1b2308169b25ull}, {0x8e6d8c6ab0787f72ull, 0xfe30f0f5e50e20f7ull},
+    {0xb208ef855c969f4full, 0xbdbd2d335e51a935ull}, {0xde8b2b66b3bc4723ull, 0xad2c788035e61382ull},
+    {0x8b16fb203055ac76ull, 0x4c3bcb5021afcc31ull}, {0xaddcb9e83c6b1793ull, 0xdf4abe242a1bbf3dull},
+    {0xd953e8624b85dd78ull, 0xd71d6dad34a2af0dull}, {0x87d4713d6f33aa6bull, 0x8672648c40e5ad68ull},
+    {0xa9c98d8ccb009506ull, 0x680efdaf511f18c2ull}, {0xd43bf0effdc0ba48ull, 0x0212bd1b2566def2ull},
+    {0x84a57695fe98746dull, 0x014bb630f7604b57ull}, {0xa5ced43b7e3e9188ull, 0x419ea3bd35385e2dull},
+    {0xcf42894a5dce35eaull, 0x52064cac828675b9ull}, {0x818995ce7aa0e1b2ull, 0x7343efebd1940993ull},
+    {0xa1ebfb4219491a1full, 0x1014ebe6c5f90bf8ull}, {0xca66fa129f9b60a6ull, 0xd41a26e077774ef6ull},
+    {0xfd00b897478238d0ull, 0x8920b098955522b4ull}, {0x9e20735e8cb16382ull, 0x55b46e5f5d5535b0ull},
+    {0xc5a890362fddbc62ull, 0xeb2189f734aa831dull}, {0xf712b443bbd52b7bull, 0xa5e9ec7501d523e4ull},
+    {0x9a6bb0aa55653b2dull, 0x47b233c92125366eull}, {0xc1069cd4eabe89f8ull, 0x999ec0bb696e840aull},
+    {0xf148440a256e2c76ull, 0xc00670ea43ca250dull}, {0x96cd2a865764dbcaull, 0x380406926a5e5728ull},
+    {0xbc807527ed3e12bcull, 0xc605083704f5ecf2ull}, {0xeba09271e88d976bull, 0xf7864a44c633682eull},
+    {0x93445b8731587ea3ull, 0x7ab3ee6afbe0211dull}, {0xb8157268fdae9e4cull, 0x5960ea05bad82964ull},
+    {0xe61acf033d1a45dfull, 0x6fb92487298e33bdull}, {0x8fd0c16206306babull, 0xa5d3b6d479f8e056ull},
+    {0xb3c4f1ba87bc8696ull, 0x8f48a4899877186cull}, {0xe0b62e2929aba83cull, 0x331acdabfe94de87ull},
+    {0x8c71dcd9ba0b4925ull, 0x9ff0c08b7f1d0b14ull}, {0xaf8e5410288e1b6full, 0x07ecf0ae5ee44dd9ull},
+    {0xdb71e91432b1a24aull, 0xc9e82cd9f69d6150ull}, {0x892731ac9faf056eull, 0xbe311c083a225cd2ull},
+    {0xab70fe17c79ac6caull, 0x6dbd630a48aaf406ull}, {0xd64d3d9db981787dull, 0x092cbbccdad5b108ull},
+    {0x85f0468293f0eb4eull, 0x25bbf56008c58ea5ull}, {0xa76c582338ed2621ull, 0xaf2af2b80af6f24eull},
+    {0xd1476e2c07286faaull, 0x1af5af660db4aee1ull}, {0x82cca4db847945caull, 0x50d98d9fc890ed4dull},
+    {0xa37fce126597973cull, 0xe50ff107bab528a0ull}, {0xcc5fc196fefd7d0cull, 0x1e53ed49a96272c8ull},
+    {0xff77b1fcbebcdc4full, 0x25e8e89c13bb0f7aull}, {0x9faacf3df73609b1ull, 0x77b191618c54e9acull},
+    {0xc795830d75038c1dull, 0xd59df5b9ef6a2417ull}, {0xf97ae3d0d2446f25ull, 0x4b0573286b44ad1dull},
+    {0x9becce62836ac577ull, 0x4ee367f9430aec32ull}, {0xc2e801fb244576d5ull, 0x229c41f793cda73full},
+    {0xf3a20279ed56d48aull, 0x6b43527578c1110full}, {0x9845418c345644d6ull, 0x830a13896b78aaa9ull},
+    {0xbe5691ef416bd60cull, 0x23cc986bc656d553ull}, {0xedec366b11c6cb8full, 0x2cbfbe86b7ec8aa8ull},
+    {0x94b3a202eb1c3f39ull, 0x7bf7d71432f3d6a9ull}, {0xb9e08a83a5e34f07ull, 0xdaf5ccd93fb0cc53ull},
+    {0xe858ad248f5c22c9ull, 0xd1b3400f8f9cff68ull}, {0x91376c36d99995beull, 0x23100809b9c21fa1ull},
+    {0xb58547448ffffb2dull, 0xabd40a0c2832a78aull}, {0xe2e69915b3fff9f9ull, 0x16c90c8f323f516cull},
+    {0x8dd01fad907ffc3bull, 0xae3da7d97f6792e3ull}, {0xb1442798f49ffb4aull, 0x99cd11cfdf41779cull},
+    {0xdd95317f31c7fa1dull, 0x40405643d711d583ull}, {0x8a7d3eef7f1cfc52ull, 0x482835ea666b2572ull},
+    {0xad1c8eab5ee43b66ull, 0xda3243650005eecfull}, {0xd863b256369d4a40ull, 0x90bed43e40076a82ull},
+    {0x873e4f75e2224e68ull, 0x5a7744a6e804a291ull}, {0xa90de3535aaae202ull, 0x711515d0a205cb36ull},
+    {0xd3515c2831559a83ull, 0x0d5a5b44ca873e03ull}, {0x8412d9991ed58091ull, 0xe858790afe9486c2ull},
+    {0xa5178fff668ae0b6ull, 0x626e974dbe39a872ull}, {0xce5d73ff402d98e3ull, 0xfb0a3d212dc8128full},
+    {0x80fa687f881c7f8eull, 0x7ce66634bc9d0b99ull}, {0xa139029f6a239f72ull, 0x1c1fffc1ebc44e80ull},
+    {0xc987434744ac874eull, 0xa327ffb266b56220ull}, {0xfbe9141915d7a922ull, 0x4bf1ff9f0062baa8ull},
+    {0x9d71ac8fada6c9b5ull, 0x6f773fc3603db4a9ull}, {0xc4ce17b399107c22ull, 0xcb550fb4384d21d3ull},
+    {0xf6019da07f549b2bull, 0x7e2a53a146606a48ull}, {0x99c102844f94e0fbull, 0x2eda7444cbfc426dull},
+    {0xc0314325637a1939ull, 0xfa911155fefb5308ull}, {0xf03d93eebc589f88ull, 0x793555ab7eba27caull},
+    {0x96267c7535b763b5ull, 0x4bc1558b2f3458deull}, {0xbbb01b9283253ca2ull, 0x9eb1aaedfb016f16ull},
+    {0xea9c227723ee8bcbull, 0x465e15a979c1cadcull}, {0x92a1958a7675175full, 0x0bfacd89ec191ec9ull},
+    {0xb749faed14125d36ull, 0xcef980ec671f667bull}, {0xe51c79a85916f484ull, 0x82b7e12780e7401aull},
+    {0x8f31cc0937ae58d2ull, 0xd1b2ecb8b0908810ull}, {0xb2fe3f0b8599ef07ull, 0x861fa7e6dcb4aa15ull},
+    {0xdfbdcece67006ac9ull, 0x67a791e093e1d49aull}, {0x8bd6a141006042bdull, 0xe0c8bb2c5c6d24e0ull},
+    {0xaecc49914078536dull, 0x58fae9f773886e18ull}, {0xda7f5bf590966848ull, 0xaf39a475506a899eull},
+    {0x888f99797a5e012dull, 0x6d8406c952429603ull}, {0xaab37fd7d8f58178ull, 0xc8e5087ba6d33b83ull},
+    {0xd5605fcdcf32e1d6ull, 0xfb1e4a9a90880a64ull}, {0x855c3be0a17fcd26ull, 0x5cf2eea09a55067full},
+    {0xa6b34ad8c9dfc06full, 0xf42faa48c0ea481eull}, {0xd0601d8efc57b08bull, 0xf13b94daf124da26ull},
+    {0x823c12795db6ce57ull, 0x76c53d08d6b70858ull}, {0xa2cb1717b52481edull, 0x54768c4b0c64ca6eull},
+    {0xcb7ddcdda26da268ull, 0xa9942f5dcf7dfd09ull}, {0xfe5d54150b090b02ull, 0xd3f93b35435d7c4cull},
+    {0x9efa548d26e5a6e1ull, 0xc47bc5014a1a6dafull}, {0xc6b8e9b0709f109aull, 0x359ab6419ca1091bull},
+    {0xf867241c8cc6d4c0ull, 0xc30163d203c94b62ull}, {0x9b407691d7fc44f8ull, 0x79e0de63425dcf1dull},
+    {0xc21094364dfb5636ull, 0x985915fc12f542e4ull}, {0xf294b943e17a2bc4ull, 0x3e6f5b7b17b2939dull},
+    {0x979cf3ca6cec5b5aull, 0xa705992ceecf9c42ull}, {0xbd8430bd08277231ull, 0x50c6ff782a838353ull},
+    {0xece53cec4a314ebdull, 0xa4f8bf5635246428ull}, {0x940f4613ae5ed136ull, 0x871b7795e136be99ull},
+    {0xb913179899f68584ull, 0x28e2557b59846e3full}, {0xe757dd7ec07426e5ull, 0x331aeada2fe589cfull},
+    {0x9096ea6f3848984full, 0x3ff0d2c85def7621ull}, {0xb4bca50b065abe63ull, 0x0fed077a756b53a9ull},
+    {0xe1ebce4dc7f16dfbull, 0xd3e8495912c62894ull}, {0x8d3360f09cf6e4bdull, 0x64712dd7abbbd95cull},
+    {0xb080392cc4349decull, 0xbd8d794d96aacfb3ull}, {0xdca04777f541c567ull, 0xecf0d7a0fc5583a0ull},
+    {0x89e42caaf9491b60ull, 0xf41686c49db57244ull}, {0xac5d37d5b79b6239ull, 0x311c2875c522ced5ull},
+    {0xd77485cb25823ac7ull, 0x7d633293366b828bull}, {0x86a8d39ef77164bcull, 0xae5dff9c02033197ull},
+    {0xa8530886b54dbdebull, 0xd9f57f830283fdfcull}, {0xd267caa862a12d66ull, 0xd072df63c324fd7bull},
+    {0x8380dea93da4bc60ull, 0x4247cb9e59f71e6dull}, {0xa46116538d0deb78ull, 0x52d9be85f074e608ull},
+    {0xcd795be870516656ull, 0x67902e276c921f8bull}, {0x806bd9714632dff6ull, 0x00ba1cd8a3db53b6ull},
+    {0xa086cfcd97bf97f3ull, 0x80e8a40eccd228a4ull}, {0xc8a883c0fdaf7df0ull, 0x6122cd128006b2cdull},
+    {0xfad2a4b13d1b5d6cull, 0x796b805720085f81ull}, {0x9cc3a6eec6311a63ull, 0xcbe3303674053bb0ull},
+    {0xc3f490aa77bd60fcull, 0xbedbfc4411068a9cull}, {0xf4f1b4d515acb93bull, 0xee92fb5515482d44ull},
+    {0x991711052d8bf3c5ull, 0x751bdd152d4d1c4aull}, {0xbf5cd54678eef0b6ull, 0xd262d45a78a0635dull},
+    {0xef340a98172aace4ull, 0x86fb897116c87c34ull}, {0x9580869f0e7aac0eull, 0xd45d35e6ae3d4da0ull},
+    {0xbae0a846d2195712ull, 0x8974836059cca109ull}, {0xe998d258869facd7ull, 0x2bd1a438703fc94bull},
+    {0x91ff83775423cc06ull, 0x7b6306a34627ddcfull}, {0xb67f6455292cbf08ull, 0x1a3bc84c17b1d542ull},
+    {0xe41f3d6a7377eecaull, 0x20caba5f1d9e4a93ull}, {0x8e938662882af53eull, 0x547eb47b7282ee9cull},
+    {0xb23867fb2a35b28dull, 0xe99e619a4f23aa43ull}, {0xdec681f9f4c31f31ull, 0x6405fa00e2ec94d4ull},
+    {0x8b3c113c38f9f37eull, 0xde83bc408dd3dd04ull}, {0xae0b158b4738705eull, 0x9624ab50b148d445ull},
+    {0xd98ddaee19068c76ull, 0x3badd624dd9b0957ull}, {0x87f8a8d4cfa417c9ull, 0xe54ca5d70a80e5d6ull},
+    {0xa9f6d30a038d1dbcull, 0x5e9fcf4ccd211f4cull}, {0xd47487cc8470652bull, 0x7647c3200069671full},
+    {0x84c8d4dfd2c63f3bull, 0x29ecd9f40041e073ull}, {0xa5fb0a17c777cf09ull, 0xf468107100525890ull},
+    {0xcf79cc9db955c2ccull, 0x7182148d4066eeb4ull}, {0x81ac1fe293d599bfull, 0xc6f14cd848405530ull},
+    {0xa21727db38cb002full, 0xb8ada00e5a506a7cull}, {0xca9cf1d206fdc03bull, 0xa6d90811f0e4851cull},
+    {0xfd442e4688bd304aull, 0x908f4a166d1da663ull}, {0x9e4a9cec15763e2eull, 0x9a598e4e043287feull},
+    {0xc5dd44271ad3cdbaull, 0x40eff1e1853f29fdull}, {0xf7549530e188c128ull, 0xd12bee59e68ef47cull},
+    {0x9a94dd3e8cf578b9ull, 0x82bb74f8301958ceull}, {0xc13a148e3032d6e7ull, 0xe36a52363c1faf01ull},
+    {0xf18899b1bc3f8ca1ull, 0xdc44e6c3cb279ac1ull}, {0x96f5600f15a7b7e5ull, 0x29ab103a5ef8c0b9ull},
+    {0xbcb2b812db11a5deull, 0x7415d448f6b6f0e7ull}, {0xebdf661791d60f56ull, 0x111b495b3464ad21ull},
+    {0x936b9fcebb25c995ull, 0xcab10dd900beec34ull}, {0xb84687c269ef3bfbull, 0x3d5d514f40eea742ull},
+    {0xe65829b3046b0afaull, 0x0cb4a5a3112a5112ull}, {0x8ff71a0fe2c2e6dcull, 0x47f0e785eaba72abull},
+    {0xb3f4e093db73a093ull, 0x59ed216765690f56ull}, {0xe0f218b8d25088b8ull, 0x306869c13ec3532cull},
+    {0x8c974f7383725573ull, 0x1e414218c73a13fbull}, {0xafbd2350644eeacfull, 0xe5d1929ef90898faull},
+    {0xdbac6c247d62a583ull, 0xdf45f746b74abf39ull}, {0x894bc396ce5da772ull, 0x6b8bba8c328eb783ull},
+    {0xab9eb47c81f5114full, 0x066ea92f3f326564ull}, {0xd686619ba27255a2ull, 0xc80a537b0efefebdull},
+    {0x8613fd0145877585ull, 0xbd06742ce95f5f36ull}, {0xa798fc4196e952e7ull, 0x2c48113823b73704ull},
+    {0xd17f3b51fca3a7a0ull, 0xf75a15862ca504c5ull}, {0x82ef85133de648c4ull, 0x9a984d73dbe722fbull},
+    {0xa3ab66580d5fdaf5ull, 0xc13e60d0d2e0ebbaull}, {0xcc963fee10b7d1b3ull, 0x318df905079926a8ull},
+    {0xffbbcfe994e5c61full, 0xfdf17746497f7052ull}, {0x9fd561f1fd0f9bd3ull, 0xfeb6ea8bedefa633ull},
+    {0xc7caba6e7c5382c8ull, 0xfe64a52ee96b8fc0ull}, {0xf9bd690a1b68637bull, 0x3dfdce7aa3c673b0ull},
+    {0x9c1661a651213e2dull, 0x06bea10ca65c084eull}, {0xc31bfa0fe5698db8ull, 0x486e494fcff30a62ull},
+    {0xf3e2f893dec3f126ull, 0x5a89dba3c3efccfaull}, {0x986ddb5c6b3a76b7ull, 0xf89629465a75e01cull},
+    {0xbe89523386091465ull, 0xf6bbb397f1135823ull}, {0xee2ba6c0678b597full, 0x746aa07ded582e2cull},
+    {0x94db483840b717efull, 0xa8c2a44eb4571cdcull}, {0xba121a4650e4ddebull, 0x92f34d62616ce413ull},
+    {0xe896a0d7e51e1566ull, 0x77b020baf9c81d17ull}, {0x915e2486ef32cd60ull, 0x0ace1474dc1d122eull},
+    {0xb5b5ada8aaff80b8ull, 0x0d819992132456baull}, {0xe3231912d5bf60e6ull, 0x10e1fff697ed6c69ull},
+    {0x8df5efabc5979c8full, 0xca8d3ffa1ef463c1ull}, {0xb1736b96b6fd83b3ull, 0xbd308ff8a6b17cb2ull},
+    {0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull}, {0x8aa22c0dbef60ee4ull, 0x6bcdf07a423aa96bull},
+    {0xad4ab7112eb3929dull, 0x86c16c98d2c953c6ull}, {0xd89d64d57a607744ull, 0xe871c7bf077ba8b7ull},
+    {0x87625f056c7c4a8bull, 0x11471cd764ad4972ull}, {0xa93af6c6c79b5d2dull, 0xd598e40d3dd89bcfull},
+    {0xd389b47879823479ull, 0x4aff1d108d4ec2c3ull}, {0x843610cb4bf160cbull, 0xcedf722a585139baull},
+    {0xa54394fe1eedb8feull, 0xc2974eb4ee658828ull}, {0xce947a3da6a9273eull, 0x733d226229feea32ull},
+    {0x811ccc668829b887ull, 0x0806357d5a3f525full}, {0xa163ff802a3426a8ull, 0xca07c2dcb0cf26f7ull},
+    {0xc9bcff6034c13052ull, 0xfc89b393dd02f0b5ull}, {0xfc2c3f3841f17c67ull, 0xbbac2078d443ace2ull},
+    {0x9d9ba7832936edc0ull, 0xd54b944b84aa4c0dull}, {0xc5029163f384a931ull, 0x0a9e795e65d4df11ull},
+    {0xf64335bcf065d37dull, 0x4d4617b5ff4a16d5ull}, {0x99ea0196163fa42eull, 0x504bced1bf8e4e45ull},
+    {0xc06481fb9bcf8d39ull, 0xe45ec2862f71e1d6ull}, {0xf07da27a82c37088ull, 0x5d767327bb4e5a4cull},
+    {0x964e858c91ba2655ull, 0x3a6a07f8d510f86full}, {0xbbe226efb628afeaull, 0x890489f70a55368bull},
+    {0xeadab0aba3b2dbe5ull, 0x2b45ac74ccea842eull}, {0x92c8ae6b464fc96full, 0x3b0b8bc90012929dull},
+    {0xb77ada0617e3bbcbull, 0x09ce6ebb40173744ull}, {0xe55990879ddcaabdull, 0xcc420a6a101d0515ull},
+    {0x8f57fa54c2a9eab6ull, 0x9fa946824a12232dull}, {0xb32df8e9f3546564ull, 0x47939822dc96abf9ull},
+    {0xdff9772470297ebdull, 0x59787e2b93bc56f7ull}, {0x8bfbea76c619ef36ull, 0x57eb4edb3c55b65aull},
+    {0xaefae51477a06b03ull, 0xede622920b6b23f1ull}, {0xdab99e59958885c4ull, 0xe95fab368e45ecedull},
+    {0x88b402f7fd75539bull, 0x11dbcb0218ebb414ull}, {0xaae103b5fcd2a881ull, 0xd652bdc29f26a119ull},
+    {0xd59944a37c0752a2ull, 0x4be76d3346f0495full}, {0x857fcae62d8493a5ull, 0x6f70a4400c562ddbull},
+    {0xa6dfbd9fb8e5b88eull, 0xcb4ccd500f6bb952ull}, {0xd097ad07a71f26b2ull, 0x7e2000a41346a7a7ull},
+    {0x825ecc24c873782full, 0x8ed400668c0c28c8ull}, {0xa2f67f2dfa90563bull, 0x728900802f0f32faull},
+    {0xcbb41ef979346bcaull, 0x4f2b40a03ad2ffb9ull}, {0xfea126b7d78186bcull, 0xe2f610c84987bfa8ull},
+    {0x9f24b832e6b0f436ull, 0x0dd9ca7d2df4d7c9ull}, {0xc6ede63fa05d3143ull, 0x91503d1c79720dbbull},
+    {0xf8a95fcf88747d94ull, 0x75a44c6397ce912aull}, {0x9b69dbe1b548ce7cull, 0xc986afbe3ee11abaull},
+    {0xc24452da229b021bull, 0xfbe85badce996168ull}, {0xf2d56790ab41c2a2ull, 0xfae27299423fb9c3ull},
+    {0x97c560ba6b0919a5ull, 0xdccd879fc967d41aull}, {0xbdb6b8e905cb600full, 0x5400e987bbc1c920ull},
+    {0xed246723473e3813ull, 0x290123e9aab23b68ull}, {0x9436c0760c86e30bull, 0xf9a0b6720aaf6521ull},
+    {0xb94470938fa89bceull, 0xf808e40e8d5b3e69ull}, {0xe7958cb87392c2c2ull, 0xb60b1d1230b20e04ull},
+    {0x90bd77f3483bb9b9ull, 0xb1c6f22b5e6f48c2ull}, {0xb4ecd5f01a4aa828ull, 0x1e38aeb6360b1af3ull},
+    {0xe2280b6c20dd5232ull, 0x25c6da63c38de1b0ull}, {0x8d590723948a535full, 0x579c487e5a38ad0eull},
+    {0xb0af48ec79ace837ull, 0x2d835a9df0c6d851ull}, {0xdcdb1b2798182244ull, 0xf8e431456cf88e65ull},
+    {0x8a08f0f8bf0f156bull, 0x1b8e9ecb641b58ffull}, {0xac8b2d36eed2dac5ull, 0xe272467e3d222f3full},
+    {0xd7adf884aa879177ull, 0x5b0ed81dcc6abb0full}, {0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull},
+    {0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull}, {0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull},
+    {0x83a3eeeef9153e89ull, 0x1953cf68300424acull}, {0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull},
+    {0xcdb02555653131b6ull, 0x3792f412cb06794dull}, {0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull},
+    {0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull}, {0xc8de047564d20a8bull, 0xf245825a5a445275ull},
+    {0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull}, {0x9ced737bb6c4183dull, 0x55464dd69685606bull},
+    {0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull}, {0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull},
+    {0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull}, {0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull},
+    {0xef73d256a5c0f77cull, 0x963e66858f6d4440ull}, {0x95a8637627989aadull, 0xdde7001379a44aa8ull},
+    {0xbb127c53b17ec159ull, 0x5560c018580d5d52ull}, {0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull},
+    {0x9226712162ab070dull, 0xcab3961304ca70e8ull}, {0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull},
+    {0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull}, {0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull},
+    {0xb267ed1940f1c61cull, 0x55f038b237591ed3ull}, {0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull},
+    {0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull}, {0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull},
+    {0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull}, {0x881cea14545c7575ull, 0x7e50d64177da2e54ull},
+    {0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull}, {0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull},
+    {0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull}, {0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull},
+    {0xcfb11ead453994baull, 0x67de18eda5814af2ull}, {0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull},
+    {0xa2425ff75e14fc31ull, 0xa1258379a94d028dull}, {0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull},
+    {0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull}, {0x9e74d1b791e07e48ull, 0x775ea264cf55347eull},
+    {0xc612062576589ddaull, 0x95364afe032a819eull}, {0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull},
+    {0x9abe14cd44753b52ull, 0xc4926a9672793543ull}, {0xc16d9a0095928a27ull, 0x75b7053c0f178294ull},
+    {0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull}, {0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull},
+    {0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull}, {0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull},
+    {0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull}, {0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull},
+    {0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull}, {0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull},
+    {0xb424dc35095cd80full, 0x538484c19ef38c95ull}, {0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull},
+    {0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull}, {0xafebff0bcb24aafeull, 0xf78f69a51539d749ull},
+    {0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull}, {0x89705f4136b4a597ull, 0x31680a88f8953031ull},
+    {0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull}, {0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull},
+    {0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull}, {0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull},
+    {0xd1b71758e219652bull, 0xd3c36113404ea4a9ull}, {0x83126e978d4fdf3bull, 0x645a1cac083126eaull},
+    {0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull}, {0xccccccccccccccccull, 0xcccccccccccccccdull},
+    {0x8000000000000000ull, 0x0000000000000000ull}, {0xa000000000000000ull, 0x0000000000000000ull},
+    {0xc800000000000000ull, 0x0000000000000000ull}, {0xfa00000000000000ull, 0x0000000000000000ull},
+    {0x9c40000000000000ull, 0x0000000000000000ull}, {0xc350000000000000ull, 0x0000000000000000ull},
+    {0xf424000000000000ull, 0x0000000000000000ull}, {0x9896800000000000ull, 0x0000000000000000ull},
+    {0xbebc200000000000ull, 0x0000000000000000ull}, {0xee6b280000000000ull, 0x0000000000000000ull},
+    {0x9502f90000000000ull, 0x0000000000000000ull}, {0xba43b74000000000ull, 0x0000000000000000ull},
+    {0xe8d4a51000000000ull, 0x0000000000000000ull}, {0x9184e72a00000000ull, 0x0000000000000000ull},
+    {0xb5e620f480000000ull, 0x0000000000000000ull}, {0xe35fa931a0000000ull, 0x0000000000000000ull},
+    {0x8e1bc9bf04000000ull, 0x0000000000000000ull}, {0xb1a2bc2ec5000000ull, 0x0000000000000000ull},
+    {0xde0b6b3a76400000ull, 0x0000000000000000ull}, {0x8ac7230489e80000ull, 0x0000000000000000ull},
+    {0xad78ebc5ac620000ull, 0x0000000000000000ull}, {0xd8d726b7177a8000ull, 0x0000000000000000ull},
+    {0x878678326eac9000ull, 0x0000000000000000ull}, {0xa968163f0a57b400ull, 0x0000000000000000ull},
+    {0xd3c21bcecceda100ull, 0x0000000000000000ull}, {0x84595161401484a0ull, 0x0000000000000000ull},
+    {0xa56fa5b99019a5c8ull, 0x0000000000000000ull}, {0xcecb8f27f4200f3aull, 0x0000000000000000ull},
+    {0x813f3978f8940984ull, 0x4000000000000000ull}, {0xa18f07d736b90be5ull, 0x5000000000000000ull},
+    {0xc9f2c9cd04674edeull, 0xa400000000000000ull}, {0xfc6f7c4045812296ull, 0x4d00000000000000ull},
+    {0x9dc5ada82b70b59dull, 0xf020000000000000ull}, {0xc5371912364ce305ull, 0x6c28000000000000ull},
+    {0xf684df56c3e01bc6ull, 0xc732000000000000ull}, {0x9a130b963a6c115cull, 0x3c7f400000000000ull},
+    {0xc097ce7bc90715b3ull, 0x4b9f100000000000ull}, {0xf0bdc21abb48db20ull, 0x1e86d40000000000ull},
+    {0x96769950b50d88f4ull, 0x1314448000000000ull}, {0xbc143fa4e250eb31ull, 0x17d955a000000000ull},
+    {0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull}, {0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull},
+    {0xb7abc627050305adull, 0xf14a3d9e40000000ull}, {0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull},
+    {0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull}, {0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull},
+    {0xe0352f62a19e306eull, 0xd50b2037ad200000ull}, {0x8c213d9da502de45ull, 0x4526f422cc340000ull},
+    {0xaf298d050e4395d6ull, 0x9670b12b7f410000ull}, {0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull},
+    {0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull}, {0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull},
+    {0xd5d238a4abe98068ull, 0x72a4904598d6d880ull}, {0x85a36366eb71f041ull, 0x47a6da2b7f864750ull},
+    {0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull}, {0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull},
+    {0x82818f1281ed449full, 0xbff8f10e7a8921a4ull}, {0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull},
+    {0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull}, {0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull},
+    {0x9f4f2726179a2245ull, 0x01d762422c946590ull}, {0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull},
+    {0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull}, {0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full},
+    {0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull}, {0xf316271c7fc3908aull, 0x8bef464e3945ef7aull},
+    {0x97edd871cfda3a56ull, 0x97758bf0e3cbb5acull}, {0xbde94e8e43d0c8ecull, 0x3d52eeed1cbea317ull},
+    {0xed63a231d4c4fb27ull, 0x4ca7aaa863ee4bddull}, {0x945e455f24fb1cf8ull, 0x8fe8caa93e74ef6aull},
+    {0xb975d6b6ee39e436ull, 0xb3e2fd538e122b44ull}, {0xe7d34c64a9c85d44ull, 0x60dbbca87196b616ull},
+    {0x90e40fbeea1d3a4aull, 0xbc8955e946fe31cdull}, {0xb51d13aea4a488ddull, 0x6babab6398bdbe41ull},
+    {0xe264589a4dcdab14ull, 0xc696963c7eed2dd1ull}, {0x8d7eb76070a08aecull, 0xfc1e1de5cf543ca2ull},
+    {0xb0de65388cc8ada8ull, 0x3b25a55f43294bcbull}, {0xdd15fe86affad912ull, 0x49ef0eb713f39ebeull},
+    {0x8a2dbf142dfcc7abull, 0x6e3569326c784337ull}, {0xacb92ed9397bf996ull, 0x49c2c37f07965404ull},
+    {0xd7e77a8f87daf7fbull, 0xdc33745ec97be906ull}, {0x86f0ac99b4e8dafdull, 0x69a028bb3ded71a3ull},
+    {0xa8acd7c0222311bcull, 0xc40832ea0d68ce0cull}, {0xd2d80db02aabd62bull, 0xf50a3fa490c30190ull},
+    {0x83c7088e1aab65dbull, 0x792667c6da79e0faull}, {0xa4b8cab1a1563f52ull, 0x577001b891185938ull},
+    {0xcde6fd5e09abcf26ull, 0xed4c0226b55e6f86ull}, {0x80b05e5ac60b6178ull, 0x544f8158315b05b4ull},
+    {0xa0dc75f1778e39d6ull, 0x696361ae3db1c721ull}, {0xc913936dd571c84cull, 0x03bc3a19cd1e38e9ull},
+    {0xfb5878494ace3a5full, 0x04ab48a04065c723ull}, {0x9d174b2dcec0e47bull, 0x62eb0d64283f9c76ull},
+    {0xc45d1df942711d9aull, 0x3ba5d0bd324f8394ull}, {0xf5746577930d6500ull, 0xca8f44ec7ee36479ull},
+    {0x9968bf6abbe85f20ull, 0x7e998b13cf4e1ecbull}, {0xbfc2ef456ae276e8ull, 0x9e3fedd8c321a67eull},
+    {0xefb3ab16c59b14a2ull, 0xc5cfe94ef3ea101eull}, {0x95d04aee3b80ece5ull, 0xbba1f1d158724a12ull},
+    {0xbb445da9ca61281full, 0x2a8a6e45ae8edc97ull}, {0xea1575143cf97226ull, 0xf52d09d71a3293bdull},
+    {0x924d692ca61be758ull, 0x593c2626705f9c56ull}, {0xb6e0c377cfa2e12eull, 0x6f8b2fb00c77836cull},
+    {0xe498f455c38b997aull, 0x0b6dfb9c0f956447ull}, {0x8edf98b59a373fecull, 0x4724bd4189bd5eacull},
+    {0xb2977ee300c50fe7ull, 0x58edec91ec2cb657ull}, {0xdf3d5e9bc0f653e1ull, 0x2f2967b66737e3edull},
+    {0x8b865b215899f46cull, 0xbd79e0d20082ee74ull}, {0xae67f1e9aec07187ull, 0xecd8590680a3aa11ull},
+    {0xda01ee641a708de9ull, 0xe80e6f4820cc9495ull}, {0x884134fe908658b2ull, 0x3109058d147fdcddull},
+    {0xaa51823e34a7eedeull, 0xbd4b46f0599fd415ull}, {0xd4e5e2cdc1d1ea96ull, 0x6c9e18ac7007c91aull},
+    {0x850fadc09923329eull, 0x03e2cf6bc604ddb0ull}, {0xa6539930bf6bff45ull, 0x84db8346b786151cull},
+    {0xcfe87f7cef46ff16ull, 0xe612641865679a63ull}, {0x81f14fae158c5f6eull, 0x4fcb7e8f3f60c07eull},
+    {0xa26da3999aef7749ull, 0xe3be5e330f38f09dull}, {0xcb090c8001ab551cull, 0x5cadf5bfd3072cc5ull},
+    {0xfdcb4fa002162a63ull, 0x73d9732fc7c8f7f6ull}, {0x9e9f11c4014dda7eull, 0x2867e7fddcdd9afaull},
+    {0xc646d63501a1511dull, 0xb281e1fd541501b8ull}, {0xf7d88bc24209a565ull, 0x1f225a7ca91a4226ull},
+    {0x9ae757596946075full, 0x3375788de9b06958ull}, {0xc1a12d2fc3978937ull, 0x0052d6b1641c83aeull},
+    {0xf209787bb47d6b84ull, 0xc0678c5dbd23a49aull}, {0x9745eb4d50ce6332ull, 0xf840b7ba963646e0ull},
+    {0xbd176620a501fbffull, 0xb650e5a93bc3d898ull}, {0xec5d3fa8ce427affull, 0xa3e51f138ab4cebeull},
+    {0x93ba47c980e98cdfull, 0xc66f336c36b10137ull}, {0xb8a8d9bbe123f017ull, 0xb80b0047445d4184ull},
+    {0xe6d3102ad96cec1dull, 0xa60dc059157491e5ull}, {0x9043ea1ac7e41392ull, 0x87c89837ad68db2full},
+    {0xb454e4a179dd1877ull, 0x29babe4598c311fbull}, {0xe16a1dc9d8545e94ull, 0xf4296dd6fef3d67aull},
+    {0x8ce2529e2734bb1dull, 0x1899e4a65f58660cull}, {0xb01ae745b101e9e4ull, 0x5ec05dcff72e7f8full},
+    {0xdc21a1171d42645dull, 0x76707543f4fa1f73ull}, {0x899504ae72497ebaull, 0x6a06494a791c53a8ull},
+    {0xabfa45da0edbde69ull, 0x0487db9d17636892ull}, {0xd6f8d7509292d603ull, 0x45a9d2845d3c42b6ull},
+    {0x865b86925b9bc5c2ull, 0x0b8a2392ba45a9b2ull}, {0xa7f26836f282b732ull, 0x8e6cac7768d7141eull},
+    {0xd1ef0244af2364ffull, 0x3207d795430cd926ull}, {0x8335616aed761f1full, 0x7f44e6bd49e807b8ull},
+    {0xa402b9c5a8d3a6e7ull, 0x5f16206c9c6209a6ull}, {0xcd036837130890a1ull, 0x36dba887c37a8c0full},
+    {0x802221226be55a64ull, 0xc2494954da2c9789ull}, {0xa02aa96b06deb0fdull, 0xf2db9baa10b7bd6cull},
+    {0xc83553c5c8965d3dull, 0x6f92829494e5acc7ull}, {0xfa42a8b73abbf48cull, 0xcb772339ba1f17f9ull},
+    {0x9c69a97284b578d7ull, 0xff2a760414536efbull}, {0xc38413cf25e2d70dull, 0xfef5138519684abaull},
+    {0xf46518c2ef5b8cd1ull, 0x7eb258665fc25d69ull}, {0x98bf2f79d5993802ull, 0xef2f773ffbd97a61ull},
+    {0xbeeefb584aff8603ull, 0xaafb550ffacfd8faull}, {0xeeaaba2e5dbf6784ull, 0x95ba2a53f983cf38ull},
+    {0x952ab45cfa97a0b2ull, 0xdd945a747bf26183ull}, {0xba756174393d88dfull, 0x94f971119aeef9e4ull},
+    {0xe912b9d1478ceb17ull, 0x7a37cd5601aab85dull}, {0x91abb422ccb812eeull, 0xac62e055c10ab33aull},
+    {0xb616a12b7fe617aaull, 0x577b986b314d6009ull}, {0xe39c49765fdf9d94ull, 0xed5a7e85fda0b80bull},
+    {0x8e41ade9fbebc27dull, 0x14588f13be847307ull}, {0xb1d219647ae6b31cull, 0x596eb2d8ae258fc8ull},
+    {0xde469fbd99a05fe3ull, 0x6fca5f8ed9aef3bbull}, {0x8aec23d680043beeull, 0x25de7bb9480d5854ull},
+    {0xada72ccc20054ae9ull, 0xaf561aa79a10ae6aull}, {0xd910f7ff28069da4ull, 0x1b2ba1518094da04ull},
+    {0x87aa9aff79042286ull, 0x90fb44d2f05d0842ull}, {0xa99541bf57452b28ull, 0x353a1607ac744a53ull},
+    {0xd3fa922f2d1675f2ull, 0x42889b8997915ce8ull}, {0x847c9b5d7c2e09b7ull, 0x69956135febada11ull},
+    {0xa59bc234db398c25ull, 0x43fab9837e699095ull}, {0xcf02b2c21207ef2eull, 0x94f967e45e03f4bbull},
+    {0x8161afb94b44f57dull, 0x1d1be0eebac278f5ull}, {0xa1ba1ba79e1632dcull, 0x6462d92a69731732ull},
+    {0xca28a291859bbf93ull, 0x7d7b8f7503cfdcfeull}, {0xfcb2cb35e702af78ull, 0x5cda735244c3d43eull},
+    {0x9defbf01b061adabull, 0x3a0888136afa64a7ull}, {0xc56baec21c7a1916ull, 0x088aaa1845b8fdd0ull},
+    {0xf6c69a72a3989f5bull, 0x8aad549e57273d45ull}, {0x9a3c2087a63f6399ull, 0x36ac54e2f678864bull},
+    {0xc0cb28a98fcf3c7full, 0x84576a1bb416a7ddull}, {0xf0fdf2d3f3c30b9full, 0x656d44a2a11c51d5ull},
+    {0x969eb7c47859e743ull, 0x9f644ae5a4b1b325ull}, {0xbc4665b596706114ull, 0x873d5d9f0dde1feeull},
+    {0xeb57ff22fc0c7959ull, 0xa90cb506d155a7eaull}, {0x9316ff75dd87cbd8ull, 0x09a7f12442d588f2ull},
+    {0xb7dcbf5354e9beceull, 0x0c11ed6d538aeb2full}, {0xe5d3ef282a242e81ull, 0x8f1668c8a86da5faull},
+    {0x8fa475791a569d10ull, 0xf96e017d694487bcull}, {0xb38d92d760ec4455ull, 0x37c981dcc395a9acull},
+    {0xe070f78d3927556aull, 0x85bbe253f47b1417ull}, {0x8c469ab843b89562ull, 0x93956d7478ccec8eull},
+    {0xaf58416654a6babbull, 0x387ac8d1970027b2ull}, {0xdb2e51bfe9d0696aull, 0x06997b05fcc0319eull},
+    {0x88fcf317f22241e2ull, 0x441fece3bdf81f03ull}, {0xab3c2fddeeaad25aull, 0xd527e81cad7626c3ull},
+    {0xd60b3bd56a5586f1ull, 0x8a71e223d8d3b074ull}, {0x85c7056562757456ull, 0xf6872d5667844e49ull},
+    {0xa738c6bebb12d16cull, 0xb428f8ac016561dbull}, {0xd106f86e69d785c7ull, 0xe13336d701beba52ull},
+    {0x82a45b450226b39cull, 0xecc0024661173473ull}, {0xa34d721642b06084ull, 0x27f002d7f95d0190ull},
+    {0xcc20ce9bd35c78a5ull, 0x31ec038df7b441f4ull}, {0xff290242c83396ceull, 0x7e67047175a15271ull},
+    {0x9f79a169bd203e41ull, 0x0f0062c6e984d386ull}, {0xc75809c42c684dd1ull, 0x52c07b78a3e60868ull},
+    {0xf92e0c3537826145ull, 0xa7709a56ccdf8a82ull}, {0x9bbcc7a142b17ccbull, 0x88a66076400bb691ull},
+    {0xc2abf989935ddbfeull, 0x6acff893d00ea435ull}, {0xf356f7ebf83552feull, 0x0583f6b8c4124d43ull},
+    {0x98165af37b2153deull, 0xc3727a337a8b704aull}, {0xbe1bf1b059e9a8d6ull, 0x744f18c0592e4c5cull},
+    {0xeda2ee1c7064130cull, 0x1162def06f79df73ull}, {0x9485d4d1c63e8be7ull, 0x8addcb5645ac2ba8ull},
+    {0xb9a74a0637ce2ee1ull, 0x6d953e2bd7173692ull}, {0xe8111c87c5c1ba99ull, 0xc8fa8db6ccdd0437ull},
+    {0x910ab1d4db9914a0ull, 0x1d9c9892400a22a2ull}, {0xb54d5e4a127f59c8ull, 0x2503beb6d00cab4bull},
+    {0xe2a0b5dc971f303aull, 0x2e44ae64840fd61dull}, {0x8da471a9de737e24ull, 0x5ceaecfed289e5d2ull},
+    {0xb10d8e1456105dadull, 0x7425a83e872c5f47ull}, {0xdd50f1996b947518ull, 0xd12f124e28f77719ull},
+    {0x8a5296ffe33cc92full, 0x82bd6b70d99aaa6full}, {0xace73cbfdc0bfb7bull, 0x636cc64d1001550bull},
+    {0xd8210befd30efa5aull, 0x3c47f7e05401aa4eull}, {0x8714a775e3e95c78ull, 0x65acfaec34810a71ull},
+    {0xa8d9d1535ce3b396ull, 0x7f1839a741a14d0dull}, {0xd31045a8341ca07cull, 0x1ede48111209a050ull},
+    {0x83ea2b892091e44dull, 0x934aed0aab460432ull}, {0xa4e4b66b68b65d60ull, 0xf81da84d5617853full},
+    {0xce1de40642e3f4b9ull, 0x36251260ab9d668eull}, {0x80d2ae83e9ce78f3ull, 0xc1d72b7c6b426019ull},
+    {0xa1075a24e4421730ull, 0xb24cf65b8612f81full}, {0xc94930ae1d529cfcull, 0xdee033f26797b627ull},
+    {0xfb9b7cd9a4a7443cull, 0x169840ef017da3b1ull}, {0x9d412e0806e88aa5ull, 0x8e1f289560ee864eull},
+    {0xc491798a08a2ad4eull, 0xf1a6f2bab92a27e2ull}, {0xf5b5d7ec8acb58a2ull, 0xae10af696774b1dbull},
+    {0x9991a6f3d6bf1765ull, 0xacca6da1e0a8ef29ull}, {0xbff610b0cc6edd3full, 0x17fd090a58d32af3ull},
+    {0xeff394dcff8a948eull, 0xddfc4b4cef07f5b0ull}, {0x95f83d0a1fb69cd9ull, 0x4abdaf101564f98eull},
+    {0xbb764c4ca7a4440full, 0x9d6d1ad41abe37f1ull}, {0xea53df5fd18d5513ull, 0x84c86189216dc5edull},
+    {0x92746b9be2f8552cull, 0x32fd3cf5b4e49bb4ull}, {0xb7118682dbb66a77ull, 0x3fbc8c33221dc2a1ull},
+    {0xe4d5e82392a40515ull, 0x0fabaf3feaa5334aull}, {0x8f05b1163ba6832dull, 0x29cb4d87f2a7400eull},
+    {0xb2c71d5bca9023f8ull, 0x743e20e9ef511012ull}, {0xdf78e4b2bd342cf6ull, 0x914da9246b255416ull},
+    {0x8bab8eefb6409c1aull, 0x1ad089b6c2f7548eull}, {0xae9672aba3d0c320ull, 0xa184ac2473b529b1ull},
+    {0xda3c0f568cc4f3e8ull, 0xc9e5d72d90a2741eull}, {0x8865899617fb1871ull, 0x7e2fa67c7a658892ull},
+    {0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull}, {0xd51ea6fa85785631ull, 0x552a74227f3ea565ull},
+    {0x8533285c936b35deull, 0xd53a88958f87275full}, {0xa67ff273b8460356ull, 0x8a892abaf368f137ull},
+    {0xd01fef10a657842cull, 0x2d2b7569b0432d85ull}, {0x8213f56a67f6b29bull, 0x9c3b29620e29fc73ull},
+    {0xa298f2c501f45f42ull, 0x8349f3ba91b47b8full}, {0xcb3f2f7642717713ull, 0x241c70a936219a73ull},
+    {0xfe0efb53d30dd4d7ull, 0xed238cd383aa0110ull}, {0x9ec95d1463e8a506ull, 0xf4363804324a40aaull},
+    {0xc67bb4597ce2ce48ull, 0xb143c6053edcd0d5ull}, {0xf81aa16fdc1b81daull, 0xdd94b7868e94050aull},
+    {0x9b10a4e5e9913128ull, 0xca7cf2b4191c8326ull}, {0xc1d4ce1f63f57d72ull, 0xfd1c2f611f63a3f0ull},
+    {0xf24a01a73cf2dccfull, 0xbc633b39673c8cecull}, {0x976e41088617ca01ull, 0xd5be0503e085d813ull},
+    {0xbd49d14aa79dbc82ull, 0x4b2d8644d8a74e18ull}, {0xec9c459d51852ba2ull, 0xddf8e7d60ed1219eull},
+    {0x93e1ab8252f33b45ull, 0xcabb90e5c942b503ull}, {0xb8da1662e7b00a17ull, 0x3d6a751f3b936243ull},
+    {0xe7109bfba19c0c9dull, 0x0cc512670a783ad4ull}, {0x906a617d450187e2ull, 0x27fb2b80668b24c5ull},
+    {0xb484f9dc9641e9daull, 0xb1f9f660802dedf6ull}, {0xe1a63853bbd26451ull, 0x5e7873f8a0396973ull},
+    {0x8d07e33455637eb2ull, 0xdb0b487b6423e1e8ull}, {0xb049dc016abc5e5full, 0x91ce1a9a3d2cda62ull},
+    {0xdc5c5301c56b75f7ull, 0x7641a140cc7810fbull}, {0x89b9b3e11b6329baull, 0xa9e904c87fcb0a9dull},
+    {0xac2820d9623bf429ull, 0x546345fa9fbdcd44ull}, {0xd732290fbacaf133ull, 0xa97c177947ad4095ull},
+    {0x867f59a9d4bed6c0ull, 0x49ed8eabcccc485dull}, {0xa81f301449ee8c70ull, 0x5c68f256bfff5a74ull},
+    {0xd226fc195c6a2f8cull, 0x73832eec6fff3111ull}, {0x83585d8fd9c25db7ull, 0xc831fd53c5ff7eabull},
+    {0xa42e74f3d032f525ull, 0xba3e7ca8b77f5e55ull}, {0xcd3a1230c43fb26full, 0x28ce1bd2e55f35ebull},
+    {0x80444b5e7aa7cf85ull, 0x7980d163cf5b81b3ull}, {0xa0555e361951c366ull, 0xd7e105bcc332621full},
+    {0xc86ab5c39fa63440ull, 0x8dd9472bf3fefaa7ull}, {0xfa856334878fc150ull, 0xb14f98f6f0feb951ull},
+    {0x9c935e00d4b9d8d2ull, 0x6ed1bf9a569f33d3ull}, {0xc3b8358109e84f07ull, 0x0a862f80ec4700c8ull},
+    {0xf4a642e14c6262c8ull, 0xcd27bb612758c0faull}, {0x98e7e9cccfbd7dbdull, 0x8038d51cb897789cull},
+    {0xbf21e44003acdd2cull, 0xe0470a63e6bd56c3ull}, {0xeeea5d5004981478ull, 0x1858ccfce06cac74ull},
+    {0x95527a5202df0ccbull, 0x0f37801e0c43ebc8ull}, {0xbaa718e68396cffdull, 0xd30560258f54e6baull},
+    {0xe950df20247c83fdull, 0x47c6b82ef32a2069ull}, {0x91d28b7416cdd27eull, 0x4cdc331d57fa5441ull},
+    {0xb6472e511c81471dull, 0xe0133fe4adf8e952ull}, {0xe3d8f9e563a198e5ull, 0x58180fddd97723a6ull},
+    {0x8e679c2f5e44ff8full, 0x570f09eaa7ea7648ull},
+};
+
+static inline
+int sclz64(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_clzll(v);
+#else
+    int n = 0;
+    while (!(v >> 63)) {
+        v <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/*
+    Round w * 10^q to the nearest double.
+    Return false if the answer needs more precision than 128 bits give,
+    or is subnormal; the caller then falls back to strtod().
+*/
+static
+bool seisel(uint64_t w, int64_t q, double* out) {
+    if (w == 0 || q < SPOW5_MIN) {
+        *out = 0;
+        return true;
+    }
+    if (q > SPOW5_MAX) {
+        *out = INFINITY;
+        return true;
+    }
+#if FLT_EVAL_METHOD == 0
+    if (w <= (1ull << 53) && q >= -22 && q <= 22) {
+        *out = q < 0 ? (double)w / spow10d[-q] : (double)w * spow10d[q];
+        return true;
+    }
+#endif
+    int lz = sclz64(w);
+    w <<= lz;
+    const uint64_t* t = spow5[q - SPOW5_MIN];
+    uint64_t lo = w, hi = t[0];
+    wymum(&lo, &hi);
+    /* The low 9 bits below the mantissa are all ones: refine with the next 64 */
+    if ((hi & 0x1FF) == 0x1FF) {
+        uint64_t lo2 = w, hi2 = t[1];
+        wymum(&lo2, &hi2);
+        lo += hi2;
+        hi += lo < hi2;
+    }
+    if (lo == UINT64_MAX && (q < -27 || q > 55))
         return false;
-    size_t slen = sgetlen(s);
-    if (plen > slen || plen == 0)
+    int upperbit = hi >> 63;
+    int shift = upperbit + 9;
+    uint64_t m = hi >> shift;
+    int64_t power2 = ((217706 * q) >> 16) + 63 + upperbit - lz + 1023;
+    if (power2 <= 0)
         return false;
-    size_t idx = 0;
-    size_t i = 0;
-    while (i < slen) {
-        if (slen - i >= plen && memcmp(s + i, pattern, plen) == 0)
-            i += plen;
-        else
-            s[idx++] = s[i++];
+    /* Exactly halfway: round to even instead of up */
+    if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << shift) == hi)
+        m &= ~1ull;
+    m += m & 1;
+    m >>= 1;
+    if (m >= (2ull << 52)) {
+        m = 1ull << 52;
+        power2++;
+    }
+    if (power2 >= 0x7FF) {
+        *out = INFINITY;
+        return true;
     }
-    ssetlen(s, idx);
-    s[idx] = 0;
+    uint64_t bits = (m & ~(1ull << 52)) | (uint64_t)power2 << 52;
+    memcpy(out, &bits, sizeof(bits));
     return true;
 }
 
-/*
-    Create a new string that is a slice of an existing one.
+/* strtod() on a copy of p[0, n) with '.' turned into the locale's decimal point */
+static
+bool sstrtod(const char* p, size_t n, double* out) {
+    const char* dp = localeconv()->decimal_point;
+    size_t dplen = strlen(dp);
+    char small[128];
+    char* buf = small;
+    if (n + dplen + 1 > sizeof(small)) {
+        buf = malloc(n + dplen + 1);
+        if (buf == NULL) return false;
+    }
+    char* q = buf;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == '.') {
+            memcpy(q, dp, dplen);
+            q += dplen;
+        } else {
+            *q++ = p[i];
+        }
+    }
+    *q = 0;
+    *out = strtod(buf, NULL);
+    if (buf != small)
+        free(buf);
+    return true;
+}
 
-    Return NULL if s is NULL.
-    Return NULL if start >= end.
-    Return NULL if malloc fails.
-    Return a slice [start, end).
-*/
-string sslice(string s, size_t start, size_t end) {
-    if (s == NULL) return NULL;
-    if (start >= end) return NULL;
-    return snewlen(s + start, end - start);
+/* Match a lowercase ASCII word case-insensitively */
+static
+bool sword(const char* p, size_t n, const char* word, size_t wlen) {
+    if (n < wlen) return false;
+    for (size_t i = 0; i < wlen; i++)
+        if ((p[i] | 0x20) != word[i])
+            return false;
+    return true;
 }
 
 /*
-    Bite the given string.
+    Parse a decimal floating point number at the start of a view.
 
-    Example:
-        s = snew("some;;;thing")
-        pattern = ";;;"
-        new = sbite(s, 3, pattern);
-        -> new == "some" && s == "thing"
+    Accepts an optional sign, digits with an optional '.' and fraction,
+    and an optional exponent, as well as "inf", "infinity" and "nan" in
+    any case. The decimal point is always '.', whatever the locale.
+    If the value is too large for a double, *out is an infinity and
+    *overflow is set. overflow may be NULL.
 
-    Return NULL if s is NULL or pattern is NULL.
-    Return NULL if plen > len(s).
-    Return NULL if pattern is not found in s.
+    Return 0 if v holds no number or out is NULL; *out is left untouched.
+    Return 0 if malloc fails for a number with a very long fraction.
+    Return the amount of bytes consumed.
 */
-string sbite(string s, size_t plen, const char* pattern) {
-    ssize_t idx = sfind(s, plen, pattern);
-    if (idx == -1) return NULL;
-    string new = sslice(s, 0, idx);
-    size_t newlen = sgetlen(s) - idx - plen;
-    memmove(s, s + idx + plen, newlen);
-    s[newlen] = 0;
-    ssetlen(s, newlen);
-    return new;
-}
+size_t stod_view(sview v, double* out, bool* overflow) {
+    if (overflow) *overflow = false;
+    if (v.ptr == NULL || out == NULL) return 0;
+    const char* p = v.ptr;
+    size_t n = v.len;
+    size_t i = 0;
+    bool neg = n > 0 && p[0] == '-';
+    if (n > 0 && (neg || p[0] == '+'))
+        i++;
 
-static inline
-size_t scount_private(const string s, size_t plen, const char* pattern) {
-    size_t count = 0;
-    if (plen == 1) {
-        for (size_t idx = 0; idx <= sgetlen(s) - plen; idx++) {
-            if (s[idx] == pattern[0])
-                count++;
+    size_t start = i;
+    uint64_t w = 0;
+    size_t digits = sdigits(p, n, &i, &w);
+    int64_t q = 0;
+    if (i < n && p[i] == '.') {
+        size_t dot = i++;
+        size_t frac = sdigits(p, n, &i, &w);
+        q = -(int64_t)frac;
+        digits += frac;
+        if (digits == 0)
+            i = dot;
+    }
+    if (digits == 0) {
+        double d;
+        if (sword(p + i, n - i, "infinity", 8)) {
+            i += 8;
+            d = INFINITY;
+        } else if (sword(p + i, n - i, "inf", 3)) {
+            i += 3;
+            d = INFINITY;
+        } else if (sword(p + i, n - i, "nan", 3)) {
+            i += 3;
+            d = NAN;
+        } else {
+            return 0;
         }
-    } else {
-        size_t idx = 0;
-        while (idx <= sgetlen(s) - plen) {
-            if (s[idx] == pattern[0] && memcmp(s + idx, pattern, plen) == 0) {
-                count++;
-                idx += plen;
-            } else 
-                idx++;
+        *out = neg ? -d : d;
+        return i;
+    }
+    if (i < n && (p[i] | 0x20) == 'e') {
+        size_t j = i + 1;
+        bool eneg = j < n && p[j] == '-';
+        if (j < n && (eneg || p[j] == '+'))
+            j++;
+        if (j < n && (unsigned char)(p[j] - '0') < 10) {
+            int64_t e = 0;
+            for (; j < n && (unsigned char)(p[j] - '0') < 10; j++)
+                if (e < 100000)
+                    e = e * 10 + (p[j] - '0');
+            q += eneg ? -e : e;
+            i = j;
         }
     }
-    return count;
+    /* Leading zeros do not count against the 19 digits w can hold */
+    if (digits > 19) {
+        for (size_t k = start; k < i && (p[k] == '0' || p[k] == '.'); k++)
+            digits -= p[k] == '0';
+    }
+    double d;
+    if (digits > 19 || !seisel(w, q, &d)) {
+        if (!sstrtod(p + start, i - start, &d))
+            return 0;
+    }
+    if (overflow) *overflow = isinf(d);
+    *out = neg ? -d : d;
+    return i;
 }
 
 /*
-    Split a string using the given separator into an array of n substrings.
+    Parse a decimal floating point number at the start of a string.
+    See stod_view().
+*/
+size_t stod(const string s, double* out, bool* overflow) {
+    return stod_view(sview_of(s), out, overflow);
+}
 
-    Return NULL if s, sep or n is NULL.
-    Return NULL if seplen > len(s) or seplen is 0.
-    Return NULL if the input causes size_t overflow.
-    Return NULL if any allocation fails.
+/*
+    UTF-8.
+
+    Code points are counted as the bytes that are not continuation
+    bytes (10xxxxxx), which is exact for valid UTF-8 and well defined,
+    if not meaningful, for anything else.
 */
-string* ssplit(const string s, size_t seplen, const char* sep, size_t* n) {
-    if (!s || !sep || !n)
-        return NULL;
-    if (seplen > sgetlen(s) || seplen == 0)
-        return NULL;
-    size_t count = scount_private(s, seplen, sep);
-    size_t size_to_alloc = (count + 1) * sizeof(string);
-    if (size_to_alloc / sizeof(string) != count + 1)
-        return NULL;
-    string* arr = malloc(size_to_alloc);
-    if (!arr)
-        return NULL;
 
-    size_t elem = 0;
-    size_t start = 0;
-    for (size_t idx = 0; idx <= sgetlen(s) - seplen; idx++) {
-        if (s[idx] == sep[0] && (seplen == 1 || memcmp(s + idx, sep, seplen) == 0)) {
-            arr[elem] = snewlen(s + start, idx - start);
-            if (!arr[elem]) goto cleanup;
-            elem++;
-            idx += seplen - 1;
-            start = idx + 1;
-        }
-    }
-    arr[elem] = snewlen(s + start, sgetlen(s) - start);
-    if (!arr[elem] || elem != count) goto cleanup;
-    *n = elem + 1;
-    return arr;
+/*
+    Check whether a view holds valid UTF-8: shortest forms only,
+    no surrogates and nothing above U+10FFFF.
 
-cleanup:
-    {
-        for (size_t i = 0; i < elem; i++)
-            sfree(arr[i]);
-        free(arr);
-        return NULL;
-    }
+    Return false if v.ptr is NULL.
+*/
+bool sutf8_valid_view(sview v) {
+    if (v.ptr == NULL) return false;
+    return utf8valid(v.ptr, v.len);
 }
 
 /*
-    Free an array created by ssplit.
+    Check whether a string holds valid UTF-8. See sutf8_valid_view().
+
+    A positive answer is remembered in the string, so later calls
+    return at once until a function of this library changes it.
+    Tiny strings have no room for that. Shared, arena and mapped
+    strings may be read by other threads, so their type byte is never
+    written here; they are checked every time unless already marked.
+    If the bytes are changed by hand, call supdatelen() afterwards.
+
+    Return false if s is NULL.
 */
-void sfreearr(string* arr, size_t n) {
-    if (!arr) return;
-    for (size_t i = 0; i < n; i++)
-        sfree(arr[i]);
-    free(arr);
+bool sutf8_valid(const string s) {
+    if (s == NULL) return false;
+    uint8_t flag = s[-1];
+    if (getFlags(flag) & H_UTF8)
+        return true;
+    if (!utf8valid(s, sgetlen(s)))
+        return false;
+    if ((flag & H_MASK) != H_TYPE_TINY && !(getFlags(flag) & H_ARENA) && !sreadonly(s))
+        s[-1] = (char)(flag | H_UTF8);
+    return true;
 }
 
 /*
-    Trim any character in c_arr from the beginning of the given string.
+    Count the code points of a view.
 
-    Return false if s or c_arr is NULL.
-    Return false if c_size is 0.
+    Return -1 if v.ptr is NULL.
+*/
+ssize_t sutf8_count_view(sview v) {
+    if (v.ptr == NULL) return -1;
+    return utf8count(v.ptr, v.len);
+}
 
-    Behaviour is undefined if c_size != len(c_arr).
+/*
+    Count the code points of a string.
+
+    Return -1 if s is NULL.
 */
-bool sltrimchar(string s, size_t c_size, char* c_arr) {
-    if (!s || !c_arr || !c_size)
-        return false;
-    size_t slen = sgetlen(s);
-    size_t counter = 0;
-    for (size_t idx = 0; idx < slen; ++idx) {
-        bool found = false;
-        for (size_t c_idx = 0; c_idx < c_size; ++c_idx) {
-            if (s[idx] == c_arr[c_idx]) {
-                ++counter;
-                found = true;
-                break;
-            }
-        }
-        if (!found)
+ssize_t sutf8_count(const string s) {
+    return sutf8_count_view(sview_of(s));
+}
+
+/* Blocks counted in one go while looking for a code point */
+#define SUTF8_STRIDE 256
+
+/*
+    Get the byte offset of the code point with the given index in a view.
+    An index equal to the amount of code points gives the length.
+
+    Runs of ASCII and whole blocks before the code point are counted
+    in bulk instead of byte by byte.
+
+    Return -1 if v.ptr is NULL.
+    Return -1 if index is larger than the amount of code points.
+*/
+ssize_t sutf8_offset_view(sview v, size_t index) {
+    if (v.ptr == NULL) return -1;
+    const char* s = v.ptr;
+    size_t n = v.len;
+    size_t pos = 0;
+    size_t seen = 0;
+    while (n - pos >= SUTF8_STRIDE) {
+        size_t c = utf8count(s + pos, SUTF8_STRIDE);
+        if (seen + c > index)
             break;
+        seen += c;
+        pos += SUTF8_STRIDE;
     }
-    memmove(s, s + counter, slen - counter);
-    ssetlen(s, slen - counter);
-    s[slen - counter] = 0;
-    return true;
+    for (; pos < n; pos++) {
+        uint64_t w;
+        if (n - pos >= 8 && index - seen >= 8 &&
+            (memcpy(&w, s + pos, 8), !(w & 0x8080808080808080ull))) {
+            seen += 8;
+            pos += 7;
+            continue;
+        }
+        if ((signed char)s[pos] > -65) {
+            if (seen == index)
+                return pos;
+            seen++;
+        }
+    }
+    return seen == index ? (ssize_t)n : -1;
 }
 
 /*
-    Create a new string where old pattern is replaced with a new one.
+    Get the byte offset of the code point with the given index in a string.
+    See sutf8_offset_view().
+
+    Example:
+        s = snew("na\xc3\xafve");
+        sutf8_offset(s, 3) == 4
 */
-string sreplace(const string s, size_t olen, const char* old, size_t nlen, const char* new) {
-    size_t n;
-    string* split = ssplit(s, olen, old, &n);
-    if (!split) return NULL;
-    string res = sjoins(n, split, nlen, new);
-    sfreearr(split, n);
-    return res;
+ssize_t sutf8_offset(const string s, size_t index) {
+    return sutf8_offset_view(sview_of(s), index);
 }
@@ -3,6 +3,8 @@
 /* Include libs */
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdarg.h>
 
 /* Definitions */
 #ifndef SAFE_STRING_H
@@ -10,6 +12,12 @@
 
 typedef char* string;
 
+/* Length up to 31, kept in the upper bits of type */
+typedef struct HeaderTiny {
+    uint8_t type;
+    char buf[];
+} HeaderTiny;
+
 typedef struct Header8 {
     uint8_t len;
     uint8_t allocated;
@@ -38,6 +46,59 @@ typedef struct Header64 {
     char buf[];
 } Header64;
 
+/* Non-owning view of bytes, see sview_of() */
+typedef struct sview {
+    const char* ptr;
+    size_t len;
+} sview;
+
+/* Array of strings stored in one blob, see sarrnew() */
+typedef struct sarray sarray;
+
+/* Access hints for smapfile() and smadvise() */
+#define SMAP_SEQUENTIAL 1
+#define SMAP_RANDOM 2
+#define SMAP_WILLNEED 4
+
+/* Resumable search over chunked input, see sscreate() */
+typedef struct sstream sstream;
+
+/* Immutable balanced tree of chunks, see sronew() */
+typedef struct srope srope;
+
+/* Concurrent set of canonical strings, see sicreate() */
+typedef struct sintab sintab;
+
+/* Arena for short-lived strings, see sacreate() */
+typedef struct sarena sarena;
+
+/* Compiled search pattern, see spcompile() */
+typedef struct spattern spattern;
+
+/* Set of bytes for the trim and span functions, see scharset_of() */
+typedef struct scharset {
+    uint64_t bits[4];
+    uint8_t nib[2][16];
+} scharset;
+
+/* Cursor over the tokens of a string, see stok_init() */
+typedef struct stok {
+    sview rest;
+    const char* sep;
+    size_t seplen;
+    const spattern* sp;
+    bool done;
+} stok;
+
+/* Multi-pattern automaton, see smcompile() */
+typedef struct smulti smulti;
+
+/* A match reported by smfindall() */
+typedef struct smatch {
+    size_t pos;
+    size_t pattern;
+} smatch;
+
 /* Exposed functions */
 
 string snew(const void* input);
@@ -45,13 +106,28 @@ string snewlen(const void* input, size_t ilen);
 void sfree(const string s);
 size_t sgetlen(const string s);
 void supdatelen(const string s, size_t len);
+size_t sgetavail(const string s);
+string sreserve(string s, size_t capacity);
+string sshrink_to_fit(string s);
+void sclear(string s);
 string sdup(const string s);
 string sjoin(size_t n, const char* s[n], size_t plen, const char* pattern);
 string sjoins(size_t n, const string s[n], size_t plen, const char* pattern);
 string scatc(const char* s1, const char* s2);
 string scats(const string s1, const string s2);
 string scat(string s, size_t cstr_len, char* cstr);
+string scatvfmt(string s, const char* fmt, va_list ap);
+#ifdef __GNUC__
+__attribute__((format(printf, 2, 3)))
+#endif
+string scatfmt(string s, const char* fmt, ...);
+string scatn(string s, size_t n, const sview parts[n]);
+string scatu64(string s, uint64_t v);
+string scati64(string s, int64_t v);
+string scathex(string s, uint64_t v, size_t width);
 bool slower(string s);
+bool supper_ascii(string s);
+bool slower_ascii(string s);
 bool supper(string s);
 bool sstartswith(string s, size_t plen, const char* pattern);
 bool sendswith(string s, size_t plen, const char* pattern);
@@ -66,6 +142,129 @@ ssize_t sfind_advanced(string s, size_t plen, const char* pattern);
 string* ssplit(const string s, size_t seplen, const char* sep, size_t* n);
 void sfreearr(string* arr, size_t n);
 bool sltrimchar(string s, size_t c_size, char* c_arr);
+scharset scharset_of(size_t n, const char* chars);
+bool scharset_has(const scharset* cs, char c);
+bool sltrimchars(string s, const scharset* cs);
+bool srtrimchars(string s, const scharset* cs);
+bool strimchars(string s, const scharset* cs);
+size_t sspn(const string s, const scharset* cs);
+size_t scspn(const string s, const scharset* cs);
+ssize_t sfind_any_of(const string s, const scharset* cs);
+size_t sspn_view(sview v, const scharset* cs);
+size_t scspn_view(sview v, const scharset* cs);
+ssize_t sfind_any_of_view(sview v, const scharset* cs);
 string sreplace(const string s, size_t olen, const char* old, size_t nlen, const char* new);
+string sreplace_inplace(string s, size_t olen, const char* old, size_t nlen, const char* new);
+
+spattern* spcompile(size_t plen, const char* pattern);
+void spfree(spattern* sp);
+size_t spgetlen(const spattern* sp);
+ssize_t sfindp(string s, const spattern* sp);
+ssize_t srfindp(string s, const spattern* sp);
+ssize_t scountp(string s, const spattern* sp);
+bool sremovep(string s, const spattern* sp);
+string sbitep(string s, const spattern* sp);
+string* ssplitp(const string s, const spattern* sep, size_t* n);
+string sreplacep(const string s, const spattern* old, size_t nlen, const char* new);
+
+smulti* smcompile(size_t n, const size_t lens[n], const char* patterns[n]);
+void smfree(smulti* m);
+ssize_t smfind(string s, const smulti* m, size_t* which);
+ssize_t smfindall(string s, const smulti* m, smatch* out, size_t cap);
+ssize_t smcount(string s, const smulti* m, size_t* counts);
+
+sarena* sacreate(size_t blocksize);
+void sareset(sarena* a);
+void safree(sarena* a);
+string sanewlen(sarena* a, const void* input, size_t ilen);
+string sanew(sarena* a, const void* input);
+string sadup(sarena* a, const string s);
+string saslice(sarena* a, string s, size_t start, size_t end);
+string* sasplit(sarena* a, const string s, size_t seplen, const char* sep, size_t* n);
+
+sview sview_of(const string s);
+sview sslice_view(sview s, size_t start, size_t end);
+sview sbite_view(sview* s, size_t plen, const char* pattern);
+void stok_init(stok* t, const string s, size_t seplen, const char* sep);
+void stok_init_view(stok* t, sview v, size_t seplen, const char* sep);
+void stok_initp(stok* t, sview v, const spattern* sp);
+bool stok_next(stok* t, sview* out);
+sview stok_rest(const stok* t);
+ssize_t ssplit_views(sview s, size_t seplen, const char* sep, sview* out, size_t cap);
+sview* sasplit_views(sarena* a, sview s, size_t seplen, const char* sep, size_t* n);
+ssize_t sfind_view(sview s, size_t plen, const char* pattern);
+ssize_t srfind_view(sview s, size_t plen, const char* pattern);
+ssize_t scount_view(sview s, size_t plen, const char* pattern);
+ssize_t sfindp_view(sview s, const spattern* sp);
+ssize_t scountp_view(sview s, const spattern* sp);
+bool sstartswith_view(sview s, size_t plen, const char* pattern);
+bool sendswith_view(sview s, size_t plen, const char* pattern);
+
+sarray* sarrnew(size_t nitems, size_t nbytes);
+void sarrfree(sarray* a);
+bool sarrpush(sarray* a, const char* ptr, size_t len);
+size_t sarrlen(const sarray* a);
+sview sarrget(const sarray* a, size_t i);
+bool sarrnext(const sarray* a, size_t* i, sview* out);
+sarray* ssplit_array(const string s, size_t seplen, const char* sep);
+string sjoin_array(const sarray* a, size_t seplen, const char* sep);
+string sjoinv(string dst, size_t n, const sview parts[n], size_t seplen, const char* sep);
+
+uint64_t shash(const string s);
+uint64_t shash_view(sview v);
+string shashed(string s);
+bool sequal(const string a, const string b);
+
+sintab* sicreate(size_t hint);
+void sifree(sintab* it);
+size_t sicount(sintab* it);
+string sintern(sintab* it, const string s);
+string sintern_view(sintab* it, sview v);
+
+string sshare(string s);
+string sretain(string s);
+void srelease(string s);
+string sunshare(string s);
+
+ssize_t sfind_parallel(string s, size_t plen, const char* pattern);
+ssize_t scount_parallel(string s, size_t plen, const char* pattern);
+
+string smapfile(const char* path, int hints);
+bool smadvise(const string s, int hints);
+
+sstream* sscreate(size_t plen, const char* pattern);
+void ssfree(sstream* ss);
+void ssreset(sstream* ss);
+size_t sspos(const sstream* ss);
+ssize_t ssfeed(sstream* ss, const char* chunk, size_t n, size_t* out, size_t cap);
+ssize_t ssfeed_file(sstream* ss, FILE* f, size_t* out, size_t cap);
+ssize_t ssfeed_fd(sstream* ss, int fd, size_t* out, size_t cap);
+
+srope* sronew(size_t len, const char* bytes);
+srope* srodup(srope* r);
+void srofree(srope* r);
+size_t srolen(const srope* r);
+srope* srocat(srope* a, srope* b);
+srope* sroinsert(srope* r, size_t pos, size_t len, const char* bytes);
+srope* sroslice(const srope* r, size_t start, size_t end);
+srope* sroerase(srope* r, size_t start, size_t end);
+bool sronext(const srope* r, size_t* pos, sview* out);
+string sroflatten(const srope* r);
+ssize_t srofind(const srope* r, size_t plen, const char* pattern);
+ssize_t srocount(const srope* r, size_t plen, const char* pattern);
+
+size_t stou64(const string s, uint64_t* out, bool* overflow);
+size_t stou64_view(sview v, uint64_t* out, bool* overflow);
+size_t stoi64(const string s, int64_t* out, bool* overflow);
+size_t stoi64_view(sview v, int64_t* out, bool* overflow);
+size_t stod(const string s, double* out, bool* overflow);
+size_t stod_view(sview v, double* out, bool* overflow);
+
+bool sutf8_valid(const string s);
+bool sutf8_valid_view(sview v);
+ssize_t sutf8_count(const string s);
+ssize_t sutf8_count_view(sview v);
+ssize_t sutf8_offset(const string s, size_t index);
+ssize_t sutf8_offset_view(sview v, size_t index);
 
 #endif 